@@ -0,0 +1,29 @@
+#ifndef BOOT_H
+#define BOOT_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+// ----------------------------------------------------------------------------------------------------
+
+typedef enum {
+    BOOT_STAGE_NVS,
+    BOOT_STAGE_UART,
+    BOOT_STAGE_WIFI,
+    BOOT_STAGE_HTTP,
+    BOOT_STAGE_COUNT,
+} BootStage;
+
+typedef void (*BootReadyFn)(BootStage stage, void *arg);
+
+#define BOOT_READY_CB_MAX   8
+
+void boot_init(void);
+void boot_nvs_setup(void);
+bool boot_on_ready(BootStage stage, BootReadyFn fn, void *arg);
+void boot_mark_ready(BootStage stage);
+bool boot_is_ready(BootStage stage);
+bool boot_wait(BootStage stage, TickType_t timeout);
+uint32_t boot_ready_ms(BootStage stage);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+// ----------------------------------------------------------------------------------------------------
+
+/**
+ * 將 UART 與 socket 原始流量連同時間戳記錄到固定大小的位元組環形緩衝區，滿了覆蓋最舊的紀錄。
+ * 匯出格式 (小端序)：CaptureFileHeader，之後依時間順序排列的 CaptureRecordHeader + 資料。
+ * Raw UART and socket traffic is recorded with timestamps into a fixed-size byte ring that
+ * overwrites its oldest records. Dump layout (little-endian): CaptureFileHeader, then
+ * CaptureRecordHeader + payload per record, oldest first. tools/replay.py reads it.
+ */
+typedef enum {
+    CAPTURE_SRC_UART_RX,    // STM32 → 站台 (STM32 to station)
+    CAPTURE_SRC_UART_TX,    // 站台 → STM32 (station to STM32)
+    CAPTURE_SRC_UDP_RX,
+    CAPTURE_SRC_UDP_TX,
+    CAPTURE_SRC_TCP_RX,
+    CAPTURE_SRC_COUNT,
+} CaptureSource;
+
+#define CAPTURE_MAGIC           0x50414353  // "SCAP"
+#define CAPTURE_VERSION         1
+#define CAPTURE_RING_SIZE       CONFIG_STATION_CAPTURE_RING_SIZE
+// 超過的資料截斷，header 的 len 保留原始長度 (longer payloads are truncated, len keeps the original size)
+#define CAPTURE_RECORD_MAX      255
+
+typedef struct __attribute__((packed)) {
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    record_hdr_size;
+    uint32_t    records;
+    uint32_t    dropped;
+} CaptureFileHeader;
+
+typedef struct __attribute__((packed)) {
+    uint32_t    t_us;       // esp_timer 微秒低 32 位元 (low 32 bits of esp_timer us)
+    uint16_t    len;        // 原始長度 (original length)
+    uint8_t     source;     // CaptureSource
+    uint8_t     stored;     // 實際存下的位元組數 (bytes stored after the header)
+} CaptureRecordHeader;
+
+/**
+ * 凍結期間的環形緩衝區內容，最多分成兩段 (環繞處)
+ * Ring contents while frozen, at most two pieces split at the wrap point
+ */
+typedef struct {
+    const uint8_t   *part[2];
+    uint32_t        part_len[2];
+    uint32_t        records;
+    uint32_t        dropped;
+} CaptureView;
+
+void capture_set_enabled(bool enabled);
+bool capture_enabled(void);
+void capture_clear(void);
+void capture_record(CaptureSource source, const uint8_t *data, uint16_t len);
+void capture_freeze(CaptureView *view);
+void capture_thaw(void);
+
+#endif
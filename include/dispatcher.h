@@ -0,0 +1,42 @@
+#ifndef DISPATCHER_H
+#define DISPATCHER_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+// ----------------------------------------------------------------------------------------------------
+
+/**
+ * 中央事件分派任務：等待事件群組，依事件位元呼叫已註冊的處理函式，
+ * 每次喚醒後再執行期限函式並以 esp_timer 排定下一次喚醒。
+ * Central dispatcher task: waits on an event group, runs the handlers registered for the
+ * raised bits, then runs the deadline functions and arms an esp_timer for the nearest one.
+ */
+#define DISPATCH_EV_UART_RX     (1UL << 0)
+#define DISPATCH_EV_UDP_RX      (1UL << 1)
+#define DISPATCH_EV_UDP_TX      (1UL << 2)
+#define DISPATCH_EV_TIMER       (1UL << 3)
+// 取得 IP 後啟動網路服務，只觸發一次 (start the network services once an IP is up, raised once)
+#define DISPATCH_EV_NET_START   (1UL << 4)
+#define DISPATCH_EV_ALL         (DISPATCH_EV_UART_RX | DISPATCH_EV_UDP_RX | DISPATCH_EV_UDP_TX | DISPATCH_EV_TIMER | \
+                                 DISPATCH_EV_NET_START)
+
+#define DISPATCH_HANDLER_MAX    8
+#define DISPATCH_DEADLINE_MAX   4
+// esp_timer 最短排程間隔 (shortest esp_timer period armed)
+#define DISPATCH_MIN_WAIT_US    50
+
+typedef void (*DispatchHandlerFn)(EventBits_t events, void *arg);
+/**
+ * @brief 期限函式：處理到期工作並回傳距離下一次到期的微秒數，UINT32_MAX 表示沒有期限
+ *        Deadline function: do the due work and return us until the next deadline, UINT32_MAX for none
+ */
+typedef uint32_t (*DispatchDeadlineFn)(uint32_t now_us, void *arg);
+
+void dispatcher_setup(void);
+bool dispatcher_register(EventBits_t events, DispatchHandlerFn fn, void *arg);
+bool dispatcher_register_deadline(DispatchDeadlineFn fn, void *arg);
+void dispatcher_post(EventBits_t events);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HTTP_ASSETS_H
+#define HTTP_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP_ASSET_CHUNK_SIZE   1024
+
+typedef struct {
+    const char      *path;
+    const char      *mime;
+    const uint8_t   *data;
+    size_t          len;
+    const char      *etag;
+} HttpAsset;
+
+// 由 tools/web_embed.py 產生 (generated by tools/web_embed.py)
+extern const HttpAsset http_assets[];
+extern const size_t http_assets_count;
+
+const HttpAsset *http_asset_find(const char *path, size_t path_len);
+
+#endif
@@ -6,5 +6,18 @@
 extern const httpd_uri_t echo_uri;
 extern const httpd_uri_t hello_get_uri;
 extern const httpd_uri_t hello_post_uri;
+extern const httpd_uri_t ws_telemetry_uri;
+extern const httpd_uri_t metrics_uri;
+extern const httpd_uri_t cmd_uri;
+extern const httpd_uri_t tasks_uri;
+extern const httpd_uri_t trace_uri;
+extern const httpd_uri_t capture_get_uri;
+extern const httpd_uri_t capture_post_uri;
+extern const httpd_uri_t telemetry_uri;
+extern const httpd_uri_t history_uri;
+extern const httpd_uri_t assets_uri;
+
+void ws_telemetry_attach(httpd_handle_t server);
+void ws_telemetry_session_closed(int fd);
 
 #endif
@@ -0,0 +1,13 @@
+#ifndef HTTP_STREAM_H
+#define HTTP_STREAM_H
+
+#include "esp_http_server.h"
+
+#define HTTP_STREAM_CHUNK_SIZE      512
+#define HTTP_STREAM_RECV_RETRY      3
+
+typedef esp_err_t (*HttpBodyConsumer)(httpd_req_t *req, const uint8_t *chunk, size_t len, void *ctx);
+
+esp_err_t http_body_stream(httpd_req_t *req, HttpBodyConsumer consume, void *ctx);
+
+#endif
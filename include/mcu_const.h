@@ -8,6 +8,7 @@
 
 #define CMD_CODE_DATA_TRRE 0x10
 #define CMD_CODE_VECH_CONTROL 0x20
+#define CMD_CODE_FLOW_CREDIT 0x30
 #define CMD_CODE_LOOP_STOP 0x00
 #define CMD_CODE_ONLY_ONCE 0x01
 #define CMD_CODE_LOOP_START 0x02
@@ -0,0 +1,92 @@
+#ifndef METRICS_H
+#define METRICS_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+// ----------------------------------------------------------------------------------------------------
+
+typedef enum {
+    METRIC_UART_RX_FRAMES,
+    METRIC_UART_RX_BYTES,
+    METRIC_UART_FRAME_ERRORS,
+    METRIC_UART_TX_FRAMES,
+    METRIC_UART_TX_BYTES,
+    METRIC_UART_TX_ERRORS,
+    METRIC_WIFI_UDP_RX_DATAGRAMS,
+    METRIC_WIFI_UDP_RX_BYTES,
+    METRIC_WIFI_UDP_RX_BAD,
+    METRIC_WIFI_UDP_RX_DUPS,
+    METRIC_WIFI_UDP_CMD_DROPS,
+    METRIC_WIFI_UDP_TX_DATAGRAMS,
+    METRIC_WIFI_UDP_TX_BYTES,
+    METRIC_WIFI_UDP_TX_ERRORS,
+    METRIC_HTTP_SESSIONS,
+    METRIC_WS_FRAMES_SENT,
+    METRIC_WS_FRAMES_DROPPED,
+    METRIC_WIFI_DISCONNECTS,
+    METRIC_WIFI_CACHE_MISSES,
+    METRIC_CAPTURE_RECORDS,
+    METRIC_CAPTURE_DROPS,
+    METRIC_TELEMETRY_QUERIES,
+    METRIC_UART_CMD_COALESCED,
+    METRIC_UART_FLOW_STALLS,
+    METRIC_UART_FLOW_STARVED,
+    METRIC_WIFI_UDP_TELEMETRY_DROPS,
+    METRIC_WIFI_UDP_RX_TRUNCATED,
+    METRIC_COUNTER_COUNT,
+} MetricCounter;
+
+typedef enum {
+    METRIC_HIST_UART_RX_PROC_US,
+    METRIC_HIST_UART_TX_WRITE_US,
+    METRIC_HIST_WIFI_UDP_RX_PROC_US,
+    METRIC_HIST_WIFI_UDP_TX_SEND_US,
+    METRIC_HIST_DISPATCH_TIMER_LATE_US,
+    METRIC_HIST_UART_ESTOP_US,
+    // 封包追蹤：順序須與 PktStage 的相鄰間隔一致 (packet trace spans, ordered like the PktStage gaps)
+    METRIC_HIST_TRACE_U2W_RX_ENQUEUE_US,
+    METRIC_HIST_TRACE_U2W_ENQUEUE_DISPATCH_US,
+    METRIC_HIST_TRACE_U2W_DISPATCH_TX_ENQUEUE_US,
+    METRIC_HIST_TRACE_U2W_TX_ENQUEUE_DONE_US,
+    METRIC_HIST_TRACE_U2W_TOTAL_US,
+    METRIC_HIST_TRACE_W2U_RX_ENQUEUE_US,
+    METRIC_HIST_TRACE_W2U_ENQUEUE_DISPATCH_US,
+    METRIC_HIST_TRACE_W2U_DISPATCH_TX_ENQUEUE_US,
+    METRIC_HIST_TRACE_W2U_TX_ENQUEUE_DONE_US,
+    METRIC_HIST_TRACE_W2U_TOTAL_US,
+    METRIC_HIST_COUNT,
+} MetricHist;
+
+typedef enum {
+    METRIC_GAUGE_WIFI_BOOT_TO_IP_MS,
+    METRIC_GAUGE_WIFI_LAST_RECOVERY_MS,
+    METRIC_GAUGE_WIFI_MAX_RECOVERY_MS,
+    METRIC_GAUGE_BOOT_FIRST_UART_FRAME_MS,
+    METRIC_GAUGE_UART_ESTOP_MAX_US,
+    METRIC_GAUGE_COUNT,
+} MetricGauge;
+
+// bucket i 上界為 2^i 微秒，最後一格為 +Inf (bucket i is <= 2^i us, last one is +Inf)
+#define METRIC_HIST_BUCKETS     18
+
+typedef struct {
+    uint32_t    buckets[METRIC_HIST_BUCKETS];
+    uint64_t    sum;
+    uint32_t    count;
+} MetricHistSnapshot;
+
+typedef void (*MetricsWriteFn)(void *ctx, const char *text, size_t len);
+
+void metrics_add(MetricCounter id, uint32_t value);
+static inline void metrics_inc(MetricCounter id) { metrics_add(id, 1); }
+void metrics_observe(MetricHist id, uint32_t value_us);
+void metrics_gauge_set(MetricGauge id, uint32_t value);
+void metrics_gauge_max(MetricGauge id, uint32_t value);
+uint32_t metrics_gauge_get(MetricGauge id);
+uint32_t metrics_counter_total(MetricCounter id);
+void metrics_hist_snapshot(MetricHist id, MetricHistSnapshot *snap);
+uint32_t metrics_hist_percentile(const MetricHistSnapshot *snap, uint8_t percent);
+void metrics_render(MetricsWriteFn write, void *ctx);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef PKT_TRACE_H
+#define PKT_TRACE_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+// ----------------------------------------------------------------------------------------------------
+
+/**
+ * 每個封包隨身攜帶各階段的時間戳 (esp_timer 微秒低 32 位元，0 表示未經過該階段)，
+ * 送出完成時把相鄰階段的間隔記入直方圖。
+ * Every packet carries one timestamp per stage (low 32 bits of esp_timer us, 0 = stage not reached);
+ * on TX completion the gaps between consecutive stages go into per-direction histograms.
+ */
+typedef enum {
+    PKT_STAGE_RX,           // 從 UART/socket 讀出 (read from UART or the socket)
+    PKT_STAGE_ENQUEUE,      // 放入接收緩衝區 (queued in the receive buffer)
+    PKT_STAGE_DISPATCH,     // 分派任務開始處理 (picked up by the dispatcher)
+    PKT_STAGE_TX_ENQUEUE,   // 放入傳輸緩衝區或聚合器 (queued for transmit or aggregation)
+    PKT_STAGE_TX_DONE,      // 交給驅動/協定堆疊 (handed to the driver or the stack)
+    PKT_STAGE_COUNT,
+} PktStage;
+
+typedef enum {
+    PKT_DIR_UART_TO_WIFI,
+    PKT_DIR_WIFI_TO_UART,
+    PKT_DIR_COUNT,
+} PktDir;
+
+typedef struct {
+    uint32_t    t_us[PKT_STAGE_COUNT];
+} PktTrace;
+
+// 相鄰階段間隔數加上一個總延遲 (one span per stage gap plus the end-to-end total)
+#define PKT_TRACE_SPAN_COUNT    PKT_STAGE_COUNT
+#define PKT_TRACE_SPAN_TOTAL    (PKT_STAGE_COUNT - 1)
+
+void pkt_trace_stamp(PktTrace *self, PktStage stage);
+void pkt_trace_finish(PktTrace *self, PktDir dir);
+const char *pkt_trace_span_name(uint8_t span);
+const char *pkt_trace_dir_name(PktDir dir);
+
+#endif
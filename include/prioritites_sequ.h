@@ -1,13 +1,20 @@
 #ifndef PRIORITITES_SEQU_H
 #define PRIORITITES_SEQU_H
 
+#include "sdkconfig.h"
 #include "freertos/FreeRTOSConfig.h"
 
-#define UART_READ_TASK_PRIO_SEQU            configMAX_PRIORITIES-1
-#define WIFI_UDP_READ_TASK_PRIO_SEQU        configMAX_PRIORITIES-2
-#define WIFI_TCP_READ_TASK_PRIO_SEQU        configMAX_PRIORITIES-3
-#define UART_WRITE_TASK_PRIO_SEQU           configMAX_PRIORITIES-4
-#define WIFI_UDP_WRITE_TASK_PRIO_SEQU       configMAX_PRIORITIES-5
-#define WIFI_TCP_WRITE_TASK_PRIO_SEQU       configMAX_PRIORITIES-6
+// 控制路徑 (APP_CPU)：該核心上沒有 Wi-Fi/lwIP，可用最高優先權
+// Control path (APP_CPU): no Wi-Fi/lwIP on that core, so it takes the top priorities
+#define UART_READ_TASK_PRIO_SEQU            (configMAX_PRIORITIES-1)
+#define DISPATCHER_TASK_PRIO_SEQU           (configMAX_PRIORITIES-2)
+#define UART_WRITE_TASK_PRIO_SEQU           (configMAX_PRIORITIES-3)
+
+// 網路路徑 (PRO_CPU)：低於 lwIP tcpip 任務，避免搶走協定堆疊處理封包的時間
+// Network path (PRO_CPU): below the lwIP tcpip task so the stack is never starved of packets
+#define WIFI_UDP_READ_TASK_PRIO_SEQU        (CONFIG_LWIP_TCPIP_TASK_PRIO-1)
+#define WIFI_UDP_WRITE_TASK_PRIO_SEQU       (CONFIG_LWIP_TCPIP_TASK_PRIO-2)
+#define WIFI_TCP_READ_TASK_PRIO_SEQU        (CONFIG_LWIP_TCPIP_TASK_PRIO-3)
+#define WIFI_TCP_WRITE_TASK_PRIO_SEQU       (CONFIG_LWIP_TCPIP_TASK_PRIO-4)
 
 #endif
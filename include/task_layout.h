@@ -0,0 +1,49 @@
+#ifndef TASK_LAYOUT_H
+#define TASK_LAYOUT_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+// ----------------------------------------------------------------------------------------------------
+
+/**
+ * 控制路徑 (UART) 固定在 APP_CPU，網路任務與 Wi-Fi/lwIP/httpd 同在 PRO_CPU。
+ * The control path (UART) is pinned to APP_CPU; network tasks share PRO_CPU with Wi-Fi/lwIP/httpd.
+ */
+#if CONFIG_FREERTOS_UNICORE
+#define TASK_CORE_CONTROL   0
+#define TASK_CORE_NETWORK   0
+#else
+#define TASK_CORE_CONTROL   1
+#define TASK_CORE_NETWORK   0
+#endif
+
+typedef enum {
+    TASK_ID_UART_RX,
+    TASK_ID_UART_TX,
+    TASK_ID_DISPATCHER,
+    TASK_ID_WIFI_UDP_RX,
+    TASK_ID_WIFI_TCP_RX,
+    TASK_ID_WIFI_UDP_ECHO,
+    TASK_ID_UART2_RX,
+    TASK_ID_UART2_TX,
+    TASK_ID_COUNT,
+} TaskId;
+
+typedef struct {
+    const char  *name;
+    StackType_t *stack;
+    uint32_t    stack_size;
+    UBaseType_t priority;
+    BaseType_t  core;
+} TaskLayout;
+
+extern const TaskLayout task_layouts[TASK_ID_COUNT];
+
+bool task_layout_spawn(TaskId id, TaskFunction_t fn, void *arg);
+TaskHandle_t task_layout_handle(TaskId id);
+const TaskLayout *task_layout_find(TaskHandle_t handle);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef TELEMETRY_CACHE_H
+#define TELEMETRY_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetry/sample.h"
+#include "sdkconfig.h"
+
+/**
+ * 每個通道保存最新一筆遙測值，由分派任務 (唯一寫入者) 經 telemetry sink 更新，
+ * 讀取端以 seqlock 取得一致的快照，不需上鎖也不會擋住寫入者。
+ * Latest value per channel, updated by the dispatcher (the single writer) through a telemetry
+ * sink. Readers take consistent snapshots through a seqlock, never blocking the writer.
+ */
+
+#define TELEMETRY_CACHE_DEFAULT_MAX_AGE_US  (CONFIG_STATION_TELEMETRY_MAX_AGE_MS * 1000U)
+// UDP 快照紀錄中每個通道的大小 (bytes per channel in a UDP snapshot record)
+#define TELEMETRY_CACHE_ENTRY_WIRE_SIZE     10
+
+typedef enum {
+    TELEMETRY_CACHE_EMPTY,  // 尚未收到任何樣本 (no sample received yet)
+    TELEMETRY_CACHE_FRESH,
+    TELEMETRY_CACHE_STALE,  // 超過 max_age，值仍回傳 (older than max_age, value still returned)
+} TelemetryCacheState;
+
+typedef struct {
+    float       value;
+    uint32_t    t_us;
+    uint32_t    age_us;
+    uint32_t    count;
+} TelemetryCacheEntry;
+
+void telemetry_cache_setup(void);
+TelemetryCacheState telemetry_cache_read(TelemetryChannel channel, uint32_t max_age_us, TelemetryCacheEntry *entry);
+uint8_t telemetry_cache_encode(uint8_t channel_mask, uint32_t max_age_us, uint8_t *out, uint8_t cap);
+const char *telemetry_cache_state_name(TelemetryCacheState state);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef TELEMETRY_HISTORY_H
+#define TELEMETRY_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetry/sample.h"
+#include "sdkconfig.h"
+
+/**
+ * 每個通道一個固定大小的時間序列環形緩衝區，時間戳與數值分欄存放 (struct-of-arrays)，
+ * 範圍查詢只需掃描連續的時間欄。寫入者為分派任務，讀取端以累計序號偵測被覆蓋的資料。
+ * One fixed-size time-series ring per channel with timestamps and values in separate columns
+ * (struct-of-arrays), so range queries scan one contiguous time column. The dispatcher is the
+ * single writer; readers detect overwritten slots through the running sample index.
+ */
+
+#define TELEMETRY_HISTORY_LEN   CONFIG_STATION_TELEMETRY_HISTORY_LEN
+_Static_assert((TELEMETRY_HISTORY_LEN & (TELEMETRY_HISTORY_LEN - 1)) == 0, "history length must be a power of two");
+
+/**
+ * 固定間隔取平均的降採樣器，每個區間輸出第一筆時間戳與區間平均值
+ * Fixed-step averaging decimator; each bucket yields its first timestamp and mean value
+ */
+typedef struct {
+    uint32_t    step_us;
+    uint32_t    first_us;
+    float       sum;
+    uint16_t    count;
+} TelemetryDecimator;
+
+void telemetry_history_setup(void);
+uint32_t telemetry_history_oldest(TelemetryChannel channel);
+uint16_t telemetry_history_read(TelemetryChannel channel, uint32_t *cursor, uint32_t *t_us, float *value, uint16_t max);
+
+TelemetryDecimator telemetry_decimator_new(uint32_t step_us);
+bool telemetry_decimator_push(TelemetryDecimator *self, uint32_t t_us, float value, uint32_t *out_t_us, float *out_value);
+bool telemetry_decimator_flush(TelemetryDecimator *self, uint32_t *out_t_us, float *out_value);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef TELEMETRY_SAMPLE_H
+#define TELEMETRY_SAMPLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vec_mod.h"
+
+typedef enum {
+    TELEMETRY_CH_LEFT_SPEED,
+    TELEMETRY_CH_LEFT_ADC,
+    TELEMETRY_CH_RIGHT_SPEED,
+    TELEMETRY_CH_RIGHT_ADC,
+    TELEMETRY_CH_COUNT,
+} TelemetryChannel;
+
+typedef struct {
+    uint32_t            t_us;
+    float               value;
+    TelemetryChannel    channel;
+} TelemetrySample;
+
+typedef void (*TelemetrySink)(const TelemetrySample *sample);
+
+#define TELEMETRY_SINK_MAX  4
+
+bool telemetry_take_store(VecU8 *vec_u8, TelemetrySample *sample);
+bool telemetry_sink_register(TelemetrySink sink);
+void telemetry_publish(TelemetrySample *sample);
+const char *telemetry_channel_name(TelemetryChannel channel);
+
+#endif
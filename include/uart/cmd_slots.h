@@ -0,0 +1,67 @@
+#ifndef UART_CMD_SLOTS_H
+#define UART_CMD_SLOTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart/packet.h"
+
+/**
+ * 每種「狀態型」命令只保留一個待送槽位，新命令直接覆蓋舊的 (last-writer-wins)，
+ * 傳輸任務先送槽位再送 FIFO，線上永遠是最新的意圖且積壓有上限。
+ * One pending slot per class of state-setting command; a newer command overwrites the pending
+ * one (last-writer-wins). The TX task drains the slots before the FIFO, so the wire always
+ * carries the latest intent and the backlog is bounded.
+ *
+ * 緊急停止是最高優先的通道：不經過批次，立即寫入並作廢尚未送出的行進命令，
+ * 傳輸任務總是先送它。優先順序：緊急停止 > 行進 > 回報模式 > FIFO。
+ * Emergency stop is the strict-priority lane: it skips batching, supersedes any motion still
+ * pending and is always written first. Lane order: e-stop > motion > report modes > FIFO.
+ *
+ * 順序保證：回報模式只存在於槽位，所以每個馬達/種類最後生效的模式一定是最後收到的那一個。
+ * 但 FIFO 中較早的 ONLY_ONCE 讀取可能在較晚的模式命令之後才送出 (例如 right_speed_once 後接
+ * right_speed_stop，線上順序為 stop、once)；單次讀取不改變模式，最終狀態不受影響。
+ * Ordering: report modes only live in the slots, so the mode in effect per motor/kind is always
+ * the last one received. An earlier ONLY_ONCE read in the FIFO may still reach the wire after a
+ * later mode change (right_speed_once then right_speed_stop goes out as stop, once); a one-shot
+ * read does not change the mode, so the final state is unaffected.
+ */
+
+#define UART_CMD_SLOT_ARGS_MAX  3
+
+typedef enum {
+    UART_CMD_SLOT_ESTOP,        // CMD_MOVE_STOP，只能經由 uart_cmd_slots_estop 寫入 (written through uart_cmd_slots_estop only)
+    UART_CMD_SLOT_MOTION,       // CMD_CODE_VECH_CONTROL
+    UART_CMD_SLOT_LEFT_SPEED,   // DATA_TRRE 回報模式 LOOP_START/LOOP_STOP (report mode)
+    UART_CMD_SLOT_LEFT_ADC,
+    UART_CMD_SLOT_RIGHT_SPEED,
+    UART_CMD_SLOT_RIGHT_ADC,
+    UART_CMD_SLOT_COUNT,
+    UART_CMD_SLOT_NONE = UART_CMD_SLOT_COUNT,
+} UartCmdSlot;
+
+typedef struct {
+    uint8_t     args[UART_CMD_SLOT_ARGS_MAX];
+    PktTrace    trace;
+} UartCmdSlotEntry;
+
+typedef struct {
+    UartCmdSlotEntry    entries[UART_CMD_SLOT_COUNT];
+    uint8_t             pending;    // bit i 表示槽位 i 有待送命令 (bit i set => slot i pending)
+    uint32_t            estop_us;   // 最早一個未送出停止命令的請求時間 (request time of the oldest unsent stop)
+} UartCmdSlotSet;
+
+typedef struct {
+    UartCmdSlotSet  set;
+    portMUX_TYPE    lock;
+} UartCmdSlots;
+#define UART_CMD_SLOTS_INIT { .lock = portMUX_INITIALIZER_UNLOCKED }
+
+UartCmdSlot uart_cmd_slot_of(uint8_t code, const uint8_t *args, uint8_t args_len);
+bool uart_cmd_slot_set_put(UartCmdSlotSet *self, UartCmdSlot slot, const uint8_t *args);
+bool uart_cmd_is_estop(uint8_t code, const uint8_t *args, uint8_t args_len);
+void uart_cmd_slots_estop(UartCmdSlots *self, const PktTrace *trace);
+void uart_cmd_slots_merge(UartCmdSlots *self, const UartCmdSlotSet *set);
+bool uart_cmd_slots_take(UartCmdSlots *self, UartCmdSlotSet *taken, UartPacket *frame);
+void uart_cmd_slots_restore(UartCmdSlots *self, const UartCmdSlotSet *taken);
+
+#endif
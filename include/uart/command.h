@@ -0,0 +1,35 @@
+#ifndef UART_COMMAND_H
+#define UART_COMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart/packet.h"
+#include "uart/link.h"
+
+#define UART_CMD_NAME_MAX   24
+
+typedef struct {
+    const char      *name;
+    uint8_t         code;
+    const uint8_t   *args;
+    uint8_t         args_len;
+} UartCmdDef;
+const UartCmdDef *uart_cmd_find(const char *name, size_t name_len);
+
+typedef struct {
+    UartLink        *link;      // 目標埠 (destination port)
+    UartPacket      packets[UART_TRCV_BUF_CAP];
+    uint8_t         codes[UART_TRCV_BUF_CAP];
+    uint8_t         count;
+    uint16_t        cmds;
+    uint16_t        slotted;    // 進入槽位而非 FIFO 的命令數 (commands routed to slots instead of the FIFO)
+    UartCmdSlotSet  slots;
+    PktTrace        trace;
+} UartCmdBatch;
+void uart_cmd_batch_init(UartCmdBatch *self, UartLink *link);
+bool uart_cmd_batch_add(UartCmdBatch *self, uint8_t code, const uint8_t *args, uint8_t args_len);
+bool uart_cmd_batch_add_def(UartCmdBatch *self, const UartCmdDef *def);
+bool uart_cmd_batch_commit(UartCmdBatch *self);
+
+#endif
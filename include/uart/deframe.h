@@ -0,0 +1,56 @@
+#ifndef UART_DEFRAME_H
+#define UART_DEFRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart/packet.h"
+
+/**
+ * 把 UART 位元組串流切成 `{`…`}` 封包。一次讀取可能含多個封包，一個封包也可能跨兩次讀取。
+ * 資料為未跳脫的二進位，內容中也可能出現 `}`。已知格式的封包 (信用封包與數值回報) 依其自身長度判斷結尾：
+ * 紀錄邊界上的 `}` 是結尾，數值中的 `}` 是資料。其他封包或格式不符時，只有緊接 `{` 的 `}` 才是結尾；
+ * 位於讀取結尾的 `}` 先保留，等下一個位元組為 `{` 或短暫靜默 (uart_deframe_flush) 後才結束封包。
+ * Splits the UART byte stream into `{`…`}` frames. One read may carry several frames and one frame
+ * may span two reads. Payloads are unescaped binary that can contain `}`. Frames with a known
+ * layout (credits and value reports) end by their own length: a `}` on a record boundary ends the
+ * frame, a `}` inside a value is data. Other frames, or ones that stop matching their layout, end at
+ * a `}` followed by `{`; a `}` that is the last byte of a read stays open until the next byte is
+ * `{` or the line stays quiet for a short while (uart_deframe_flush).
+ */
+
+typedef enum {
+    UART_DEFRAME_FRAME,         // 完整封包 (a complete frame)
+    UART_DEFRAME_MALFORMED,     // 損壞的封包：過長或遺失起始碼，仍佔一個信用 (a damaged frame, too long or missing its start; still one credit)
+    UART_DEFRAME_NOISE,         // 封包之間的雜訊，不是封包 (noise between frames, not a frame)
+} UartDeframeEvent;
+
+typedef enum {
+    UART_DEFRAME_IDLE,
+    UART_DEFRAME_IN_FRAME,
+    UART_DEFRAME_IN_NOISE,
+} UartDeframeState;
+
+typedef enum {
+    UART_DEFRAME_LAYOUT_UNKNOWN,    // 只能靠 `}{` 與靜默判斷結尾 (the end is found by `}{` or silence only)
+    UART_DEFRAME_LAYOUT_CREDIT,     // {0x30 window consumed}
+    UART_DEFRAME_LAYOUT_REPORTS,    // {0x10 (motor kind value)...}
+} UartDeframeLayout;
+
+typedef struct {
+    uint8_t             buf[PACKET_MAX_SIZE];
+    uint16_t            len;
+    bool                overflow;
+    bool                end_pending;    // 讀取結尾的 `}` 尚未確定 (a `}` ending the last read is undecided)
+    UartDeframeState    state;
+    UartDeframeLayout   layout;
+    uint8_t             rec_pos;        // 目前紀錄已收的位元組數 (bytes of the current record so far)
+    uint8_t             rec_size;       // 目前紀錄的總長度，0 表示尚未知道 (size of the current record, 0 until known)
+} UartDeframer;
+
+#define UART_DEFRAMER_INIT { .state = UART_DEFRAME_IDLE }
+
+bool uart_deframe_next(UartDeframer *self, const uint8_t *data, uint16_t len, uint16_t *offset,
+    UartDeframeEvent *event, UartPacket *packet);
+bool uart_deframe_flush(UartDeframer *self, UartDeframeEvent *event, UartPacket *packet);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef UART_FLOW_H
+#define UART_FLOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart/packet.h"
+
+/**
+ * 站台與 STM32 之間的信用流量控制。雙方以 CMD_CODE_FLOW_CREDIT 封包
+ * {0x30, window, consumed} 宣告接收緩衝區容量與累計已取出的封包數 (mod 256)，
+ * 傳送端在途封包數 (sent - consumed) 達到 window 時暫停。信用封包本身不佔信用也不計數，
+ * 遺失的信用封包由下一次宣告修復；對方從未宣告時不限制傳送 (相容舊韌體)。
+ * Credit-based flow control between the station and the STM32. Each side sends
+ * CMD_CODE_FLOW_CREDIT frames {0x30, window, consumed} carrying its receive capacity and the
+ * running count (mod 256) of frames it has taken out; a sender pauses once its in-flight count
+ * (sent - consumed) reaches window. Credit frames neither use nor count credits, and a lost one
+ * is repaired by the next. A peer that never advertises is not throttled (older firmware).
+ */
+
+#define UART_FLOW_CREDIT_LEN    3
+
+typedef struct {
+    // 傳送方向：對方的接收窗口 (transmit side, the peer's receive window)
+    uint8_t         peer_window;    // 0 表示對方未宣告，不限制 (0 until the peer advertises, unthrottled)
+    uint8_t         peer_consumed;
+    uint8_t         sent;
+    uint32_t        blocked_us;     // 開始等待信用的時間，最低位元固定為 1，0 表示未阻塞 (bit 0 forced on, 0 when not blocked)
+    uint32_t        starve_us;      // 等待超過此時間即重新同步 (resync after waiting this long)
+    // 接收方向：本端的接收窗口 (receive side, our own window)
+    uint8_t         window;
+    uint8_t         consumed;
+    uint8_t         advertised;
+    uint32_t        advertised_us;
+    uint32_t        refresh_us;     // 無變化時重新宣告的間隔 (re-advertise interval when nothing changed)
+    bool            announced;
+    portMUX_TYPE    lock;
+} UartFlow;
+
+void uart_flow_init(UartFlow *self, uint8_t window, uint32_t starve_us, uint32_t refresh_us);
+bool uart_flow_on_credit(UartFlow *self, const uint8_t *data, uint16_t len);
+bool uart_flow_can_send(UartFlow *self, uint32_t now_us);
+void uart_flow_sent(UartFlow *self);
+void uart_flow_consumed(UartFlow *self, uint8_t count);
+bool uart_flow_credit_due(UartFlow *self, uint32_t now_us, UartPacket *frame);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef UART_LINK_H
+#define UART_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart/packet.h"
+#include "uart/cmd_slots.h"
+#include "uart/flow.h"
+#include "sdkconfig.h"
+
+/**
+ * 每個 UART 埠一個連線上下文：傳輸/接收佇列、命令槽位、信用流量控制與統計，
+ * 各埠由自己的 RX/TX 任務服務，互不阻塞。埠 0 為主要埠，其遙測進入站台快取與歷史紀錄。
+ * One link context per UART port: transmit/receive queues, command slots, credit flow control
+ * and statistics. Every port is served by its own RX/TX task pair so ports never block each
+ * other. Port 0 is the primary one; its telemetry feeds the station cache and history.
+ */
+
+#define UART_LINK_COUNT     CONFIG_STATION_UART_PORT_COUNT
+#define UART_LINK_PRIMARY   0
+
+typedef struct {
+    bool uart_transmit;
+    bool uart_transmit_pkt_proc;
+    bool uart_receive_pkt_proc;
+    bool right_speed;
+    bool right_adc;
+} TransceiveFlags;
+
+// 單一寫入者 (RX 或 TX 任務)，讀取端容許略舊的值 (one writer each, the RX or TX task; readers accept slightly old values)
+typedef struct {
+    uint32_t    rx_frames;
+    uint32_t    rx_bytes;
+    uint32_t    frame_errors;
+    uint32_t    tx_frames;
+    uint32_t    tx_bytes;
+    uint32_t    tx_errors;
+} UartLinkStats;
+
+typedef struct {
+    uint8_t         index;
+    bool            open;
+    UartTrcvBuf     tx_buf;
+    UartTrcvBuf     rx_buf;
+    UartCmdSlots    slots;
+    UartFlow        flow;
+    TransceiveFlags flags;
+    UartLinkStats   stats;
+    // 最早一個尚未處理的接收封包時間 (最低位元固定為 1)，0 表示沒有
+    // Read time of the oldest unprocessed frame with bit 0 forced on, 0 when none
+    uint32_t        rx_pending_us;
+} UartLink;
+
+extern UartLink uart_links[UART_LINK_COUNT];
+
+void uart_links_init(void);
+UartLink *uart_link_get(uint8_t index);
+
+#endif
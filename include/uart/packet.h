@@ -5,6 +5,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "vec_mod.h"
+#include "pkt_trace.h"
+#include "freertos/FreeRTOS.h"
 
 #define PACKET_START_CODE  ((uint8_t) '{')
 #define PACKET_END_CODE    ((uint8_t) '}')
@@ -19,6 +21,7 @@ typedef struct UartPacket {
     uint8_t     start;
     VecU8       datas;
     uint8_t     end;
+    PktTrace    trace;
 } UartPacket;
 bool uart_pkt_add_data(UartPacket *self, VecU8 *vec_u8);
 bool uart_pkt_get_data(const UartPacket *self, VecU8 *vec_u8);
@@ -34,13 +37,15 @@ typedef struct UartTrcvBuf {
     UartPacket  packets[UART_TRCV_BUF_CAP];
     uint8_t     head;
     uint8_t     len;
+    uint8_t     high_water;
+    uint32_t    drops;
+    portMUX_TYPE lock;
 } UartTrcvBuf;
+#define UART_TRCV_BUF_INIT { .lock = portMUX_INITIALIZER_UNLOCKED }
 bool uart_trcv_buf_push(UartTrcvBuf *self, const UartPacket *pkt);
-bool uart_trcv_buf_get_front(const UartTrcvBuf *self, UartPacket *pkt);
+bool uart_trcv_buf_push_all(UartTrcvBuf *self, const UartPacket *pkts, uint8_t count);
+bool uart_trcv_buf_get_front(UartTrcvBuf *self, UartPacket *pkt);
 bool uart_trcv_buf_pop_front(UartTrcvBuf *self, UartPacket *pkt);
 UartTrcvBuf uart_trcv_buf_new(void);
-extern UartTrcvBuf uart_trsm_pkt_buf;
-extern UartTrcvBuf uart_recv_pkt_buf;
-void uart_trcv_buf_init(void);
 
 #endif
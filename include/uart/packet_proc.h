@@ -4,8 +4,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "packet.h"
+#include "uart/link.h"
 
-void uart_transmit_pkt_proc(void);
-void uart_receive_pkt_proc(uint8_t count);
+void uart_transmit_pkt_proc(UartLink *link);
+void uart_receive_pkt_proc(UartLink *link, uint8_t count);
 
 #endif
@@ -0,0 +1,18 @@
+#ifndef UART_PORT_H
+#define UART_PORT_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+// ----------------------------------------------------------------------------------------------------
+
+/**
+ * UART 硬體存取層：ESP32 上使用 UART 驅動，Linux 目標 (模擬) 使用虛擬終端 (pty)。
+ * UART access layer: the UART driver on the ESP32, a pseudo-terminal on the Linux (simulation) target.
+ * port 為 0 起算的埠號，小於 CONFIG_STATION_UART_PORT_COUNT (port counts from 0, below CONFIG_STATION_UART_PORT_COUNT)
+ */
+bool uart_port_open(uint8_t port, uint32_t baud);
+int uart_port_write(uint8_t port, const uint8_t *data, size_t len);
+int uart_port_read(uint8_t port, uint8_t *buf, size_t cap, uint32_t timeout_ms);
+
+#endif
@@ -18,6 +18,7 @@ bool vec_u8_starts_with(const VecU8 *self, const uint8_t *pre, uint16_t pre_len)
 bool vec_u8_push(VecU8 *self, const void *src, uint16_t src_len);
 bool vec_u8_push_byte(VecU8 *self, uint8_t value);
 bool vec_u8_push_u16(VecU8 *self, uint16_t value);
+bool vec_u8_push_u32(VecU8 *self, uint32_t value);
 bool vec_u8_push_f32(VecU8 *self, float value);
 bool vec_u8_rm_range(VecU8 *self, uint16_t offset, uint16_t size);
 VecU8 vec_u8_new(void);
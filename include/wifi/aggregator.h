@@ -0,0 +1,32 @@
+#ifndef WIFI_AGGREGATOR_H
+#define WIFI_AGGREGATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vec_mod.h"
+
+// 預設最長保留時間，低負載時會自動縮短 (default hold deadline, shrinks automatically at low load)
+#define WIFI_AGGR_DEFAULT_DEADLINE_US   2000
+#define WIFI_AGGR_EWMA_SHIFT            3
+
+typedef bool (*WifiAggrBeginFn)(VecU8 *vec_u8);
+
+typedef struct {
+    VecU8           dgram;
+    WifiAggrBeginFn begin;
+    uint32_t        max_deadline_us;
+    uint32_t        deadline_us;
+    uint32_t        open_us;
+    uint32_t        last_us;
+    uint32_t        gap_ewma_us;
+    uint16_t        rec_ewma_len;
+    bool            open;
+    bool            has_last;
+} WifiAggr;
+void wifi_aggr_init(WifiAggr *self, WifiAggrBeginFn begin, uint32_t max_deadline_us);
+bool wifi_aggr_push(WifiAggr *self, uint8_t type, const uint8_t *payload, uint8_t len, uint32_t now_us, VecU8 *out);
+bool wifi_aggr_poll(WifiAggr *self, uint32_t now_us, VecU8 *out);
+bool wifi_aggr_flush(WifiAggr *self, VecU8 *out);
+uint32_t wifi_aggr_time_left(const WifiAggr *self, uint32_t now_us);
+
+#endif
@@ -1,6 +1,13 @@
 #ifndef WIFI_CONNECT_H
 #define WIFI_CONNECT_H
 
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#define WIFI_CONNECT_BACKOFF_MIN_MS     100
+#define WIFI_CONNECT_BACKOFF_MAX_MS     8000
+
 void wifi_connect_setup(void);
+bool wifi_connect_wait(TickType_t timeout);
 
 #endif
@@ -0,0 +1,117 @@
+#ifndef WIFI_DATAGRAM_H
+#define WIFI_DATAGRAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "vec_mod.h"
+
+/**
+ * 批次二進位 UDP 封包格式 (big-endian)
+ * Batched binary UDP datagram format (big-endian)
+ *
+ *  0       1        2      3          4..5   6..7   8..11
+ * +-------+--------+------+----------+------+------+----------+
+ * | magic | version| flags| rec_count| seq  | ack  | ack_bits |
+ * +-------+--------+------+----------+------+------+----------+
+ * 之後接 rec_count 筆紀錄 / followed by rec_count records:
+ * +------+-----+-------------+
+ * | type | len | payload[len]|
+ * +------+-----+-------------+
+ *
+ * seq      只有 RELIABLE 封包才遞增 (only advances for RELIABLE datagrams)
+ * ack      對方連續收到的最後一個 seq (cumulative ack of peer's reliable seq)
+ * ack_bits bit i 代表 ack+1+i 已收到 (bit i set => ack+1+i received, selective ack)
+ */
+
+#define WIFI_DGRAM_MAGIC            0xA7
+#define WIFI_DGRAM_VERSION          1
+#define WIFI_DGRAM_HEADER_SIZE      12
+#define WIFI_DGRAM_RECORD_HDR_SIZE  2
+// WifiPacket 以 VecU8 承載，單一封包上限即為其容量 (datagram bounded by the VecU8 carrier)
+#define WIFI_DGRAM_MAX_SIZE         VECU8_MAX_CAPACITY
+#define WIFI_DGRAM_MAX_PAYLOAD      (WIFI_DGRAM_MAX_SIZE - WIFI_DGRAM_HEADER_SIZE - WIFI_DGRAM_RECORD_HDR_SIZE)
+
+#define WIFI_DGRAM_FLAG_RELIABLE    0x01
+#define WIFI_DGRAM_FLAG_ACK         0x02
+
+#define WIFI_DGRAM_REC_CMD          0x01
+#define WIFI_DGRAM_REC_TELEMETRY    0x02
+// 查詢站台快取的遙測值：channel_mask u8 (0 為全部)，可選 max_age_ms u16
+// Query the station's telemetry cache: channel_mask u8 (0 = all), optional max_age_ms u16
+#define WIFI_DGRAM_REC_QUERY        0x03
+// 查詢回覆，內容格式見 telemetry_cache_encode (query reply, payload as in telemetry_cache_encode)
+#define WIFI_DGRAM_REC_SNAPSHOT     0x04
+// 指定 UART 埠的命令：port u8 後接與 REC_CMD 相同的內容；REC_CMD 即為埠 0
+// Command for a given UART port: port u8, then a REC_CMD payload; REC_CMD addresses port 0
+#define WIFI_DGRAM_REC_PORT_CMD         0x05
+// 埠 0 以外的遙測：port u8 後接與 REC_TELEMETRY 相同的內容
+// Telemetry from a port other than 0: port u8, then a REC_TELEMETRY payload
+#define WIFI_DGRAM_REC_PORT_TELEMETRY   0x06
+
+typedef struct {
+    uint8_t     version;
+    uint8_t     flags;
+    uint8_t     rec_count;
+    uint16_t    seq;
+    uint16_t    ack;
+    uint32_t    ack_bits;
+} WifiDgramHeader;
+
+typedef struct {
+    uint8_t         type;
+    uint8_t         len;
+    const uint8_t   *payload;
+} WifiDgramRecord;
+
+bool wifi_dgram_begin(VecU8 *vec_u8, const WifiDgramHeader *hdr);
+bool wifi_dgram_push_record(VecU8 *vec_u8, uint8_t type, const uint8_t *payload, uint8_t len);
+uint16_t wifi_dgram_room(const VecU8 *vec_u8);
+bool wifi_dgram_parse_header(const uint8_t *buf, uint16_t len, WifiDgramHeader *hdr);
+bool wifi_dgram_next_record(const uint8_t *buf, uint16_t len, uint16_t *offset, WifiDgramRecord *rec);
+
+// ----------------------------------------------------------------------------------------------------
+
+/**
+ * 傳送端的重送視窗，供送出可靠控制命令的一方 (控制端) 使用；站台只接收可靠封包，不連結這一半
+ * Sender-side retransmit window for whoever sends reliable control commands (the controller);
+ * the station only receives reliable datagrams and does not link this half
+ */
+#define WIFI_DGRAM_TX_WINDOW        8
+#define WIFI_DGRAM_RTO_US           20000
+#define WIFI_DGRAM_MAX_TRIES        5
+
+typedef struct {
+    VecU8       dgram;
+    uint32_t    sent_us;
+    uint16_t    seq;
+    uint8_t     tries;
+    bool        used;
+} WifiDgramTxSlot;
+
+typedef struct {
+    WifiDgramTxSlot slots[WIFI_DGRAM_TX_WINDOW];
+    uint16_t        next_seq;
+} WifiDgramTxWindow;
+WifiDgramTxWindow wifi_dgram_tx_window_new(void);
+bool wifi_dgram_tx_reserve(WifiDgramTxWindow *self, uint16_t *seq);
+bool wifi_dgram_tx_track(WifiDgramTxWindow *self, uint16_t seq, const VecU8 *dgram, uint32_t now_us);
+bool wifi_dgram_tx_release(WifiDgramTxWindow *self, uint16_t seq);
+uint8_t wifi_dgram_tx_on_ack(WifiDgramTxWindow *self, uint16_t ack, uint32_t ack_bits);
+bool wifi_dgram_tx_next_due(WifiDgramTxWindow *self, uint32_t now_us, VecU8 *dgram, bool *expired);
+uint32_t wifi_dgram_tx_time_left(const WifiDgramTxWindow *self, uint32_t now_us);
+
+typedef enum {
+    WIFI_DGRAM_RX_NEW,
+    WIFI_DGRAM_RX_DUPLICATE,
+} WifiDgramRxResult;
+
+typedef struct {
+    uint16_t    ack;
+    uint32_t    ack_bits;
+    bool        synced;
+} WifiDgramRxWindow;
+WifiDgramRxWindow wifi_dgram_rx_window_new(void);
+WifiDgramRxResult wifi_dgram_rx_check(const WifiDgramRxWindow *self, uint16_t seq);
+WifiDgramRxResult wifi_dgram_rx_accept(WifiDgramRxWindow *self, uint16_t seq);
+
+#endif
@@ -1,13 +1,17 @@
 #ifndef WIFI_PACKET_MOD_H
 #define WIFI_PACKET_MOD_H
 
+#include <stddef.h>
 #include "vec_mod.h"
-#include "esp_netif.h"
+#include "pkt_trace.h"
+#include "freertos/FreeRTOS.h"
 #include "lwip/ip4_addr.h"
 
 typedef struct {
     ip4_addr_t ip;
+    uint16_t port;      // 對端 UDP 埠，主機位元組序；TCP 未使用 (peer UDP port in host byte order, unused by TCP)
     VecU8 data;
+    PktTrace trace;
 } WifiPacket;
 WifiPacket wifi_packet_new(const ip4_addr_t *ip, const VecU8 *vec_u8);
 VecU8 wifi_packet_get_data(const WifiPacket *packet);
@@ -20,7 +24,11 @@ typedef struct {
     WifiPacket  packet[WIFI_TRCV_BUF_CAP];
     uint8_t     head;
     uint8_t     length;
+    uint8_t     high_water;
+    uint32_t    drops;
+    portMUX_TYPE lock;
 } WifiTrcvBuf;
+#define WIFI_TRCV_BUF_INIT { .lock = portMUX_INITIALIZER_UNLOCKED }
 extern WifiTrcvBuf wifi_tcp_transmit_buffer;
 extern WifiTrcvBuf wifi_udp_transmit_buffer;
 extern WifiTrcvBuf wifi_tcp_receive_buffer;
@@ -29,5 +37,8 @@ WifiTrcvBuf wifi_trcv_buffer_new(void);
 bool wifi_trcv_buffer_get_front(WifiTrcvBuf *buffer, WifiPacket *packet);
 bool wifi_trcv_buffer_push(WifiTrcvBuf *buffer, const WifiPacket *packet);
 bool wifi_trcv_buffer_pop(WifiTrcvBuf *buffer, WifiPacket *packet);
+WifiPacket *wifi_trcv_buffer_reserve(WifiTrcvBuf *buffer);
+void wifi_trcv_buffer_commit(WifiTrcvBuf *buffer);
+WifiPacket *wifi_trcv_buffer_front(WifiTrcvBuf *buffer);
 
 #endif
@@ -3,4 +3,6 @@
 
 #include "wifi/packet.h"
 
+void wifi_udp_receive_pkt_proc(void);
+
 #endif
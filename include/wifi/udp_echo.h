@@ -0,0 +1,6 @@
+#ifndef WIFI_UDP_ECHO_H
+#define WIFI_UDP_ECHO_H
+
+void wifi_udp_echo_task(void *pvParameters);
+
+#endif
@@ -2,7 +2,18 @@
 #define WIFI_UDP_TRCV_H
 
 #include "wifi/packet.h"
+#include "wifi/datagram.h"
 
+void wifi_udp_setup(void);
+void wifi_udp_read_task(void *pvParameters);
+bool wifi_udp_accept_header(const WifiDgramHeader *hdr);
+void wifi_udp_confirm_header(const WifiDgramHeader *hdr);
+void wifi_udp_send_ack(const ip4_addr_t *ip, uint16_t port);
+void wifi_udp_send_snapshot(const ip4_addr_t *ip, uint16_t port, const uint8_t *payload, uint8_t len);
+bool wifi_udp_dgram_begin(VecU8 *vec_u8);
+bool wifi_udp_dgram_submit(const VecU8 *vec_u8, const PktTrace *trace);
+void wifi_udp_telemetry_push(uint8_t port, const uint8_t *payload, uint8_t len, const PktTrace *trace);
+uint32_t wifi_udp_aggr_time_left(void);
 void wifi_udp_write_task(void);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,144 @@
+#include "boot.h"
+// ----------------------------------------------------------------------------------------------------
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
+
+static const char *TAG = "boot";
+
+typedef struct {
+    BootReadyFn     fn;
+    void            *arg;
+    BootStage       stage;
+} BootReadyCb;
+
+static const char *const boot_stage_names[BOOT_STAGE_COUNT] = {
+    [BOOT_STAGE_NVS]  = "nvs",
+    [BOOT_STAGE_UART] = "uart",
+    [BOOT_STAGE_WIFI] = "wifi",
+    [BOOT_STAGE_HTTP] = "http",
+};
+
+static StaticEventGroup_t boot_event_group_buf;
+static EventGroupHandle_t boot_event_group = NULL;
+static portMUX_TYPE boot_lock = portMUX_INITIALIZER_UNLOCKED;
+static BootReadyCb boot_callbacks[BOOT_READY_CB_MAX];
+static uint8_t boot_callback_count = 0;
+static uint32_t boot_ready_bits = 0;
+static uint32_t boot_stage_ms[BOOT_STAGE_COUNT];
+
+/**
+ * @brief 建立啟動狀態，須在任何服務啟動前呼叫
+ *        Create the boot state; call before any service starts
+ */
+void boot_init(void) {
+    if (boot_event_group == NULL) {
+        boot_event_group = xEventGroupCreateStatic(&boot_event_group_buf);
+    }
+}
+
+/**
+ * @brief 初始化 NVS，分割區已滿或版本不符時清除後重試
+ *        Initialize NVS, erasing and retrying when the partition is full or from a newer layout
+ */
+void boot_nvs_setup(void) {
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+    boot_mark_ready(BOOT_STAGE_NVS);
+}
+
+/**
+ * @brief 註冊就緒回呼；該階段已就緒時立即在呼叫端執行
+ *        Register a readiness callback; runs right away on the caller when the stage is already up
+ *
+ * @note 回呼在標記就緒的任務中執行 (例如 Wi-Fi 事件任務)，不可長時間阻塞
+ *       Callbacks run on the task that marks the stage ready (e.g. the Wi-Fi event task), keep them short
+ *
+ * @return false 回呼表已滿 (callback table full)
+ */
+bool boot_on_ready(BootStage stage, BootReadyFn fn, void *arg) {
+    if (stage >= BOOT_STAGE_COUNT || fn == NULL) return 0;
+    bool run_now = false;
+    bool stored  = true;
+    taskENTER_CRITICAL(&boot_lock);
+    if (boot_ready_bits & (1UL << stage)) {
+        run_now = true;
+    } else if (boot_callback_count < BOOT_READY_CB_MAX) {
+        boot_callbacks[boot_callback_count++] = (BootReadyCb){ fn, arg, stage };
+    } else {
+        stored = false;
+    }
+    taskEXIT_CRITICAL(&boot_lock);
+    if (run_now) fn(stage, arg);
+    return stored;
+}
+
+/**
+ * @brief 標記階段就緒並執行等待中的回呼，重複標記不會再次觸發
+ *        Mark a stage ready and run its pending callbacks; marking it again is a no-op
+ */
+void boot_mark_ready(BootStage stage) {
+    if (stage >= BOOT_STAGE_COUNT) return;
+    BootReadyCb pending[BOOT_READY_CB_MAX];
+    uint8_t pending_count = 0;
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    taskENTER_CRITICAL(&boot_lock);
+    if (boot_ready_bits & (1UL << stage)) {
+        taskEXIT_CRITICAL(&boot_lock);
+        return;
+    }
+    boot_ready_bits |= 1UL << stage;
+    boot_stage_ms[stage] = now_ms;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < boot_callback_count; i++) {
+        if (boot_callbacks[i].stage == stage) {
+            pending[pending_count++] = boot_callbacks[i];
+        } else {
+            boot_callbacks[kept++] = boot_callbacks[i];
+        }
+    }
+    boot_callback_count = kept;
+    taskEXIT_CRITICAL(&boot_lock);
+
+    ESP_LOGI(TAG, "%s ready at %lu ms", boot_stage_names[stage], (unsigned long)now_ms);
+    if (boot_event_group != NULL) {
+        xEventGroupSetBits(boot_event_group, 1UL << stage);
+    }
+    for (uint8_t i = 0; i < pending_count; i++) {
+        pending[i].fn(stage, pending[i].arg);
+    }
+}
+
+bool boot_is_ready(BootStage stage) {
+    if (stage >= BOOT_STAGE_COUNT) return 0;
+    return (__atomic_load_n(&boot_ready_bits, __ATOMIC_RELAXED) & (1UL << stage)) != 0;
+}
+
+/**
+ * @brief 等待階段就緒
+ *        Block until a stage is ready
+ *
+ * @return true 已就緒 (ready)
+ */
+bool boot_wait(BootStage stage, TickType_t timeout) {
+    if (stage >= BOOT_STAGE_COUNT || boot_event_group == NULL) return 0;
+    EventBits_t bits = xEventGroupWaitBits(boot_event_group, 1UL << stage, pdFALSE, pdTRUE, timeout);
+    return (bits & (1UL << stage)) != 0;
+}
+
+/**
+ * @brief 階段就緒時距開機的時間
+ *        Time since reset at which a stage became ready
+ *
+ * @return uint32_t 毫秒；尚未就緒時為 0 (ms, 0 while not ready)
+ */
+uint32_t boot_ready_ms(BootStage stage) {
+    if (!boot_is_ready(stage)) return 0;
+    return boot_stage_ms[stage];
+}
@@ -0,0 +1,134 @@
+#include "capture.h"
+// ----------------------------------------------------------------------------------------------------
+#include "metrics.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static uint8_t capture_ring[CAPTURE_RING_SIZE];
+static uint32_t capture_head = 0;       // 下一筆寫入位置 (next write offset)
+static uint32_t capture_tail = 0;       // 最舊紀錄位置 (offset of the oldest record)
+static uint32_t capture_used = 0;
+static uint32_t capture_records = 0;
+static uint32_t capture_dropped = 0;
+static bool capture_frozen = false;
+#if CONFIG_STATION_CAPTURE_AUTOSTART
+static bool capture_on = true;
+#else
+static bool capture_on = false;
+#endif
+static portMUX_TYPE capture_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void capture_ring_write(const void *src, uint32_t len) {
+    uint32_t first = CAPTURE_RING_SIZE - capture_head;
+    if (first > len) first = len;
+    memcpy(capture_ring + capture_head, src, first);
+    memcpy(capture_ring, (const uint8_t *)src + first, len - first);
+    capture_head = (capture_head + len) % CAPTURE_RING_SIZE;
+    capture_used += len;
+}
+
+/**
+ * @brief 移除最舊的一筆紀錄
+ *        Evict the oldest record
+ */
+static void capture_ring_evict(void) {
+    CaptureRecordHeader hdr;
+    uint8_t *dst = (uint8_t *)&hdr;
+    for (uint32_t i = 0; i < sizeof(hdr); i++) {
+        dst[i] = capture_ring[(capture_tail + i) % CAPTURE_RING_SIZE];
+    }
+    uint32_t size = sizeof(hdr) + hdr.stored;
+    capture_tail = (capture_tail + size) % CAPTURE_RING_SIZE;
+    capture_used -= size;
+    capture_records--;
+}
+
+void capture_set_enabled(bool enabled) {
+    __atomic_store_n(&capture_on, enabled, __ATOMIC_RELAXED);
+}
+
+bool capture_enabled(void) {
+    return __atomic_load_n(&capture_on, __ATOMIC_RELAXED);
+}
+
+void capture_clear(void) {
+    taskENTER_CRITICAL(&capture_lock);
+    if (!capture_frozen) {
+        capture_head = 0;
+        capture_tail = 0;
+        capture_used = 0;
+        capture_records = 0;
+        capture_dropped = 0;
+    }
+    taskEXIT_CRITICAL(&capture_lock);
+}
+
+/**
+ * @brief 記錄一筆流量，空間不足時覆蓋最舊的紀錄
+ *        Record one chunk of traffic, overwriting the oldest records when the ring is full
+ *
+ * @param source 流量來源 (traffic source)
+ * @param data 原始位元組 (raw bytes)
+ * @param len 原始長度，超過 CAPTURE_RECORD_MAX 的部分不保存 (original length, bytes past CAPTURE_RECORD_MAX are not kept)
+ *
+ * @note 未啟用時只有一次原子讀取；匯出期間 (凍結) 的紀錄計入 dropped
+ *       Costs one atomic load when disabled; records arriving during a dump (frozen) count as dropped
+ */
+void capture_record(CaptureSource source, const uint8_t *data, uint16_t len) {
+    if (!capture_enabled() || source >= CAPTURE_SRC_COUNT) return;
+    CaptureRecordHeader hdr = {
+        .t_us   = (uint32_t)esp_timer_get_time(),
+        .len    = len,
+        .source = source,
+        .stored = len > CAPTURE_RECORD_MAX ? CAPTURE_RECORD_MAX : len,
+    };
+    uint32_t size = sizeof(hdr) + hdr.stored;
+    taskENTER_CRITICAL(&capture_lock);
+    if (capture_frozen) {
+        capture_dropped++;
+        taskEXIT_CRITICAL(&capture_lock);
+        metrics_inc(METRIC_CAPTURE_DROPS);
+        return;
+    }
+    while (CAPTURE_RING_SIZE - capture_used < size) {
+        capture_ring_evict();
+    }
+    capture_ring_write(&hdr, sizeof(hdr));
+    capture_ring_write(data, hdr.stored);
+    capture_records++;
+    taskEXIT_CRITICAL(&capture_lock);
+    metrics_inc(METRIC_CAPTURE_RECORDS);
+}
+
+/**
+ * @brief 凍結環形緩衝區以便匯出，直到 capture_thaw 前內容不會改變
+ *        Freeze the ring for a dump; its contents stay put until capture_thaw
+ *
+ * @param view 輸出目前內容的兩段位置 (receives the one or two pieces holding the contents)
+ *
+ * @note 由單一匯出者 (httpd 任務) 呼叫 (called by a single dumper, the httpd task)
+ */
+void capture_freeze(CaptureView *view) {
+    taskENTER_CRITICAL(&capture_lock);
+    capture_frozen = true;
+    uint32_t tail = capture_tail;
+    uint32_t used = capture_used;
+    view->records = capture_records;
+    view->dropped = capture_dropped;
+    taskEXIT_CRITICAL(&capture_lock);
+
+    uint32_t first = CAPTURE_RING_SIZE - tail;
+    if (first > used) first = used;
+    view->part[0] = capture_ring + tail;
+    view->part_len[0] = first;
+    view->part[1] = capture_ring;
+    view->part_len[1] = used - first;
+}
+
+void capture_thaw(void) {
+    taskENTER_CRITICAL(&capture_lock);
+    capture_frozen = false;
+    taskEXIT_CRITICAL(&capture_lock);
+}
+
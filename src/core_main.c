@@ -19,23 +19,53 @@
 #include "uart/packet.h"
 #include "esp_http_server.h"
 #include "http/server.h"
+#include "boot.h"
+#include "dispatcher.h"
+#include "telemetry/cache.h"
+#include "telemetry/history.h"
 
 static const char *TAG = "core main";
 
+/**
+ * @brief 取得 IP 後啟動網路服務 (在分派任務中執行一次)
+ *        Start the network services once the station has an IP (runs once on the dispatcher task)
+ */
+static void core_network_start(EventBits_t events, void *arg) {
+    static bool started = false;
+    if (started) return;
+    started = true;
+    wifi_transceive_setup();
+    httpd_handle_t server = http_start_webserver();
+    if (server != NULL) {
+        boot_mark_ready(BOOT_STAGE_HTTP);
+    }
+}
+
+/**
+ * @brief Wi-Fi 就緒回呼：在 Wi-Fi 事件任務中執行，只把啟動工作轉交分派任務
+ *        Wi-Fi readiness callback: runs on the Wi-Fi event task and only hands start-up to the dispatcher
+ */
+static void core_network_ready(BootStage stage, void *arg) {
+    dispatcher_post(DISPATCH_EV_NET_START);
+}
+
+/**
+ * @brief 非同步啟動：NVS 與 UART 控制路徑先行，Wi-Fi 在背景連線
+ *        Asynchronous boot: NVS and the UART control path come up first, Wi-Fi associates in the background
+ *
+ * @note 週期與事件工作都由分派任務執行，啟動完成後直接返回
+ *       Periodic and reactive work all run on the dispatcher task, so this returns once boot is kicked off
+ */
 void core_main(void) {
-    wifi_connect_setup();
-    // wifi_transceive_setup();
+    boot_init();
+    boot_nvs_setup();
+    dispatcher_setup();
+    telemetry_cache_setup();
+    telemetry_history_setup();
     uart_setup();
-    // httpd_handle_t server = http_start_webserver();
-    VecU8 vec = vec_u8_new();
-    vec_u8_push(&vec, "1234", 4);
-    UartPacket pkt = uart_packet_new();
-    uart_pkt_add_data(&pkt, &vec);
-    while (1) {
-        // ESP_LOGI(TAG, "Running main loop...");
-        // uart_trsm_buf.push(&uart_trsm_buf, &pkt);
-        // wifi_udp_write_task();
-        // wifi_tcp_write_task();
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
+    boot_mark_ready(BOOT_STAGE_UART);
+    dispatcher_register(DISPATCH_EV_NET_START, core_network_start, NULL);
+    boot_on_ready(BOOT_STAGE_WIFI, core_network_ready, NULL);
+    wifi_connect_setup();
+    ESP_LOGI(TAG, "Boot started, main task exits");
 }
@@ -0,0 +1,155 @@
+#include "dispatcher.h"
+// ----------------------------------------------------------------------------------------------------
+#include "task_layout.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "dispatcher";
+
+typedef struct {
+    DispatchHandlerFn   fn;
+    void                *arg;
+    EventBits_t         events;
+} DispatchHandler;
+
+typedef struct {
+    DispatchDeadlineFn  fn;
+    void                *arg;
+} DispatchDeadline;
+
+static StaticEventGroup_t dispatch_event_group_buf;
+static EventGroupHandle_t dispatch_event_group = NULL;
+static portMUX_TYPE dispatch_lock = portMUX_INITIALIZER_UNLOCKED;
+// 表項寫入後才增加計數，分派任務只讀取計數以內的表項 (entries are filled before the count grows)
+static DispatchHandler dispatch_handlers[DISPATCH_HANDLER_MAX];
+static uint8_t dispatch_handler_count = 0;
+static DispatchDeadline dispatch_deadlines[DISPATCH_DEADLINE_MAX];
+static uint8_t dispatch_deadline_count = 0;
+// 只在分派任務中存取 (accessed from the dispatcher task only)
+static esp_timer_handle_t dispatch_timer = NULL;
+static int64_t dispatch_timer_due_us = 0;
+
+static void dispatch_timer_cb(void *arg) {
+    dispatcher_post(DISPATCH_EV_TIMER);
+}
+
+/**
+ * @brief 執行所有期限函式，並把計時器排到最近的期限
+ *        Run every deadline function and arm the timer for the nearest deadline
+ *
+ * @note FreeRTOS tick 為 10 ms，期限改用 esp_timer 才能達到微秒級精度
+ *       The FreeRTOS tick is 10 ms, so deadlines use esp_timer for microsecond resolution
+ */
+static void dispatcher_run_deadlines(void) {
+    taskENTER_CRITICAL(&dispatch_lock);
+    uint8_t count = dispatch_deadline_count;
+    taskEXIT_CRITICAL(&dispatch_lock);
+
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    uint32_t wait_us = UINT32_MAX;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t left = dispatch_deadlines[i].fn(now_us, dispatch_deadlines[i].arg);
+        if (left < wait_us) wait_us = left;
+    }
+    esp_timer_stop(dispatch_timer);
+    if (wait_us == UINT32_MAX) {
+        dispatch_timer_due_us = 0;
+        return;
+    }
+    if (wait_us < DISPATCH_MIN_WAIT_US) wait_us = DISPATCH_MIN_WAIT_US;
+    dispatch_timer_due_us = esp_timer_get_time() + wait_us;
+    esp_timer_start_once(dispatch_timer, wait_us);
+}
+
+static void dispatcher_task(void *arg) {
+    ESP_LOGI(TAG, "Dispatcher task start");
+    while (1) {
+        EventBits_t events = xEventGroupWaitBits(
+            dispatch_event_group, DISPATCH_EV_ALL, pdTRUE, pdFALSE, portMAX_DELAY
+        );
+        if ((events & DISPATCH_EV_TIMER) && dispatch_timer_due_us != 0) {
+            int64_t late_us = esp_timer_get_time() - dispatch_timer_due_us;
+            metrics_observe(METRIC_HIST_DISPATCH_TIMER_LATE_US, late_us > 0 ? (uint32_t)late_us : 0);
+        }
+
+        taskENTER_CRITICAL(&dispatch_lock);
+        uint8_t count = dispatch_handler_count;
+        taskEXIT_CRITICAL(&dispatch_lock);
+        for (uint8_t i = 0; i < count; i++) {
+            DispatchHandler *handler = &dispatch_handlers[i];
+            if (events & handler->events) handler->fn(events & handler->events, handler->arg);
+        }
+        dispatcher_run_deadlines();
+    }
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief 建立事件群組、計時器並啟動分派任務，須在任何生產者啟動前呼叫
+ *        Create the event group and timer and start the dispatcher task; call before any producer starts
+ */
+void dispatcher_setup(void) {
+    if (dispatch_event_group != NULL) return;
+    dispatch_event_group = xEventGroupCreateStatic(&dispatch_event_group_buf);
+    const esp_timer_create_args_t timer_args = {
+        .callback = dispatch_timer_cb,
+        .name     = "dispatch",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &dispatch_timer));
+    task_layout_spawn(TASK_ID_DISPATCHER, dispatcher_task, NULL);
+}
+
+/**
+ * @brief 註冊事件處理函式；處理函式在分派任務中執行，不可阻塞
+ *        Register an event handler; it runs on the dispatcher task and must not block
+ *
+ * @param events 關注的事件位元 (DISPATCH_EV_* bits to handle)
+ * @return false 處理表已滿 (handler table full)
+ */
+bool dispatcher_register(EventBits_t events, DispatchHandlerFn fn, void *arg) {
+    if (fn == NULL || events == 0) return 0;
+    bool stored = false;
+    taskENTER_CRITICAL(&dispatch_lock);
+    if (dispatch_handler_count < DISPATCH_HANDLER_MAX) {
+        dispatch_handlers[dispatch_handler_count] = (DispatchHandler){ fn, arg, events };
+        dispatch_handler_count++;
+        stored = true;
+    }
+    taskEXIT_CRITICAL(&dispatch_lock);
+    if (!stored) ESP_LOGE(TAG, "Handler table full");
+    return stored;
+}
+
+/**
+ * @brief 註冊期限函式，下一次喚醒時開始生效
+ *        Register a deadline function; it takes effect from the next wakeup
+ *
+ * @return false 期限表已滿 (deadline table full)
+ */
+bool dispatcher_register_deadline(DispatchDeadlineFn fn, void *arg) {
+    if (fn == NULL) return 0;
+    bool stored = false;
+    taskENTER_CRITICAL(&dispatch_lock);
+    if (dispatch_deadline_count < DISPATCH_DEADLINE_MAX) {
+        dispatch_deadlines[dispatch_deadline_count] = (DispatchDeadline){ fn, arg };
+        dispatch_deadline_count++;
+        stored = true;
+    }
+    taskEXIT_CRITICAL(&dispatch_lock);
+    if (!stored) {
+        ESP_LOGE(TAG, "Deadline table full");
+    } else {
+        dispatcher_post(DISPATCH_EV_TIMER);
+    }
+    return stored;
+}
+
+/**
+ * @brief 喚醒分派任務 (任務環境)
+ *        Wake the dispatcher for the given events (task context)
+ */
+void dispatcher_post(EventBits_t events) {
+    if (dispatch_event_group == NULL) return;
+    xEventGroupSetBits(dispatch_event_group, events);
+}
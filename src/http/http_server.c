@@ -1,15 +1,39 @@
 #include "http/server.h"
 #include "http/base.h"
+#include "metrics.h"
+#include "task_layout.h"
+#include "sdkconfig.h"
 #include "esp_log.h"
+#include "lwip/sockets.h"
 #include <string.h>
 
 static const char *TAG = "http_server_example";
 
+/* 每個新連線計數一次 (count every opened session) */
+static esp_err_t http_session_open(httpd_handle_t server, int sockfd)
+{
+    metrics_inc(METRIC_HTTP_SESSIONS);
+    return ESP_OK;
+}
+
+/* 連線關閉時清除其狀態；設定 close_fn 後 socket 由此處關閉 (clear per-session state; with close_fn set the socket is closed here) */
+static void http_session_close(httpd_handle_t server, int sockfd)
+{
+    ws_telemetry_session_closed(sockfd);
+    close(sockfd);
+}
+
 /* ----- 3. 啟動 HTTP Server，註冊 URI ----- */
 httpd_handle_t http_start_webserver(void)
 {
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.open_fn = http_session_open;
+    config.close_fn = http_session_close;
+    config.max_uri_handlers = 17;
+    config.uri_match_fn = httpd_uri_match_wildcard;
+    config.core_id = TASK_CORE_NETWORK;
+    config.server_port = CONFIG_STATION_HTTP_PORT;
 
     // 啟動伺服器
     if (httpd_start(&server, &config) == ESP_OK) {
@@ -17,6 +41,17 @@ httpd_handle_t http_start_webserver(void)
         httpd_register_uri_handler(server, &hello_get_uri);
         httpd_register_uri_handler(server, &hello_post_uri);
         httpd_register_uri_handler(server, &echo_uri);
+        httpd_register_uri_handler(server, &ws_telemetry_uri);
+        httpd_register_uri_handler(server, &metrics_uri);
+        httpd_register_uri_handler(server, &cmd_uri);
+        httpd_register_uri_handler(server, &tasks_uri);
+        httpd_register_uri_handler(server, &trace_uri);
+        httpd_register_uri_handler(server, &capture_get_uri);
+        httpd_register_uri_handler(server, &capture_post_uri);
+        httpd_register_uri_handler(server, &telemetry_uri);
+        httpd_register_uri_handler(server, &history_uri);
+        httpd_register_uri_handler(server, &assets_uri);
+        ws_telemetry_attach(server);
         ESP_LOGI(TAG, "HTTP Server Started");
         return server;
     }
@@ -0,0 +1,45 @@
+#include "http/stream.h"
+#include "esp_log.h"
+
+static const char *TAG = "http_stream";
+
+/**
+ * @brief 固定大小的 body 接收緩衝
+ *        Fixed-size request body chunk buffer
+ *
+ * @note httpd 以單一任務依序處理連線上的請求，因此同一時間只有一個連線在使用
+ *       httpd serves requests one at a time on a single task, so only the connection
+ *       currently being handled owns it
+ */
+static uint8_t http_stream_chunk[HTTP_STREAM_CHUNK_SIZE];
+
+/**
+ * @brief 以固定緩衝逐段讀取請求 body 並交給 consume，記憶體用量與 body 大小無關
+ *        Read the request body through a fixed chunk buffer and feed it to consume piece by piece;
+ *        memory use does not depend on the body size
+ *
+ * @param req 目前的請求 (current request)
+ * @param consume 每段資料的處理函式，回傳非 ESP_OK 會中止讀取 (called per chunk, non-ESP_OK aborts)
+ * @param ctx 傳給 consume 的參數 (opaque argument for consume)
+ * @return esp_err_t ESP_OK 表示 body 已全部處理 (ESP_OK once the whole body was consumed)
+ */
+esp_err_t http_body_stream(httpd_req_t *req, HttpBodyConsumer consume, void *ctx) {
+    size_t remaining = req->content_len;
+    uint8_t retries = 0;
+    while (remaining > 0) {
+        size_t want = remaining < sizeof(http_stream_chunk) ? remaining : sizeof(http_stream_chunk);
+        int ret = httpd_req_recv(req, (char *)http_stream_chunk, want);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT && retries++ < HTTP_STREAM_RECV_RETRY) {
+            continue;
+        }
+        if (ret <= 0) {
+            ESP_LOGE(TAG, "Failed to receive body, %u bytes left", (unsigned)remaining);
+            return ESP_FAIL;
+        }
+        retries = 0;
+        esp_err_t err = consume(req, http_stream_chunk, ret, ctx);
+        if (err != ESP_OK) return err;
+        remaining -= ret;
+    }
+    return ESP_OK;
+}
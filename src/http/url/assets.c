@@ -0,0 +1,144 @@
+#include "http/base.h"
+#include "http/assets.h"
+#include "esp_log.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "http_assets";
+
+#define HTTP_ASSET_INDEX        "/index.html"
+#define HTTP_ASSET_HDR_MAX      128
+
+/**
+ * @brief 依路徑查詢內嵌資源
+ *        Look an embedded asset up by path
+ *
+ * @return const HttpAsset* 找不到時為 NULL (NULL when unknown)
+ */
+const HttpAsset *http_asset_find(const char *path, size_t path_len) {
+    for (size_t i = 0; i < http_assets_count; i++) {
+        const HttpAsset *asset = &http_assets[i];
+        if (strlen(asset->path) == path_len && memcmp(asset->path, path, path_len) == 0) {
+            return asset;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief If-None-Match 清單中是否有與資源相符的 ETag；W/ 前綴以弱比較忽略，"*" 符合任何資源
+ *        Whether the If-None-Match list names the asset's ETag; W/ prefixes are ignored (weak
+ *        comparison) and "*" matches any asset
+ *
+ * @note 截斷的標頭只比對完整的項目 (a truncated header only matches complete entries)
+ */
+static bool assets_etag_listed(const char *list, const char *etag) {
+    size_t etag_len = strlen(etag);
+    const char *p = list;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        if (*p == '*') return 1;
+        if (p[0] == 'W' && p[1] == '/') p += 2;
+        if (*p != '"') {
+            // 不合法的項目，跳到下一個逗號 (malformed entry, skip to the next comma)
+            p += strcspn(p, ",");
+            continue;
+        }
+        const char *end = strchr(p + 1, '"');
+        if (end == NULL) return 0;
+        size_t len = (size_t)(end - p) + 1;
+        if (len == etag_len && memcmp(p, etag, len) == 0) return 1;
+        p = end + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Accept-Encoding 是否接受 gzip；未明列 gzip 時看 "*"，q=0 表示拒絕
+ *        Whether Accept-Encoding allows gzip; "*" applies when gzip is not listed, q=0 refuses
+ */
+static bool assets_accepts_gzip(const char *value) {
+    int gzip = -1, any = -1;
+    const char *p = value;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',') p++;
+        size_t token_len = strcspn(p, " \t;,");
+        const char *token = p;
+        p += token_len;
+        // q 值的任一非零數字表示接受 (any non-zero digit in the q value accepts)
+        int accepted = 1;
+        size_t params_len = strcspn(p, ",");
+        for (size_t i = 0; i + 1 < params_len; i++) {
+            if (tolower((unsigned char)p[i]) == 'q' && p[i + 1] == '=') {
+                accepted = 0;
+                for (size_t j = i + 2; j < params_len && (isdigit((unsigned char)p[j]) || p[j] == '.'); j++) {
+                    if (p[j] >= '1' && p[j] <= '9') accepted = 1;
+                }
+                break;
+            }
+        }
+        p += params_len;
+        if (
+            (token_len == 4 && strncasecmp(token, "gzip", 4) == 0) ||
+            (token_len == 6 && strncasecmp(token, "x-gzip", 6) == 0)
+        ) {
+            gzip = accepted;
+        } else if (token_len == 1 && token[0] == '*') {
+            any = accepted;
+        }
+    }
+    return (gzip >= 0) ? gzip : (any > 0);
+}
+
+/* ----- GET 任意路徑：直接由 flash 以 chunk 送出預先壓縮的資源 (send pre-gzipped assets from flash in chunks) ----- */
+static esp_err_t assets_get_handler(httpd_req_t *req) {
+    size_t path_len = strcspn(req->uri, "?#");
+    const HttpAsset *asset = (path_len == 1)
+        ? http_asset_find(HTTP_ASSET_INDEX, strlen(HTTP_ASSET_INDEX))
+        : http_asset_find(req->uri, path_len);
+    if (asset == NULL) {
+        httpd_resp_send_404(req);
+        return ESP_OK;
+    }
+
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    char header[HTTP_ASSET_HDR_MAX];
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "If-None-Match", header, sizeof(header));
+    if ((err == ESP_OK || err == ESP_ERR_HTTPD_RESULT_TRUNC) && assets_etag_listed(header, asset->etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    // 只有壓縮後的內容，不接受 gzip 的用戶端回 406；沒有此標頭表示任何編碼皆可
+    // Only the gzipped bytes exist, so a client refusing gzip gets 406; no header means any coding is fine
+    err = httpd_req_get_hdr_value_str(req, "Accept-Encoding", header, sizeof(header));
+    if ((err == ESP_OK || err == ESP_ERR_HTTPD_RESULT_TRUNC) && !assets_accepts_gzip(header)) {
+        httpd_resp_set_status(req, "406 Not Acceptable");
+        httpd_resp_set_type(req, "text/plain");
+        return httpd_resp_send(req, "gzip required", HTTPD_RESP_USE_STRLEN);
+    }
+
+    httpd_resp_set_type(req, asset->mime);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    // 資料位於映射的 flash，逐段交給 TCP 堆疊，不複製到 RAM (data stays in mapped flash, no RAM copy)
+    for (size_t offset = 0; offset < asset->len; offset += HTTP_ASSET_CHUNK_SIZE) {
+        size_t len = asset->len - offset;
+        if (len > HTTP_ASSET_CHUNK_SIZE) len = HTTP_ASSET_CHUNK_SIZE;
+        if (httpd_resp_send_chunk(req, (const char *)asset->data + offset, len) != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to send %s", asset->path);
+            return ESP_FAIL;
+        }
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/* 萬用字元路徑，必須最後註冊 (wildcard path, must be registered last) */
+const httpd_uri_t assets_uri = {
+    .uri       = "/*",
+    .method    = HTTP_GET,
+    .handler   = assets_get_handler,
+    .user_ctx  = NULL
+};
@@ -0,0 +1,95 @@
+#include "http/base.h"
+#include "capture.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "http_capture";
+
+#define CAPTURE_CHUNK_SIZE  1024
+#define CAPTURE_QUERY_SIZE  32
+
+/**
+ * GET /capture：以 application/octet-stream 匯出環形緩衝區 (格式見 capture.h)，匯出期間暫停記錄。
+ * GET /capture dumps the ring as application/octet-stream (layout in capture.h); recording pauses meanwhile.
+ *
+ * POST /capture?action=start|stop|clear，回應 / response (JSON):
+ * {"enabled":true|false}
+ */
+
+static esp_err_t capture_send_part(httpd_req_t *req, const uint8_t *data, uint32_t len) {
+    while (len > 0) {
+        uint32_t n = len > CAPTURE_CHUNK_SIZE ? CAPTURE_CHUNK_SIZE : len;
+        esp_err_t err = httpd_resp_send_chunk(req, (const char *)data, n);
+        if (err != ESP_OK) return err;
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+/* ----- GET /capture：匯出紀錄的流量 (dump the recorded traffic) ----- */
+static esp_err_t capture_get_handler(httpd_req_t *req) {
+    CaptureView view;
+    capture_freeze(&view);
+    CaptureFileHeader hdr = {
+        .magic           = CAPTURE_MAGIC,
+        .version         = CAPTURE_VERSION,
+        .record_hdr_size = sizeof(CaptureRecordHeader),
+        .records         = view.records,
+        .dropped         = view.dropped,
+    };
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"station.cap\"");
+    esp_err_t err = httpd_resp_send_chunk(req, (const char *)&hdr, sizeof(hdr));
+    for (uint8_t i = 0; i < 2 && err == ESP_OK; i++) {
+        err = capture_send_part(req, view.part[i], view.part_len[i]);
+    }
+    capture_thaw();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Capture dump aborted: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Dumped %lu records", (unsigned long)view.records);
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/* ----- POST /capture?action=...：啟動、停止或清除記錄 (start, stop or clear recording) ----- */
+static esp_err_t capture_post_handler(httpd_req_t *req) {
+    char query[CAPTURE_QUERY_SIZE];
+    char action[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "action", action, sizeof(action)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing action");
+        return ESP_FAIL;
+    }
+    if (strcmp(action, "start") == 0) {
+        capture_set_enabled(1);
+    } else if (strcmp(action, "stop") == 0) {
+        capture_set_enabled(0);
+    } else if (strcmp(action, "clear") == 0) {
+        capture_clear();
+    } else {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown action");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Capture %s", action);
+    char resp[32];
+    int len = snprintf(resp, sizeof(resp), "{\"enabled\":%s}", capture_enabled() ? "true" : "false");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, resp, len);
+}
+
+const httpd_uri_t capture_get_uri = {
+    .uri       = "/capture",
+    .method    = HTTP_GET,
+    .handler   = capture_get_handler,
+    .user_ctx  = NULL
+};
+
+const httpd_uri_t capture_post_uri = {
+    .uri       = "/capture",
+    .method    = HTTP_POST,
+    .handler   = capture_post_handler,
+    .user_ctx  = NULL
+};
@@ -0,0 +1,242 @@
+#include "http/base.h"
+#include "http/stream.h"
+#include "uart/command.h"
+#include "uart/transceive.h"
+#include "wifi/datagram.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "http_cmd";
+
+#define CMD_CONTENT_TYPE_MAX    32
+#define CMD_CONTENT_TYPE_BIN    "application/octet-stream"
+#define CMD_QUERY_SIZE          32
+
+/**
+ * 請求格式 / request body:
+ * - JSON (預設)：命令名稱字串陣列，例如 ["left_speed_start","move_forward"]
+ *   JSON (default): array of command names, e.g. ["left_speed_start","move_forward"]
+ * - application/octet-stream：與 UDP 相同的命令紀錄 | type u8 (=0x01) | len u8 | code u8 + args |
+ *   application/octet-stream: the UDP command records | type u8 (=0x01) | len u8 | code u8 + args |
+ *
+ * 整批命令解析成功後才一次排入 UART 傳輸緩衝區 (全部或全不)，但不是單一個 UART 封包：
+ * 只有相鄰的 DATA_TRRE 單次命令合併成同一個封包，其他命令碼各自成一個封包；
+ * 行進與回報模式命令寫入槽位，緊急停止立即進入優先通道。回應中的 frames 為 FIFO 封包數。
+ * The batch is queued to the UART transmit buffer only after the whole body parsed, all or
+ * nothing, but it is not a single UART frame: only neighbouring one-shot DATA_TRRE commands
+ * share a frame, every other code gets a frame of its own; motion and report-mode commands go
+ * to the slots and the emergency stop goes straight to the priority lane. The response's
+ * frames field counts the FIFO frames.
+ *
+ * POST /cmd[?port=N] 送往第 N 個 UART 埠，預設為主要埠 0。
+ * POST /cmd[?port=N] goes to UART port N, the primary port 0 by default.
+ */
+
+typedef enum {
+    CMD_PARSE_JSON_BEGIN,
+    CMD_PARSE_JSON_ITEM,
+    CMD_PARSE_JSON_STRING,
+    CMD_PARSE_JSON_NEXT,
+    CMD_PARSE_JSON_END,
+    CMD_PARSE_BIN_TYPE,
+    CMD_PARSE_BIN_LEN,
+    CMD_PARSE_BIN_PAYLOAD,
+} CmdParseState;
+
+typedef struct {
+    CmdParseState   state;
+    const char      *error;
+    uint16_t        index;
+    uint8_t         len;
+    uint8_t         want;
+    uint8_t         buf[PACKET_DATA_MAX_SIZE];
+    UartCmdBatch    batch;
+} CmdParser;
+
+// httpd 以單一任務處理請求，解析狀態不放在堆疊上 (httpd is single-tasked, keep the parser off its stack)
+static CmdParser cmd_parser;
+
+static esp_err_t cmd_parse_fail(CmdParser *self, const char *error) {
+    self->error = error;
+    return ESP_FAIL;
+}
+
+static esp_err_t cmd_parse_add(CmdParser *self, uint8_t code, const uint8_t *args, uint8_t args_len) {
+    if (!uart_cmd_batch_add(&self->batch, code, args, args_len)) {
+        return cmd_parse_fail(self, "too many commands");
+    }
+    // 停止命令已進入優先通道，不等整個請求主體讀完 (the stop is already in the priority lane, do not wait for the whole body)
+    if (uart_cmd_is_estop(code, args, args_len)) uart_tx_kick(self->batch.link);
+    self->index++;
+    return ESP_OK;
+}
+
+static bool cmd_json_is_space(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+ * @brief 逐位元組解析 JSON 字串陣列，不配置記憶體，可跨 chunk 接續
+ *        Byte-wise JSON string-array parser; allocation free and resumable across chunks
+ */
+static esp_err_t cmd_parse_json(CmdParser *self, uint8_t c) {
+    switch (self->state) {
+        case CMD_PARSE_JSON_BEGIN:
+            if (cmd_json_is_space(c)) return ESP_OK;
+            if (c != '[') return cmd_parse_fail(self, "expected '['");
+            self->state = CMD_PARSE_JSON_ITEM;
+            return ESP_OK;
+        case CMD_PARSE_JSON_ITEM:
+            if (cmd_json_is_space(c)) return ESP_OK;
+            if (c == ']' && self->index == 0) {
+                self->state = CMD_PARSE_JSON_END;
+                return ESP_OK;
+            }
+            if (c != '"') return cmd_parse_fail(self, "expected command string");
+            self->len   = 0;
+            self->state = CMD_PARSE_JSON_STRING;
+            return ESP_OK;
+        case CMD_PARSE_JSON_STRING: {
+            if (c != '"') {
+                if (c == '\\' || self->len >= UART_CMD_NAME_MAX) return cmd_parse_fail(self, "unknown command");
+                self->buf[self->len++] = c;
+                return ESP_OK;
+            }
+            const UartCmdDef *def = uart_cmd_find((const char *)self->buf, self->len);
+            if (def == NULL) return cmd_parse_fail(self, "unknown command");
+            self->state = CMD_PARSE_JSON_NEXT;
+            return cmd_parse_add(self, def->code, def->args, def->args_len);
+        }
+        case CMD_PARSE_JSON_NEXT:
+            if (cmd_json_is_space(c)) return ESP_OK;
+            if (c == ',') self->state = CMD_PARSE_JSON_ITEM;
+            else if (c == ']') self->state = CMD_PARSE_JSON_END;
+            else return cmd_parse_fail(self, "expected ',' or ']'");
+            return ESP_OK;
+        case CMD_PARSE_JSON_END:
+            if (cmd_json_is_space(c)) return ESP_OK;
+            return cmd_parse_fail(self, "trailing data");
+        default:
+            return cmd_parse_fail(self, "bad state");
+    }
+}
+
+/**
+ * @brief 逐位元組解析二進位命令紀錄
+ *        Byte-wise parser for binary command records
+ */
+static esp_err_t cmd_parse_bin(CmdParser *self, uint8_t c) {
+    switch (self->state) {
+        case CMD_PARSE_BIN_TYPE:
+            if (c != WIFI_DGRAM_REC_CMD) return cmd_parse_fail(self, "unsupported record type");
+            self->state = CMD_PARSE_BIN_LEN;
+            return ESP_OK;
+        case CMD_PARSE_BIN_LEN:
+            if (c == 0 || c > PACKET_DATA_MAX_SIZE) return cmd_parse_fail(self, "bad record length");
+            self->want  = c;
+            self->len   = 0;
+            self->state = CMD_PARSE_BIN_PAYLOAD;
+            return ESP_OK;
+        case CMD_PARSE_BIN_PAYLOAD:
+            self->buf[self->len++] = c;
+            if (self->len < self->want) return ESP_OK;
+            self->state = CMD_PARSE_BIN_TYPE;
+            return cmd_parse_add(self, self->buf[0], self->buf + 1, self->len - 1);
+        default:
+            return cmd_parse_fail(self, "bad state");
+    }
+}
+
+static esp_err_t cmd_consume(httpd_req_t *req, const uint8_t *chunk, size_t len, void *ctx) {
+    CmdParser *self = (CmdParser *)ctx;
+    bool binary = self->state >= CMD_PARSE_BIN_TYPE;
+    for (size_t i = 0; i < len; i++) {
+        esp_err_t err = binary ? cmd_parse_bin(self, chunk[i]) : cmd_parse_json(self, chunk[i]);
+        if (err != ESP_OK) return err;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t cmd_send_result(httpd_req_t *req, const char *status, const CmdParser *self, bool ok) {
+    char resp[96];
+    if (ok) {
+        snprintf(resp, sizeof(resp), "{\"ok\":true,\"commands\":%u,\"frames\":%u,\"slotted\":%u}",
+            (unsigned)self->batch.cmds, (unsigned)self->batch.count, (unsigned)self->batch.slotted);
+    } else {
+        snprintf(resp, sizeof(resp), "{\"ok\":false,\"error\":\"%s\",\"index\":%u}",
+            self->error, (unsigned)self->index);
+    }
+    httpd_resp_set_status(req, status);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
+}
+
+/**
+ * @brief 由查詢字串取得目標埠
+ *        Resolve the destination port from the query string
+ *
+ * @return UartLink* 埠號不存在時為 NULL (NULL for an unknown port)
+ */
+static UartLink *cmd_query_link(httpd_req_t *req) {
+    char query[CMD_QUERY_SIZE];
+    char value[4];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "port", value, sizeof(value)) != ESP_OK) {
+        return uart_link_get(UART_LINK_PRIMARY);
+    }
+    char *end;
+    unsigned long port = strtoul(value, &end, 10);
+    if (end == value || *end != '\0' || port > UINT8_MAX) return NULL;
+    return uart_link_get((uint8_t)port);
+}
+
+/* ----- POST /cmd：一次排入一整批命令 (queue a whole batch of commands) ----- */
+static esp_err_t cmd_post_handler(httpd_req_t *req) {
+    CmdParser *self = &cmd_parser;
+    self->index = 0;
+    UartLink *link = cmd_query_link(req);
+    if (link == NULL) {
+        self->error = "unknown port";
+        return cmd_send_result(req, "400 Bad Request", self, false);
+    }
+    if (!link->open) {
+        self->error = "uart port closed";
+        return cmd_send_result(req, "503 Service Unavailable", self, false);
+    }
+    char content_type[CMD_CONTENT_TYPE_MAX] = {0};
+    httpd_req_get_hdr_value_str(req, "Content-Type", content_type, sizeof(content_type));
+    bool binary = strncmp(content_type, CMD_CONTENT_TYPE_BIN, strlen(CMD_CONTENT_TYPE_BIN)) == 0;
+
+    self->state = binary ? CMD_PARSE_BIN_TYPE : CMD_PARSE_JSON_BEGIN;
+    self->error = NULL;
+    uart_cmd_batch_init(&self->batch, link);
+
+    if (http_body_stream(req, cmd_consume, self) != ESP_OK) {
+        if (self->error == NULL) {
+            ESP_LOGE(TAG, "Failed to receive command body");
+            return ESP_FAIL;
+        }
+        return cmd_send_result(req, "400 Bad Request", self, false);
+    }
+    bool complete = binary ? self->state == CMD_PARSE_BIN_TYPE : self->state == CMD_PARSE_JSON_END;
+    if (!complete) {
+        self->error = "truncated body";
+        return cmd_send_result(req, "400 Bad Request", self, false);
+    }
+    bool queued = uart_cmd_batch_commit(&self->batch);
+    uart_tx_kick(link);
+    if (!queued) {
+        self->error = "uart queue full";
+        return cmd_send_result(req, "503 Service Unavailable", self, false);
+    }
+    return cmd_send_result(req, HTTPD_200, self, true);
+}
+
+const httpd_uri_t cmd_uri = {
+    .uri       = "/cmd",
+    .method    = HTTP_POST,
+    .handler   = cmd_post_handler,
+    .user_ctx  = NULL
+};
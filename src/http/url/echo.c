@@ -1,9 +1,18 @@
 #include "http/base.h"
+#include "http/stream.h"
 #include "esp_log.h"
 #include <string.h>
 
 static const char *TAG = "http_server_example";
 
+/* 將收到的片段直接以 chunk 回送 (echo every received piece back as a chunk) */
+static esp_err_t echo_consume(httpd_req_t *req, const uint8_t *chunk, size_t len, void *ctx)
+{
+    bool *started = (bool *)ctx;
+    *started = true;
+    return httpd_resp_send_chunk(req, (const char *)chunk, len);
+}
+
 /* ----- 2. 回呼函式：處理 POST /echo ----- */
 static esp_err_t echo_post_handler(httpd_req_t *req)
 {
@@ -14,32 +23,15 @@ static esp_err_t echo_post_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    // 分配緩衝區讀取 POST body
-    char *buf = calloc(1, total_len + 1);
-    if (!buf) {
-        ESP_LOGE(TAG, "Failed to allocate buffer for POST data");
-        httpd_resp_send_500(req);
+    // 以固定緩衝逐段讀取並回送，不依 body 大小配置記憶體
+    bool started = false;
+    if (http_body_stream(req, echo_consume, &started) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to echo POST data");
+        // 已開始回送時無法再改狀態碼，只能中止連線
+        if (!started) httpd_resp_send_500(req);
         return ESP_FAIL;
     }
-
-    int received = 0;
-    int ret;
-    // 可能要分多次讀取
-    while (received < total_len) {
-        ret = httpd_req_recv(req, buf + received, total_len - received);
-        if (ret <= 0) {
-            free(buf);
-            ESP_LOGE(TAG, "Failed to receive POST data");
-            httpd_resp_send_500(req);
-            return ESP_FAIL;
-        }
-        received += ret;
-    }
-
-    // 將收到的資料 echo 回去
-    httpd_resp_send(req, buf, total_len);
-    free(buf);
-    return ESP_OK;
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
 /* 定義 POST /echo 的 URI 結構 */
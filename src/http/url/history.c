@@ -0,0 +1,190 @@
+#include "http/base.h"
+#include "telemetry/history.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "http_history";
+
+#define HISTORY_QUERY_SIZE          96
+#define HISTORY_BLOCK_MAX           64
+#define HISTORY_CHUNK_SIZE          1024
+#define HISTORY_DEFAULT_WINDOW_MS   5000
+#define HISTORY_BIN_VERSION         1
+// 時間戳為 32 位元 us，樣本年齡以 int32 比較，超過此範圍的窗口沒有意義 (ages are int32 us, no window can reach further)
+#define HISTORY_SPAN_MAX_MS         (INT32_MAX / 1000)
+
+/**
+ * GET /history?ch=<channel>[&window_ms=N][&step_ms=N][&format=csv|bin]
+ * 回傳最近 window_ms 內的樣本；step_ms > 0 時每個區間輸出第一筆時間戳與平均值。
+ * Returns the samples of the last window_ms; with step_ms > 0 each bucket yields its first
+ * timestamp and mean value. Timestamps are esp_timer us (low 32 bits).
+ *
+ * csv (預設 / default): "t_us,value" 每行一筆 / one line per point
+ * bin (小端序 / little-endian): version u8 | channel u8 | reserved u16 | now_us u32，
+ *     之後為多個分欄區塊 / then columnar blocks: count u16 | t_us u32[count] | value f32[count]，
+ *     以 count 為 0 的區塊結束 / terminated by a block with count 0
+ */
+
+typedef enum {
+    HISTORY_FORMAT_CSV,
+    HISTORY_FORMAT_BIN,
+} HistoryFormat;
+
+typedef struct {
+    httpd_req_t     *req;
+    HistoryFormat   format;
+    esp_err_t       err;
+    size_t          len;
+    char            buf[HISTORY_CHUNK_SIZE];
+    // 二進位格式的區塊暫存 (pending binary block)
+    uint16_t        count;
+    uint32_t        t_us[HISTORY_BLOCK_MAX];
+    float           value[HISTORY_BLOCK_MAX];
+} HistoryWriter;
+
+// 只在 httpd 任務中存取 (accessed from the httpd task only)
+static HistoryWriter history_writer;
+static uint32_t history_t_us[HISTORY_BLOCK_MAX];
+static float history_value[HISTORY_BLOCK_MAX];
+
+static void history_write_raw(HistoryWriter *writer, const void *data, size_t len) {
+    if (writer->err != ESP_OK) return;
+    if (writer->len + len > sizeof(writer->buf)) {
+        writer->err = httpd_resp_send_chunk(writer->req, writer->buf, writer->len);
+        writer->len = 0;
+        if (writer->err != ESP_OK) return;
+    }
+    memcpy(writer->buf + writer->len, data, len);
+    writer->len += len;
+}
+
+static void history_flush_block(HistoryWriter *writer) {
+    uint16_t count = writer->count;
+    history_write_raw(writer, &count, sizeof(count));
+    history_write_raw(writer, writer->t_us, count * sizeof(uint32_t));
+    history_write_raw(writer, writer->value, count * sizeof(float));
+    writer->count = 0;
+}
+
+static void history_emit(HistoryWriter *writer, uint32_t t_us, float value) {
+    if (writer->format == HISTORY_FORMAT_CSV) {
+        char line[32];
+        int len = snprintf(line, sizeof(line), "%lu,%.4f\n", (unsigned long)t_us, value);
+        history_write_raw(writer, line, len);
+        return;
+    }
+    writer->t_us[writer->count] = t_us;
+    writer->value[writer->count] = value;
+    if (++writer->count == HISTORY_BLOCK_MAX) history_flush_block(writer);
+}
+
+static bool history_parse_channel(const char *name, TelemetryChannel *channel) {
+    for (uint8_t ch = 0; ch < TELEMETRY_CH_COUNT; ch++) {
+        if (strcmp(name, telemetry_channel_name(ch)) == 0) {
+            *channel = ch;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t history_query_u32(const char *query, const char *key, uint32_t fallback) {
+    char value[12];
+    if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK) return fallback;
+    unsigned long parsed = strtoul(value, NULL, 10);
+    return parsed > UINT32_MAX ? UINT32_MAX : (uint32_t)parsed;
+}
+
+/**
+ * @brief 讀取以毫秒表示的時間長度並換算為 us，限制在時間戳可表示的範圍內以免相乘溢位
+ *        Read a duration in ms and convert it to us, clamped to the span the timestamps can
+ *        express so the multiplication cannot overflow
+ */
+static uint32_t history_query_span_us(const char *query, const char *key, uint32_t fallback_ms) {
+    uint32_t ms = history_query_u32(query, key, fallback_ms);
+    if (ms > HISTORY_SPAN_MAX_MS) ms = HISTORY_SPAN_MAX_MS;
+    return ms * 1000U;
+}
+
+/* ----- GET /history：單一通道的時間範圍查詢 (time-range query for one channel) ----- */
+static esp_err_t history_get_handler(httpd_req_t *req) {
+    char query[HISTORY_QUERY_SIZE];
+    char name[16];
+    char format[8];
+    TelemetryChannel channel;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "ch", name, sizeof(name)) != ESP_OK ||
+        !history_parse_channel(name, &channel)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or unknown ch");
+        return ESP_FAIL;
+    }
+    uint32_t window_us = history_query_span_us(query, "window_ms", HISTORY_DEFAULT_WINDOW_MS);
+    TelemetryDecimator decimator = telemetry_decimator_new(history_query_span_us(query, "step_ms", 0));
+    HistoryWriter *writer = &history_writer;
+    writer->req = req;
+    writer->err = ESP_OK;
+    writer->len = 0;
+    writer->count = 0;
+    writer->format = HISTORY_FORMAT_CSV;
+    if (httpd_query_key_value(query, "format", format, sizeof(format)) == ESP_OK && strcmp(format, "bin") == 0) {
+        writer->format = HISTORY_FORMAT_BIN;
+    }
+
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    if (writer->format == HISTORY_FORMAT_BIN) {
+        httpd_resp_set_type(req, "application/octet-stream");
+        uint8_t hdr[8] = { HISTORY_BIN_VERSION, channel, 0, 0 };
+        memcpy(hdr + 4, &now_us, sizeof(now_us));
+        history_write_raw(writer, hdr, sizeof(hdr));
+    } else {
+        httpd_resp_set_type(req, "text/csv");
+        history_write_raw(writer, "t_us,value\n", strlen("t_us,value\n"));
+    }
+
+    // 由舊到新走訪，只以時間欄決定是否在範圍內 (walk oldest to newest, the time column alone decides the range)
+    uint32_t cursor = telemetry_history_oldest(channel);
+    uint32_t out_t_us;
+    float out_value;
+    uint16_t count;
+    bool done = false;
+    while (!done && writer->err == ESP_OK &&
+           (count = telemetry_history_read(channel, &cursor, history_t_us, history_value, HISTORY_BLOCK_MAX)) > 0) {
+        for (uint16_t i = 0; i < count; i++) {
+            int32_t age_us = (int32_t)(now_us - history_t_us[i]);
+            if (age_us < 0) {
+                done = true;  // 查詢開始後才寫入的樣本 (appended after the query started)
+                break;
+            }
+            if ((uint32_t)age_us > window_us) continue;
+            if (telemetry_decimator_push(&decimator, history_t_us[i], history_value[i], &out_t_us, &out_value)) {
+                history_emit(writer, out_t_us, out_value);
+            }
+        }
+    }
+    if (telemetry_decimator_flush(&decimator, &out_t_us, &out_value)) {
+        history_emit(writer, out_t_us, out_value);
+    }
+    if (writer->format == HISTORY_FORMAT_BIN) {
+        if (writer->count > 0) history_flush_block(writer);
+        history_flush_block(writer);
+    }
+    if (writer->err == ESP_OK && writer->len > 0) {
+        writer->err = httpd_resp_send_chunk(req, writer->buf, writer->len);
+    }
+    if (writer->err != ESP_OK) {
+        ESP_LOGW(TAG, "History response aborted: %s", esp_err_to_name(writer->err));
+        return writer->err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+const httpd_uri_t history_uri = {
+    .uri       = "/history",
+    .method    = HTTP_GET,
+    .handler   = history_get_handler,
+    .user_ctx  = NULL
+};
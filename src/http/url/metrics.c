@@ -0,0 +1,145 @@
+#include "http/base.h"
+#include "metrics.h"
+#include "uart/link.h"
+#include "wifi/packet.h"
+#include "esp_log.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "http_metrics";
+
+#define METRICS_CHUNK_SIZE  1024
+
+typedef struct {
+    httpd_req_t *req;
+    size_t      len;
+    esp_err_t   err;
+    char        buf[METRICS_CHUNK_SIZE];
+} MetricsChunkWriter;
+
+// httpd 只有一個任務處理請求，共用一份輸出緩衝 (single httpd task, one shared output buffer)
+static MetricsChunkWriter metrics_writer;
+
+static void metrics_writer_flush(MetricsChunkWriter *writer) {
+    if (writer->len == 0 || writer->err != ESP_OK) return;
+    writer->err = httpd_resp_send_chunk(writer->req, writer->buf, writer->len);
+    writer->len = 0;
+}
+
+/**
+ * @brief 累積到固定大小再以 chunk 送出，避免每行一次 TCP 傳送
+ *        Batch lines into fixed-size chunks instead of one TCP send per line
+ */
+static void metrics_writer_write(void *ctx, const char *text, size_t len) {
+    MetricsChunkWriter *writer = (MetricsChunkWriter *)ctx;
+    if (writer->len + len > sizeof(writer->buf)) {
+        metrics_writer_flush(writer);
+    }
+    if (len > sizeof(writer->buf)) return;
+    memcpy(writer->buf + writer->len, text, len);
+    writer->len += len;
+}
+
+static void metrics_write_queue(MetricsChunkWriter *writer, const char *name, uint8_t depth, uint8_t high_water, uint32_t drops) {
+    char line[192];
+    int len = snprintf(line, sizeof(line),
+        "station_queue_depth{queue=\"%s\"} %u\n"
+        "station_queue_high_water{queue=\"%s\"} %u\n"
+        "station_queue_drops_total{queue=\"%s\"} %lu\n",
+        name, depth, name, high_water, name, (unsigned long)drops);
+    if (len > 0) metrics_writer_write(writer, line, len);
+}
+
+/**
+ * @brief 輸出各 UART 埠的佇列；埠 0 沿用原本的佇列名稱
+ *        Emit the queues of every UART port; port 0 keeps the original queue names
+ */
+static void metrics_write_uart_queues(MetricsChunkWriter *writer) {
+    for (uint8_t i = 0; i < UART_LINK_COUNT; i++) {
+        const UartLink *link = &uart_links[i];
+        char name[16];
+        if (i == UART_LINK_PRIMARY) {
+            metrics_write_queue(writer, "uart_tx", link->tx_buf.len, link->tx_buf.high_water, link->tx_buf.drops);
+            metrics_write_queue(writer, "uart_rx", link->rx_buf.len, link->rx_buf.high_water, link->rx_buf.drops);
+            continue;
+        }
+        snprintf(name, sizeof(name), "uart%u_tx", i + 1);
+        metrics_write_queue(writer, name, link->tx_buf.len, link->tx_buf.high_water, link->tx_buf.drops);
+        snprintf(name, sizeof(name), "uart%u_rx", i + 1);
+        metrics_write_queue(writer, name, link->rx_buf.len, link->rx_buf.high_water, link->rx_buf.drops);
+    }
+}
+
+typedef struct {
+    const char  *name;
+    size_t      offset;
+} MetricsUartPortStat;
+
+static const MetricsUartPortStat metrics_uart_port_stats[] = {
+    { "station_uart_port_rx_frames_total",      offsetof(UartLinkStats, rx_frames) },
+    { "station_uart_port_rx_bytes_total",       offsetof(UartLinkStats, rx_bytes) },
+    { "station_uart_port_frame_errors_total",   offsetof(UartLinkStats, frame_errors) },
+    { "station_uart_port_tx_frames_total",      offsetof(UartLinkStats, tx_frames) },
+    { "station_uart_port_tx_bytes_total",       offsetof(UartLinkStats, tx_bytes) },
+    { "station_uart_port_tx_errors_total",      offsetof(UartLinkStats, tx_errors) },
+};
+
+/**
+ * @brief 輸出各 UART 埠的開啟狀態與流量，同一指標的各埠數值連續輸出
+ *        Emit the open state and traffic of every UART port, each metric's ports kept together
+ */
+static void metrics_write_uart_ports(MetricsChunkWriter *writer) {
+    char line[96];
+    int len = snprintf(line, sizeof(line), "# TYPE station_uart_port_open gauge\n");
+    metrics_writer_write(writer, line, len);
+    for (uint8_t i = 0; i < UART_LINK_COUNT; i++) {
+        len = snprintf(line, sizeof(line), "station_uart_port_open{port=\"%u\"} %u\n", i, uart_links[i].open);
+        if (len > 0) metrics_writer_write(writer, line, len);
+    }
+    for (size_t m = 0; m < sizeof(metrics_uart_port_stats) / sizeof(metrics_uart_port_stats[0]); m++) {
+        const MetricsUartPortStat *stat = &metrics_uart_port_stats[m];
+        len = snprintf(line, sizeof(line), "# TYPE %s counter\n", stat->name);
+        if (len > 0) metrics_writer_write(writer, line, len);
+        for (uint8_t i = 0; i < UART_LINK_COUNT; i++) {
+            const uint32_t *value = (const uint32_t *)((const uint8_t *)&uart_links[i].stats + stat->offset);
+            len = snprintf(line, sizeof(line), "%s{port=\"%u\"} %lu\n", stat->name, i, (unsigned long)*value);
+            if (len > 0) metrics_writer_write(writer, line, len);
+        }
+    }
+}
+
+static esp_err_t metrics_get_handler(httpd_req_t *req) {
+    MetricsChunkWriter *writer = &metrics_writer;
+    writer->req = req;
+    writer->len = 0;
+    writer->err = ESP_OK;
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+    metrics_render(metrics_writer_write, writer);
+
+    static const char queue_hdr[] =
+        "# TYPE station_queue_depth gauge\n"
+        "# TYPE station_queue_high_water gauge\n"
+        "# TYPE station_queue_drops_total counter\n";
+    metrics_writer_write(writer, queue_hdr, sizeof(queue_hdr) - 1);
+    metrics_write_uart_queues(writer);
+    metrics_write_queue(writer, "udp_tx", wifi_udp_transmit_buffer.length, wifi_udp_transmit_buffer.high_water, wifi_udp_transmit_buffer.drops);
+    metrics_write_queue(writer, "udp_rx", wifi_udp_receive_buffer.length, wifi_udp_receive_buffer.high_water, wifi_udp_receive_buffer.drops);
+    metrics_write_queue(writer, "tcp_tx", wifi_tcp_transmit_buffer.length, wifi_tcp_transmit_buffer.high_water, wifi_tcp_transmit_buffer.drops);
+    metrics_write_queue(writer, "tcp_rx", wifi_tcp_receive_buffer.length, wifi_tcp_receive_buffer.high_water, wifi_tcp_receive_buffer.drops);
+    metrics_write_uart_ports(writer);
+
+    metrics_writer_flush(writer);
+    if (writer->err != ESP_OK) {
+        ESP_LOGW(TAG, "metrics send failed: %s", esp_err_to_name(writer->err));
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+const httpd_uri_t metrics_uri = {
+    .uri       = "/metrics",
+    .method    = HTTP_GET,
+    .handler   = metrics_get_handler,
+    .user_ctx  = NULL
+};
@@ -0,0 +1,124 @@
+#include "http/base.h"
+#include "task_layout.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "http_tasks";
+
+#define TASKS_REPORT_MAX    32
+#define TASKS_CHUNK_SIZE    1024
+#define TASKS_LINE_MAX      192
+
+/**
+ * 回應格式 / response (JSON):
+ * {"uptime_us":N,"tasks":[{"name":..,"core":0|1|-1,"prio":N,"state":..,
+ *   "cpu_total":%,"cpu_recent":%,"stack_min_free":bytes,"stack_size":bytes}, ...]}
+ * stack_size 只對 task_layout 表中的任務有值，其餘為 0。
+ * stack_size is only known for tasks in the task_layout table, 0 otherwise.
+ * cpu_total 為開機以來占該核心的比例，cpu_recent 為距上次查詢期間的比例。
+ * cpu_total is the share of its core since boot, cpu_recent the share since the previous query.
+ */
+
+typedef struct {
+    UBaseType_t number;
+    uint32_t    counter;
+} TaskRunSample;
+
+// 只在 httpd 任務中存取 (accessed from the httpd task only)
+static TaskStatus_t tasks_status[TASKS_REPORT_MAX];
+static TaskRunSample tasks_prev[TASKS_REPORT_MAX];
+static UBaseType_t tasks_prev_count = 0;
+static uint32_t tasks_prev_total = 0;
+static char tasks_chunk[TASKS_CHUNK_SIZE];
+static size_t tasks_chunk_len = 0;
+
+static const char *tasks_state_name(eTaskState state) {
+    switch (state) {
+        case eRunning:   return "running";
+        case eReady:     return "ready";
+        case eBlocked:   return "blocked";
+        case eSuspended: return "suspended";
+        case eDeleted:   return "deleted";
+        default:         return "unknown";
+    }
+}
+
+static esp_err_t tasks_write(httpd_req_t *req, const char *text, size_t len) {
+    esp_err_t err = ESP_OK;
+    if (tasks_chunk_len + len > sizeof(tasks_chunk)) {
+        err = httpd_resp_send_chunk(req, tasks_chunk, tasks_chunk_len);
+        tasks_chunk_len = 0;
+    }
+    memcpy(tasks_chunk + tasks_chunk_len, text, len);
+    tasks_chunk_len += len;
+    return err;
+}
+
+static uint32_t tasks_prev_counter(UBaseType_t number) {
+    for (UBaseType_t i = 0; i < tasks_prev_count; i++) {
+        if (tasks_prev[i].number == number) return tasks_prev[i].counter;
+    }
+    return 0;
+}
+
+/* ----- GET /tasks：每個任務的核心、優先權、CPU 使用率與堆疊剩餘量 (per-task core, priority, CPU and stack headroom) ----- */
+static esp_err_t tasks_get_handler(httpd_req_t *req) {
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(tasks_status, TASKS_REPORT_MAX, &total);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, report skipped", TASKS_REPORT_MAX);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Too many tasks");
+        return ESP_FAIL;
+    }
+    uint32_t elapsed = total - tasks_prev_total;
+
+    httpd_resp_set_type(req, "application/json");
+    tasks_chunk_len = 0;
+    char line[TASKS_LINE_MAX];
+    int len = snprintf(line, sizeof(line), "{\"uptime_us\":%lu,\"tasks\":[", (unsigned long)total);
+    esp_err_t err = tasks_write(req, line, len);
+    for (UBaseType_t i = 0; i < count && err == ESP_OK; i++) {
+        const TaskStatus_t *task = &tasks_status[i];
+        uint32_t recent = task->ulRunTimeCounter - tasks_prev_counter(task->xTaskNumber);
+        int core = (task->xCoreID == tskNO_AFFINITY) ? -1 : (int)task->xCoreID;
+        const TaskLayout *layout = task_layout_find(task->xHandle);
+        len = snprintf(line, sizeof(line),
+            "%s{\"name\":\"%s\",\"core\":%d,\"prio\":%u,\"state\":\"%s\","
+            "\"cpu_total\":%.1f,\"cpu_recent\":%.1f,\"stack_min_free\":%lu,\"stack_size\":%lu}",
+            i == 0 ? "" : ",", task->pcTaskName, core, (unsigned)task->uxCurrentPriority,
+            tasks_state_name(task->eCurrentState),
+            total ? 100.0f * task->ulRunTimeCounter / total : 0.0f,
+            elapsed ? 100.0f * recent / elapsed : 0.0f,
+            (unsigned long)task->usStackHighWaterMark,
+            (unsigned long)(layout ? layout->stack_size : 0));
+        if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+        err = tasks_write(req, line, len);
+    }
+    if (err == ESP_OK) err = tasks_write(req, "]}", 2);
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        tasks_prev[i].number  = tasks_status[i].xTaskNumber;
+        tasks_prev[i].counter = tasks_status[i].ulRunTimeCounter;
+    }
+    tasks_prev_count = count;
+    tasks_prev_total = total;
+
+    if (err == ESP_OK && tasks_chunk_len > 0) {
+        err = httpd_resp_send_chunk(req, tasks_chunk, tasks_chunk_len);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to send task report");
+        return err;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+const httpd_uri_t tasks_uri = {
+    .uri       = "/tasks",
+    .method    = HTTP_GET,
+    .handler   = tasks_get_handler,
+    .user_ctx  = NULL
+};
@@ -0,0 +1,62 @@
+#include "http/base.h"
+#include "telemetry/cache.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *TAG = "http_telemetry";
+
+#define TELEMETRY_REPORT_SIZE   512
+#define TELEMETRY_QUERY_SIZE    32
+
+/**
+ * GET /telemetry[?max_age_ms=N]：直接由站台快取回應，不向 STM32 發出 *_ONCE 請求。
+ * GET /telemetry[?max_age_ms=N] is answered from the station cache, no *_ONCE request to the STM32.
+ * 回應格式 / response (JSON)，時間單位為微秒 / times in us:
+ * {"max_age_us":N,"channels":{"left_speed":{"state":"fresh|stale|empty","value":F,"age_us":N,"count":N}, ...}}
+ */
+
+static uint32_t telemetry_query_max_age(httpd_req_t *req) {
+    char query[TELEMETRY_QUERY_SIZE];
+    char value[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "max_age_ms", value, sizeof(value)) != ESP_OK) {
+        return TELEMETRY_CACHE_DEFAULT_MAX_AGE_US;
+    }
+    return (uint32_t)strtoul(value, NULL, 10) * 1000U;
+}
+
+/* ----- GET /telemetry：每個通道的最新值 (latest value per channel) ----- */
+static esp_err_t telemetry_get_handler(httpd_req_t *req) {
+    char report[TELEMETRY_REPORT_SIZE];
+    uint32_t max_age_us = telemetry_query_max_age(req);
+    int len = snprintf(report, sizeof(report), "{\"max_age_us\":%lu,\"channels\":{", (unsigned long)max_age_us);
+    for (uint8_t ch = 0; ch < TELEMETRY_CH_COUNT && len < (int)sizeof(report); ch++) {
+        TelemetryCacheEntry entry;
+        TelemetryCacheState state = telemetry_cache_read(ch, max_age_us, &entry);
+        len += snprintf(report + len, sizeof(report) - len,
+            "%s\"%s\":{\"state\":\"%s\",\"value\":%.3f,\"age_us\":%lu,\"count\":%lu}",
+            ch == 0 ? "" : ",", telemetry_channel_name(ch), telemetry_cache_state_name(state),
+            entry.value, (unsigned long)entry.age_us, (unsigned long)entry.count);
+    }
+    if (len < (int)sizeof(report)) {
+        len += snprintf(report + len, sizeof(report) - len, "}}");
+    }
+    if (len >= (int)sizeof(report)) {
+        ESP_LOGW(TAG, "Telemetry report truncated");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Report too large");
+        return ESP_FAIL;
+    }
+    metrics_inc(METRIC_TELEMETRY_QUERIES);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, report, len);
+}
+
+const httpd_uri_t telemetry_uri = {
+    .uri       = "/telemetry",
+    .method    = HTTP_GET,
+    .handler   = telemetry_get_handler,
+    .user_ctx  = NULL
+};
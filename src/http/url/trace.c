@@ -0,0 +1,72 @@
+#include "http/base.h"
+#include "pkt_trace.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+static const char *TAG = "http_trace";
+
+#define TRACE_REPORT_SIZE   2048
+
+/**
+ * 回應格式 / response (JSON)，時間單位為微秒，百分位數為 bucket 上界:
+ * times in us, percentiles are bucket upper bounds:
+ * {"uart_to_wifi":{"rx_to_enqueue":{"count":N,"mean":N,"p50":N,"p90":N,"p99":N}, ...,"total":{...}},
+ *  "wifi_to_uart":{...}}
+ */
+
+// 只在 httpd 任務中存取 (accessed from the httpd task only)
+static char trace_report[TRACE_REPORT_SIZE];
+static size_t trace_report_len = 0;
+
+static bool trace_append(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static bool trace_append(const char *fmt, ...) {
+    if (trace_report_len >= sizeof(trace_report)) return 0;
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(trace_report + trace_report_len, sizeof(trace_report) - trace_report_len, fmt, args);
+    va_end(args);
+    if (len < 0) len = sizeof(trace_report);
+    trace_report_len += len;
+    return trace_report_len < sizeof(trace_report);
+}
+
+/* ----- GET /trace：UART↔Wi-Fi 各階段延遲摘要 (per-stage latency summary in both directions) ----- */
+static esp_err_t trace_get_handler(httpd_req_t *req) {
+    trace_report_len = 0;
+    bool ok = trace_append("{");
+    for (uint8_t dir = 0; dir < PKT_DIR_COUNT && ok; dir++) {
+        MetricHist base = (dir == PKT_DIR_UART_TO_WIFI)
+            ? METRIC_HIST_TRACE_U2W_RX_ENQUEUE_US
+            : METRIC_HIST_TRACE_W2U_RX_ENQUEUE_US;
+        ok = trace_append("%s\"%s\":{", dir == 0 ? "" : ",", pkt_trace_dir_name(dir));
+        for (uint8_t span = 0; span < PKT_TRACE_SPAN_COUNT && ok; span++) {
+            MetricHistSnapshot snap;
+            metrics_hist_snapshot(base + span, &snap);
+            ok = trace_append("%s\"%s\":{\"count\":%lu,\"mean\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu}",
+                span == 0 ? "" : ",", pkt_trace_span_name(span),
+                (unsigned long)snap.count,
+                (unsigned long)(snap.count ? snap.sum / snap.count : 0),
+                (unsigned long)metrics_hist_percentile(&snap, 50),
+                (unsigned long)metrics_hist_percentile(&snap, 90),
+                (unsigned long)metrics_hist_percentile(&snap, 99));
+        }
+        if (ok) ok = trace_append("}");
+    }
+    if (ok) ok = trace_append("}");
+    if (!ok) {
+        ESP_LOGW(TAG, "Trace report truncated");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Report too large");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, trace_report, trace_report_len);
+}
+
+const httpd_uri_t trace_uri = {
+    .uri       = "/trace",
+    .method    = HTTP_GET,
+    .handler   = trace_get_handler,
+    .user_ctx  = NULL
+};
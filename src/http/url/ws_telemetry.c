@@ -0,0 +1,210 @@
+#include "http/base.h"
+#include "telemetry/sample.h"
+#include "metrics.h"
+#include "esp_log.h"
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "http_ws_telemetry";
+
+#define WS_TELEMETRY_MAX_SUBS       4
+#define WS_TELEMETRY_FRAME_POOL     8
+#define WS_TELEMETRY_FRAME_SIZE     10
+#define WS_TELEMETRY_RECV_MAX       8
+
+/**
+ * 推送格式 (big-endian) / pushed frame layout (big-endian):
+ * | channel u8 | reserved u8 | t_us u32 | value f32 |
+ *
+ * 訂閱：客戶端送出頻道位元遮罩 (bit n = TelemetryChannel n)，
+ * binary 取第一個位元組，text 以十進位解析，0 代表取消訂閱。
+ * Subscribe by sending a channel bitmask (bit n = TelemetryChannel n):
+ * first byte of a binary frame or a decimal text frame; 0 unsubscribes.
+ */
+
+typedef struct {
+    int         fd;
+    uint8_t     mask;
+    bool        used;
+} WsTelemetrySub;
+
+typedef struct {
+    uint8_t     data[WS_TELEMETRY_FRAME_SIZE];
+    uint8_t     mask_bit;
+    bool        busy;
+} WsTelemetryFrame;
+
+static httpd_handle_t ws_telemetry_server = NULL;
+// 只在 httpd 任務中存取 (accessed from the httpd task only)
+static WsTelemetrySub ws_telemetry_subs[WS_TELEMETRY_MAX_SUBS];
+// httpd 任務寫入，發佈端讀取以快速略過 (written by httpd, read by publishers to skip early)
+static volatile uint8_t ws_telemetry_sub_mask = 0;
+static WsTelemetryFrame ws_telemetry_frames[WS_TELEMETRY_FRAME_POOL];
+static uint8_t ws_telemetry_frame_next = 0;
+
+static void ws_telemetry_update_mask(void) {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < WS_TELEMETRY_MAX_SUBS; i++) {
+        if (ws_telemetry_subs[i].used) mask |= ws_telemetry_subs[i].mask;
+    }
+    ws_telemetry_sub_mask = mask;
+}
+
+/**
+ * @brief 新增/更新/移除訂閱者
+ *        Add, update or remove (mask 0) a subscriber
+ */
+static bool ws_telemetry_subscribe(int fd, uint8_t mask) {
+    WsTelemetrySub *free_sub = NULL;
+    for (uint8_t i = 0; i < WS_TELEMETRY_MAX_SUBS; i++) {
+        WsTelemetrySub *sub = &ws_telemetry_subs[i];
+        if (sub->used && sub->fd == fd) {
+            sub->mask = mask;
+            sub->used = mask != 0;
+            ws_telemetry_update_mask();
+            return 1;
+        }
+        if (!sub->used && free_sub == NULL) free_sub = sub;
+    }
+    if (mask == 0) return 1;
+    if (free_sub == NULL) return 0;
+    free_sub->fd   = fd;
+    free_sub->mask = mask;
+    free_sub->used = true;
+    ws_telemetry_update_mask();
+    return 1;
+}
+
+/**
+ * @brief 連線關閉時移除其訂閱，避免 httpd 重用同一個 fd 時新客戶端繼承舊的頻道遮罩
+ *        Drop the subscription of a closed session, so a new client on a reused fd does not
+ *        inherit the old channel mask
+ *
+ * @note 由 httpd 的 close_fn 在 httpd 任務中呼叫 (called by httpd's close_fn on the httpd task)
+ */
+void ws_telemetry_session_closed(int fd) {
+    for (uint8_t i = 0; i < WS_TELEMETRY_MAX_SUBS; i++) {
+        WsTelemetrySub *sub = &ws_telemetry_subs[i];
+        if (sub->used && sub->fd == fd) {
+            sub->used = false;
+            ws_telemetry_update_mask();
+            ESP_LOGI(TAG, "Subscriber on fd %d closed", fd);
+            return;
+        }
+    }
+}
+
+static esp_err_t ws_telemetry_handler(httpd_req_t *req) {
+    if (req->method == HTTP_GET) {
+        ESP_LOGI(TAG, "WebSocket handshake done, fd %d", httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+    uint8_t buf[WS_TELEMETRY_RECV_MAX + 1] = {0};
+    httpd_ws_frame_t frame = {0};
+    frame.payload = buf;
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, WS_TELEMETRY_RECV_MAX);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "httpd_ws_recv_frame failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (frame.len == 0) return ESP_OK;
+    uint8_t mask;
+    if (frame.type == HTTPD_WS_TYPE_TEXT) {
+        mask = (uint8_t)strtoul((const char *)buf, NULL, 10);
+    } else if (frame.type == HTTPD_WS_TYPE_BINARY) {
+        mask = buf[0];
+    } else {
+        return ESP_OK;
+    }
+    if (!ws_telemetry_subscribe(httpd_req_to_sockfd(req), mask)) {
+        ESP_LOGW(TAG, "Subscriber table full");
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief 在 httpd 任務中把同一份編碼好的訊框送給所有訂閱該頻道的客戶端
+ *        On the httpd task, send one encoded frame to every subscriber of its channel
+ */
+static void ws_telemetry_fanout(void *arg) {
+    WsTelemetryFrame *frame = (WsTelemetryFrame *)arg;
+    httpd_ws_frame_t ws_frame = {
+        .final   = true,
+        .type    = HTTPD_WS_TYPE_BINARY,
+        .payload = frame->data,
+        .len     = sizeof(frame->data),
+    };
+    bool dropped = false;
+    for (uint8_t i = 0; i < WS_TELEMETRY_MAX_SUBS; i++) {
+        WsTelemetrySub *sub = &ws_telemetry_subs[i];
+        if (!sub->used || !(sub->mask & frame->mask_bit)) continue;
+        if (
+            httpd_ws_get_fd_info(ws_telemetry_server, sub->fd) != HTTPD_WS_CLIENT_WEBSOCKET ||
+            httpd_ws_send_frame_async(ws_telemetry_server, sub->fd, &ws_frame) != ESP_OK
+        ) {
+            sub->used = false;
+            dropped = true;
+            continue;
+        }
+        metrics_inc(METRIC_WS_FRAMES_SENT);
+    }
+    if (dropped) ws_telemetry_update_mask();
+    __atomic_store_n(&frame->busy, false, __ATOMIC_RELEASE);
+}
+
+static void ws_telemetry_put_be(uint8_t *dst, uint32_t value) {
+    dst[0] = (uint8_t)(value >> 24);
+    dst[1] = (uint8_t)(value >> 16);
+    dst[2] = (uint8_t)(value >>  8);
+    dst[3] = (uint8_t)value;
+}
+
+/**
+ * @brief 遙測接收端：編碼一次，交給 httpd 任務非同步推送
+ *        Telemetry sink: encode once and let the httpd task push it asynchronously
+ *
+ * @note 訊框池耗盡時丟棄樣本而不阻塞呼叫端 (drops the sample instead of blocking when the pool is exhausted)
+ */
+static void ws_telemetry_sink(const TelemetrySample *sample) {
+    uint8_t mask_bit = 1U << sample->channel;
+    if (!(ws_telemetry_sub_mask & mask_bit)) return;
+    WsTelemetryFrame *frame = &ws_telemetry_frames[ws_telemetry_frame_next];
+    if (__atomic_load_n(&frame->busy, __ATOMIC_ACQUIRE)) {
+        metrics_inc(METRIC_WS_FRAMES_DROPPED);
+        return;
+    }
+    ws_telemetry_frame_next = (ws_telemetry_frame_next + 1) % WS_TELEMETRY_FRAME_POOL;
+
+    uint32_t raw;
+    memcpy(&raw, &sample->value, sizeof(raw));
+    frame->data[0]  = (uint8_t)sample->channel;
+    frame->data[1]  = 0;
+    ws_telemetry_put_be(frame->data + 2, sample->t_us);
+    ws_telemetry_put_be(frame->data + 6, raw);
+    frame->mask_bit = mask_bit;
+    frame->busy     = true;
+    if (httpd_queue_work(ws_telemetry_server, ws_telemetry_fanout, frame) != ESP_OK) {
+        metrics_inc(METRIC_WS_FRAMES_DROPPED);
+        __atomic_store_n(&frame->busy, false, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief 綁定伺服器並註冊遙測接收端
+ *        Bind the running server and register the telemetry sink
+ */
+void ws_telemetry_attach(httpd_handle_t server) {
+    static bool sink_registered = false;
+    ws_telemetry_server = server;
+    if (!sink_registered) {
+        sink_registered = telemetry_sink_register(ws_telemetry_sink);
+    }
+}
+
+const httpd_uri_t ws_telemetry_uri = {
+    .uri          = "/ws/telemetry",
+    .method       = HTTP_GET,
+    .handler      = ws_telemetry_handler,
+    .user_ctx     = NULL,
+    .is_websocket = true,
+};
@@ -0,0 +1,251 @@
+#include "metrics.h"
+// ----------------------------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdarg.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    const char  *name;
+    const char  *help;
+} MetricDesc;
+
+static const MetricDesc metric_counter_desc[METRIC_COUNTER_COUNT] = {
+    [METRIC_UART_RX_FRAMES]         = { "station_uart_rx_frames_total",         "UART frames received" },
+    [METRIC_UART_RX_BYTES]          = { "station_uart_rx_bytes_total",          "UART bytes received" },
+    [METRIC_UART_FRAME_ERRORS]      = { "station_uart_frame_errors_total",      "Malformed UART frames and noise between frames" },
+    [METRIC_UART_TX_FRAMES]         = { "station_uart_tx_frames_total",         "UART frames written" },
+    [METRIC_UART_TX_BYTES]          = { "station_uart_tx_bytes_total",          "UART bytes written" },
+    [METRIC_UART_TX_ERRORS]         = { "station_uart_tx_errors_total",         "UART writes rejected by the driver" },
+    [METRIC_WIFI_UDP_RX_DATAGRAMS]  = { "station_udp_rx_datagrams_total",       "UDP datagrams received" },
+    [METRIC_WIFI_UDP_RX_BYTES]      = { "station_udp_rx_bytes_total",           "UDP bytes received" },
+    [METRIC_WIFI_UDP_RX_BAD]        = { "station_udp_rx_bad_total",             "UDP datagrams with a bad header" },
+    [METRIC_WIFI_UDP_RX_DUPS]       = { "station_udp_rx_duplicates_total",      "Duplicate reliable UDP datagrams" },
+    [METRIC_WIFI_UDP_CMD_DROPS]     = { "station_udp_cmd_drops_total",          "UDP commands dropped on a full UART queue" },
+    [METRIC_WIFI_UDP_TX_DATAGRAMS]  = { "station_udp_tx_datagrams_total",       "UDP datagrams sent" },
+    [METRIC_WIFI_UDP_TX_BYTES]      = { "station_udp_tx_bytes_total",           "UDP bytes sent" },
+    [METRIC_WIFI_UDP_TX_ERRORS]     = { "station_udp_tx_errors_total",          "UDP sendto failures" },
+    [METRIC_HTTP_SESSIONS]          = { "station_http_sessions_total",          "HTTP sessions opened" },
+    [METRIC_WS_FRAMES_SENT]         = { "station_ws_frames_sent_total",         "WebSocket telemetry frames sent" },
+    [METRIC_WS_FRAMES_DROPPED]      = { "station_ws_frames_dropped_total",      "WebSocket telemetry samples dropped" },
+    [METRIC_WIFI_DISCONNECTS]       = { "station_wifi_disconnects_total",       "Wi-Fi disconnect events" },
+    [METRIC_WIFI_CACHE_MISSES]      = { "station_wifi_cache_misses_total",      "Connects that fell back from the cached AP to a full scan" },
+    [METRIC_CAPTURE_RECORDS]        = { "station_capture_records_total",        "Traffic records written to the capture ring" },
+    [METRIC_CAPTURE_DROPS]          = { "station_capture_drops_total",          "Traffic records skipped while a capture was being dumped" },
+    [METRIC_TELEMETRY_QUERIES]      = { "station_telemetry_queries_total",      "Telemetry reads answered from the station cache" },
+    [METRIC_UART_CMD_COALESCED]     = { "station_uart_cmd_coalesced_total",     "Pending slot commands replaced by a newer one before being sent" },
+    [METRIC_UART_FLOW_STALLS]       = { "station_uart_flow_stalls_total",       "UART transmits that had to wait for STM32 credits" },
+    [METRIC_UART_FLOW_STARVED]      = { "station_uart_flow_starved_total",      "Credit waits that timed out and resynced with the STM32" },
+    [METRIC_WIFI_UDP_TELEMETRY_DROPS] = { "station_udp_telemetry_drops_total", "Telemetry records that fit in no UDP datagram" },
+    [METRIC_WIFI_UDP_RX_TRUNCATED]  = { "station_udp_rx_truncated_total",       "Oversize UDP datagrams truncated and dropped" },
+};
+
+static const MetricDesc metric_gauge_desc[METRIC_GAUGE_COUNT] = {
+    [METRIC_GAUGE_WIFI_BOOT_TO_IP_MS]       = { "station_wifi_boot_to_ip_ms",       "Time from boot to the first IP address" },
+    [METRIC_GAUGE_WIFI_LAST_RECOVERY_MS]    = { "station_wifi_last_recovery_ms",    "Time from the last disconnect to IP recovered" },
+    [METRIC_GAUGE_WIFI_MAX_RECOVERY_MS]     = { "station_wifi_max_recovery_ms",     "Longest disconnect to IP recovered time" },
+    [METRIC_GAUGE_BOOT_FIRST_UART_FRAME_MS] = { "station_boot_first_uart_frame_ms", "Time from reset to the first valid UART frame" },
+    [METRIC_GAUGE_UART_ESTOP_MAX_US]        = { "station_uart_estop_max_us",        "Worst emergency stop request to UART write time" },
+};
+
+static const MetricDesc metric_hist_desc[METRIC_HIST_COUNT] = {
+    [METRIC_HIST_UART_RX_PROC_US]                  = { "station_uart_rx_proc_us",                  "UART frame read to processed latency" },
+    [METRIC_HIST_UART_TX_WRITE_US]                 = { "station_uart_tx_write_us",                 "UART driver write duration" },
+    [METRIC_HIST_WIFI_UDP_RX_PROC_US]              = { "station_udp_rx_proc_us",                   "UDP datagram parse and dispatch duration" },
+    [METRIC_HIST_WIFI_UDP_TX_SEND_US]              = { "station_udp_tx_send_us",                   "UDP sendto duration" },
+    [METRIC_HIST_DISPATCH_TIMER_LATE_US]           = { "station_dispatch_timer_late_us",           "Dispatcher wakeup delay past a timer deadline" },
+    [METRIC_HIST_UART_ESTOP_US]                    = { "station_uart_estop_us",                    "Emergency stop request to UART write time" },
+    [METRIC_HIST_TRACE_U2W_RX_ENQUEUE_US]          = { "station_trace_u2w_rx_enqueue_us",          "UART to Wi-Fi: UART read to receive queue" },
+    [METRIC_HIST_TRACE_U2W_ENQUEUE_DISPATCH_US]    = { "station_trace_u2w_enqueue_dispatch_us",    "UART to Wi-Fi: receive queue to dispatcher" },
+    [METRIC_HIST_TRACE_U2W_DISPATCH_TX_ENQUEUE_US] = { "station_trace_u2w_dispatch_tx_enqueue_us", "UART to Wi-Fi: dispatcher to UDP aggregator" },
+    [METRIC_HIST_TRACE_U2W_TX_ENQUEUE_DONE_US]     = { "station_trace_u2w_tx_enqueue_done_us",     "UART to Wi-Fi: UDP aggregator to sendto done" },
+    [METRIC_HIST_TRACE_U2W_TOTAL_US]               = { "station_trace_u2w_total_us",               "UART to Wi-Fi: UART read to sendto done" },
+    [METRIC_HIST_TRACE_W2U_RX_ENQUEUE_US]          = { "station_trace_w2u_rx_enqueue_us",          "Wi-Fi to UART: recvfrom to receive pool" },
+    [METRIC_HIST_TRACE_W2U_ENQUEUE_DISPATCH_US]    = { "station_trace_w2u_enqueue_dispatch_us",    "Wi-Fi to UART: receive pool to dispatcher" },
+    [METRIC_HIST_TRACE_W2U_DISPATCH_TX_ENQUEUE_US] = { "station_trace_w2u_dispatch_tx_enqueue_us", "Wi-Fi to UART: dispatcher to UART transmit queue" },
+    [METRIC_HIST_TRACE_W2U_TX_ENQUEUE_DONE_US]     = { "station_trace_w2u_tx_enqueue_done_us",     "Wi-Fi to UART: UART transmit queue to driver write done" },
+    [METRIC_HIST_TRACE_W2U_TOTAL_US]               = { "station_trace_w2u_total_us",               "Wi-Fi to UART: recvfrom to driver write done" },
+};
+
+typedef struct {
+    uint32_t    buckets[METRIC_HIST_BUCKETS];
+    uint32_t    sum_lo;
+    uint32_t    sum_hi;
+} MetricHistCore;
+
+/**
+ * @brief 每個核心各自一份計數，只用原子加法更新，不需上鎖
+ *        One copy per core, updated with relaxed atomic adds only (no locks)
+ */
+static uint32_t metric_counters[portNUM_PROCESSORS][METRIC_COUNTER_COUNT];
+static MetricHistCore metric_hists[portNUM_PROCESSORS][METRIC_HIST_COUNT];
+// 量表只有單一寫入者，不分核心 (gauges have a single writer, no per-core copies)
+static uint32_t metric_gauges[METRIC_GAUGE_COUNT];
+
+/**
+ * @brief 累加計數器
+ *        Add to a counter on the calling core's slot
+ */
+void metrics_add(MetricCounter id, uint32_t value) {
+    if (id >= METRIC_COUNTER_COUNT) return;
+    __atomic_fetch_add(&metric_counters[xPortGetCoreID()][id], value, __ATOMIC_RELAXED);
+}
+
+static uint8_t metrics_bucket_of(uint32_t value_us) {
+    uint8_t idx = 0;
+    while (idx < METRIC_HIST_BUCKETS - 1 && value_us > (1UL << idx)) idx++;
+    return idx;
+}
+
+/**
+ * @brief 記錄一筆延遲樣本
+ *        Record one latency sample
+ *
+ * @note 64-bit 總和拆成兩個 32-bit 原子字，讀取時可能短暫不一致 (the 64-bit sum is two atomic words, reads may briefly tear)
+ */
+void metrics_observe(MetricHist id, uint32_t value_us) {
+    if (id >= METRIC_HIST_COUNT) return;
+    MetricHistCore *hist = &metric_hists[xPortGetCoreID()][id];
+    __atomic_fetch_add(&hist->buckets[metrics_bucket_of(value_us)], 1, __ATOMIC_RELAXED);
+    uint32_t old = __atomic_fetch_add(&hist->sum_lo, value_us, __ATOMIC_RELAXED);
+    if ((uint32_t)(old + value_us) < old) {
+        __atomic_fetch_add(&hist->sum_hi, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief 設定量表數值
+ *        Set a gauge
+ */
+void metrics_gauge_set(MetricGauge id, uint32_t value) {
+    if (id >= METRIC_GAUGE_COUNT) return;
+    __atomic_store_n(&metric_gauges[id], value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 量表只保留最大值
+ *        Raise a gauge to value when larger (running maximum)
+ */
+void metrics_gauge_max(MetricGauge id, uint32_t value) {
+    if (id >= METRIC_GAUGE_COUNT) return;
+    uint32_t old = __atomic_load_n(&metric_gauges[id], __ATOMIC_RELAXED);
+    while (value > old && !__atomic_compare_exchange_n(&metric_gauges[id], &old, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+uint32_t metrics_gauge_get(MetricGauge id) {
+    if (id >= METRIC_GAUGE_COUNT) return 0;
+    return __atomic_load_n(&metric_gauges[id], __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 所有核心的計數總和
+ *        Counter total across all cores
+ */
+uint32_t metrics_counter_total(MetricCounter id) {
+    uint32_t total = 0;
+    if (id >= METRIC_COUNTER_COUNT) return 0;
+    for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+        total += __atomic_load_n(&metric_counters[core][id], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+/**
+ * @brief 合併所有核心的直方圖
+ *        Merge a histogram across all cores
+ */
+void metrics_hist_snapshot(MetricHist id, MetricHistSnapshot *snap) {
+    MetricHistSnapshot merged = {0};
+    if (id < METRIC_HIST_COUNT) {
+        for (uint8_t core = 0; core < portNUM_PROCESSORS; core++) {
+            MetricHistCore *hist = &metric_hists[core][id];
+            for (uint8_t i = 0; i < METRIC_HIST_BUCKETS; i++) {
+                uint32_t n = __atomic_load_n(&hist->buckets[i], __ATOMIC_RELAXED);
+                merged.buckets[i] += n;
+                merged.count      += n;
+            }
+            merged.sum += ((uint64_t)__atomic_load_n(&hist->sum_hi, __ATOMIC_RELAXED) << 32)
+                        | __atomic_load_n(&hist->sum_lo, __ATOMIC_RELAXED);
+        }
+    }
+    *snap = merged;
+}
+
+/**
+ * @brief 以 bucket 上界估算百分位數
+ *        Estimate a percentile as the upper bound of the bucket holding it
+ *
+ * @param percent 0 ~ 100
+ * @return uint32_t 微秒；最後一格回傳 UINT32_MAX (us, UINT32_MAX for the +Inf bucket)
+ */
+uint32_t metrics_hist_percentile(const MetricHistSnapshot *snap, uint8_t percent) {
+    if (snap->count == 0) return 0;
+    uint64_t rank = ((uint64_t)snap->count * percent + 99) / 100;
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < METRIC_HIST_BUCKETS; i++) {
+        seen += snap->buckets[i];
+        if (seen >= rank) {
+            return (i == METRIC_HIST_BUCKETS - 1) ? UINT32_MAX : (1UL << i);
+        }
+    }
+    return UINT32_MAX;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+#define METRICS_LINE_MAX    256
+
+static void metrics_write_line(MetricsWriteFn write, void *ctx, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+static void metrics_write_line(MetricsWriteFn write, void *ctx, const char *fmt, ...) {
+    char line[METRICS_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len <= 0) return;
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+    write(ctx, line, len);
+}
+
+/**
+ * @brief 以 Prometheus 文字格式輸出所有計數器、量表與直方圖
+ *        Render every counter, gauge and histogram in the Prometheus text exposition format
+ *
+ * @param write 輸出函式，會被多次呼叫 (sink called once per line)
+ * @param ctx 傳給 write 的參數 (opaque argument for write)
+ */
+void metrics_render(MetricsWriteFn write, void *ctx) {
+    for (uint8_t id = 0; id < METRIC_COUNTER_COUNT; id++) {
+        const MetricDesc *desc = &metric_counter_desc[id];
+        metrics_write_line(write, ctx, "# HELP %s %s\n# TYPE %s counter\n%s %lu\n",
+            desc->name, desc->help, desc->name, desc->name,
+            (unsigned long)metrics_counter_total(id));
+    }
+    for (uint8_t id = 0; id < METRIC_GAUGE_COUNT; id++) {
+        const MetricDesc *desc = &metric_gauge_desc[id];
+        metrics_write_line(write, ctx, "# HELP %s %s\n# TYPE %s gauge\n%s %lu\n",
+            desc->name, desc->help, desc->name, desc->name,
+            (unsigned long)metrics_gauge_get(id));
+    }
+    for (uint8_t id = 0; id < METRIC_HIST_COUNT; id++) {
+        const MetricDesc *desc = &metric_hist_desc[id];
+        MetricHistSnapshot snap;
+        metrics_hist_snapshot(id, &snap);
+        metrics_write_line(write, ctx, "# HELP %s %s\n# TYPE %s histogram\n",
+            desc->name, desc->help, desc->name);
+        uint32_t cumulative = 0;
+        for (uint8_t i = 0; i < METRIC_HIST_BUCKETS - 1; i++) {
+            cumulative += snap.buckets[i];
+            metrics_write_line(write, ctx, "%s_bucket{le=\"%lu\"} %lu\n",
+                desc->name, (unsigned long)(1UL << i), (unsigned long)cumulative);
+        }
+        metrics_write_line(write, ctx, "%s_bucket{le=\"+Inf\"} %lu\n%s_sum %llu\n%s_count %lu\n",
+            desc->name, (unsigned long)snap.count,
+            desc->name, (unsigned long long)snap.sum,
+            desc->name, (unsigned long)snap.count);
+        metrics_write_line(write, ctx, "# TYPE %s_p50 gauge\n%s_p50 %lu\n# TYPE %s_p99 gauge\n%s_p99 %lu\n",
+            desc->name, desc->name, (unsigned long)metrics_hist_percentile(&snap, 50),
+            desc->name, desc->name, (unsigned long)metrics_hist_percentile(&snap, 99));
+    }
+}
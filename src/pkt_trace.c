@@ -0,0 +1,63 @@
+#include "pkt_trace.h"
+// ----------------------------------------------------------------------------------------------------
+#include "metrics.h"
+#include "esp_timer.h"
+
+static const char *const pkt_trace_span_names[PKT_TRACE_SPAN_COUNT] = {
+    "rx_to_enqueue",
+    "enqueue_to_dispatch",
+    "dispatch_to_tx_enqueue",
+    "tx_enqueue_to_tx_done",
+    "total",
+};
+
+static const char *const pkt_trace_dir_names[PKT_DIR_COUNT] = {
+    [PKT_DIR_UART_TO_WIFI] = "uart_to_wifi",
+    [PKT_DIR_WIFI_TO_UART] = "wifi_to_uart",
+};
+
+/**
+ * @brief 記錄封包到達某階段的時間
+ *        Stamp the time a packet reached a stage
+ *
+ * @note 最低位元固定為 1，讓 0 保留給未經過的階段 (bit 0 is forced on so 0 keeps meaning "not reached")
+ */
+void pkt_trace_stamp(PktTrace *self, PktStage stage) {
+    if (stage >= PKT_STAGE_COUNT) return;
+    self->t_us[stage] = (uint32_t)esp_timer_get_time() | 1U;
+}
+
+/**
+ * @brief 標記送出完成，並把各階段間隔記入該方向的直方圖
+ *        Stamp TX completion and record every stage gap in the direction's histograms
+ *
+ * @note 未經過的階段 (例如 HTTP /cmd 沒有 RX) 會跳過，總延遲取第一個與最後一個時間戳
+ *       Stages not reached (e.g. /cmd has no RX) are skipped; the total spans the first to the last stamp
+ */
+void pkt_trace_finish(PktTrace *self, PktDir dir) {
+    if (dir >= PKT_DIR_COUNT) return;
+    pkt_trace_stamp(self, PKT_STAGE_TX_DONE);
+    MetricHist base = (dir == PKT_DIR_UART_TO_WIFI)
+        ? METRIC_HIST_TRACE_U2W_RX_ENQUEUE_US
+        : METRIC_HIST_TRACE_W2U_RX_ENQUEUE_US;
+    uint32_t first = 0;
+    for (uint8_t stage = 0; stage + 1 < PKT_STAGE_COUNT; stage++) {
+        uint32_t from = self->t_us[stage];
+        uint32_t to   = self->t_us[stage + 1];
+        if (from == 0) continue;
+        if (first == 0) first = from;
+        if (to == 0) continue;
+        metrics_observe(base + stage, to - from);
+    }
+    if (first != 0) {
+        metrics_observe(base + PKT_TRACE_SPAN_TOTAL, self->t_us[PKT_STAGE_TX_DONE] - first);
+    }
+}
+
+const char *pkt_trace_span_name(uint8_t span) {
+    return span < PKT_TRACE_SPAN_COUNT ? pkt_trace_span_names[span] : "unknown";
+}
+
+const char *pkt_trace_dir_name(PktDir dir) {
+    return dir < PKT_DIR_COUNT ? pkt_trace_dir_names[dir] : "unknown";
+}
@@ -0,0 +1,95 @@
+#include "task_layout.h"
+// ----------------------------------------------------------------------------------------------------
+#include "prioritites_sequ.h"
+#include "esp_log.h"
+
+static const char *TAG = "task_layout";
+
+/**
+ * @brief 任務堆疊與控制區全部靜態配置，大小由 Kconfig 決定
+ *        Every task stack and TCB is static, sized from Kconfig
+ */
+static StackType_t task_stack_uart_rx[CONFIG_STATION_STACK_UART_RX];
+static StackType_t task_stack_uart_tx[CONFIG_STATION_STACK_UART_TX];
+static StackType_t task_stack_dispatcher[CONFIG_STATION_STACK_DISPATCHER];
+static StackType_t task_stack_wifi_udp_rx[CONFIG_STATION_STACK_WIFI_UDP_RX];
+static StackType_t task_stack_wifi_tcp_rx[CONFIG_STATION_STACK_WIFI_TCP_RX];
+#if CONFIG_STATION_UDP_ECHO
+static StackType_t task_stack_wifi_udp_echo[CONFIG_STATION_STACK_WIFI_UDP_ECHO];
+#define TASK_STACK_WIFI_UDP_ECHO    task_stack_wifi_udp_echo, sizeof(task_stack_wifi_udp_echo)
+#else
+#define TASK_STACK_WIFI_UDP_ECHO    NULL, 0
+#endif
+#if CONFIG_STATION_UART_PORT_COUNT > 1
+static StackType_t task_stack_uart2_rx[CONFIG_STATION_STACK_UART_RX];
+static StackType_t task_stack_uart2_tx[CONFIG_STATION_STACK_UART_TX];
+#define TASK_STACK_UART2_RX         task_stack_uart2_rx, sizeof(task_stack_uart2_rx)
+#define TASK_STACK_UART2_TX         task_stack_uart2_tx, sizeof(task_stack_uart2_tx)
+#else
+#define TASK_STACK_UART2_RX         NULL, 0
+#define TASK_STACK_UART2_TX         NULL, 0
+#endif
+static StaticTask_t task_tcbs[TASK_ID_COUNT];
+
+#define TASK_STACK(stack)   stack, sizeof(stack)
+
+/**
+ * @brief 所有應用程式任務的名稱、堆疊、優先權與核心
+ *        Name, stack, priority and core of every application task
+ *
+ * @note 堆疊大小依 GET /tasks 回報的 stack_min_free 調整 (tune stack sizes from stack_min_free in GET /tasks)
+ */
+const TaskLayout task_layouts[TASK_ID_COUNT] = {
+    [TASK_ID_UART_RX]       = { "uart_rx_task", TASK_STACK(task_stack_uart_rx),     UART_READ_TASK_PRIO_SEQU,     TASK_CORE_CONTROL },
+    [TASK_ID_UART_TX]       = { "uart_tx_task", TASK_STACK(task_stack_uart_tx),     UART_WRITE_TASK_PRIO_SEQU,    TASK_CORE_CONTROL },
+    [TASK_ID_DISPATCHER]    = { "dispatcher",   TASK_STACK(task_stack_dispatcher),  DISPATCHER_TASK_PRIO_SEQU,    TASK_CORE_CONTROL },
+    [TASK_ID_WIFI_UDP_RX]   = { "udp_server",   TASK_STACK(task_stack_wifi_udp_rx), WIFI_UDP_READ_TASK_PRIO_SEQU, TASK_CORE_NETWORK },
+    [TASK_ID_WIFI_TCP_RX]   = { "tcp_recv",     TASK_STACK(task_stack_wifi_tcp_rx), WIFI_TCP_READ_TASK_PRIO_SEQU, TASK_CORE_NETWORK },
+    [TASK_ID_WIFI_UDP_ECHO] = { "udp_echo",     TASK_STACK_WIFI_UDP_ECHO,           WIFI_UDP_READ_TASK_PRIO_SEQU, TASK_CORE_NETWORK },
+    [TASK_ID_UART2_RX]      = { "uart2_rx",     TASK_STACK_UART2_RX,                UART_READ_TASK_PRIO_SEQU,     TASK_CORE_CONTROL },
+    [TASK_ID_UART2_TX]      = { "uart2_tx",     TASK_STACK_UART2_TX,                UART_WRITE_TASK_PRIO_SEQU,    TASK_CORE_CONTROL },
+};
+
+static TaskHandle_t task_handles[TASK_ID_COUNT];
+
+/**
+ * @brief 以靜態堆疊建立並固定核心的任務，每個任務只能建立一次
+ *        Create a task on its static stack, pinned to the core from the layout table; once per task
+ *
+ * @note ESP-IDF 的 StackType_t 為 uint8_t，堆疊深度即位元組數 (StackType_t is a byte on ESP-IDF, so depth is in bytes)
+ *
+ * @return false 建立失敗或已建立 (creation failed or already running)
+ */
+bool task_layout_spawn(TaskId id, TaskFunction_t fn, void *arg) {
+    if (id >= TASK_ID_COUNT || task_handles[id] != NULL) return 0;
+    const TaskLayout *layout = &task_layouts[id];
+    if (layout->stack == NULL) return 0;
+    task_handles[id] = xTaskCreateStaticPinnedToCore(
+        fn, layout->name, layout->stack_size / sizeof(StackType_t), arg, layout->priority,
+        layout->stack, &task_tcbs[id], layout->core
+    );
+    if (task_handles[id] == NULL) {
+        ESP_LOGE(TAG, "Failed to create %s", layout->name);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief 由任務 handle 反查配置
+ *        Find the layout entry of a running task
+ *
+ * @return const TaskLayout* 非本表任務時為 NULL (NULL for tasks not in the table)
+ */
+const TaskLayout *task_layout_find(TaskHandle_t handle) {
+    if (handle == NULL) return NULL;
+    for (uint8_t i = 0; i < TASK_ID_COUNT; i++) {
+        if (task_handles[i] == handle) return &task_layouts[i];
+    }
+    return NULL;
+}
+
+TaskHandle_t task_layout_handle(TaskId id) {
+    if (id >= TASK_ID_COUNT) return NULL;
+    return task_handles[id];
+}
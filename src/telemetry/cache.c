@@ -0,0 +1,122 @@
+#include "telemetry/cache.h"
+#include <string.h>
+#include "esp_timer.h"
+
+typedef struct {
+    uint32_t    seq;    // 奇數表示寫入中 (odd while a write is in progress)
+    float       value;
+    uint32_t    t_us;
+    uint32_t    count;
+} TelemetryCacheSlot;
+
+static TelemetryCacheSlot telemetry_cache_slots[TELEMETRY_CH_COUNT];
+
+static const char *const telemetry_cache_state_names[] = {
+    [TELEMETRY_CACHE_EMPTY] = "empty",
+    [TELEMETRY_CACHE_FRESH] = "fresh",
+    [TELEMETRY_CACHE_STALE] = "stale",
+};
+
+/**
+ * @brief 遙測接收端：更新該通道的快取值
+ *        Telemetry sink: store the sample as its channel's latest value
+ *
+ * @note 只在分派任務中呼叫 (single writer, the dispatcher task)
+ */
+static void telemetry_cache_sink(const TelemetrySample *sample) {
+    if (sample->channel >= TELEMETRY_CH_COUNT) return;
+    TelemetryCacheSlot *slot = &telemetry_cache_slots[sample->channel];
+    uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    float value = sample->value;
+    __atomic_store(&slot->value, &value, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->t_us, sample->t_us, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->count, slot->count + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 註冊快取的遙測接收端，應在 UART 開始接收前呼叫
+ *        Register the cache's telemetry sink; call before UART reception starts
+ */
+void telemetry_cache_setup(void) {
+    telemetry_sink_register(telemetry_cache_sink);
+}
+
+/**
+ * @brief 讀取通道最新值的一致快照
+ *        Read a consistent snapshot of a channel's latest value
+ *
+ * @param channel 遙測通道 (telemetry channel)
+ * @param max_age_us 超過此年齡視為過期 (older samples are reported stale)
+ * @param entry 輸出快照，EMPTY 時內容為 0 (output snapshot, zeroed when EMPTY)
+ * @return TelemetryCacheState
+ *
+ * @note 寫入者是優先權較高的分派任務，讀取端最多只會在另一核心短暫重試
+ *       The writer is the higher-priority dispatcher, so a reader retries at most briefly from the other core
+ */
+TelemetryCacheState telemetry_cache_read(TelemetryChannel channel, uint32_t max_age_us, TelemetryCacheEntry *entry) {
+    *entry = (TelemetryCacheEntry){0};
+    if (channel >= TELEMETRY_CH_COUNT) return TELEMETRY_CACHE_EMPTY;
+    TelemetryCacheSlot *slot = &telemetry_cache_slots[channel];
+    uint32_t begin, end;
+    do {
+        begin = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        __atomic_load(&slot->value, &entry->value, __ATOMIC_RELAXED);
+        entry->t_us  = __atomic_load_n(&slot->t_us, __ATOMIC_RELAXED);
+        entry->count = __atomic_load_n(&slot->count, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        end = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    } while ((begin & 1U) || begin != end);
+    if (entry->count == 0) return TELEMETRY_CACHE_EMPTY;
+    entry->age_us = (uint32_t)esp_timer_get_time() - entry->t_us;
+    return entry->age_us > max_age_us ? TELEMETRY_CACHE_STALE : TELEMETRY_CACHE_FRESH;
+}
+
+static uint8_t *telemetry_cache_put_u32(uint8_t *out, uint32_t value) {
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)value;
+    return out + 4;
+}
+
+/**
+ * @brief 將選取通道的快照編碼成 UDP 快照紀錄內容
+ *        Encode the selected channels' snapshots as a UDP snapshot record payload
+ *
+ * 每個通道 TELEMETRY_CACHE_ENTRY_WIRE_SIZE 位元組 (大端序)：
+ * channel u8 | state u8 | age_us u32 | value f32
+ * TELEMETRY_CACHE_ENTRY_WIRE_SIZE bytes per channel (big-endian) as shown above.
+ *
+ * @param channel_mask bit i 選取通道 i，0 表示全部 (bit i selects channel i, 0 selects all)
+ * @param max_age_us 過期門檻 (staleness bound)
+ * @param out 輸出緩衝區 (output buffer)
+ * @param cap 輸出緩衝區大小 (output capacity)
+ * @return uint8_t 寫入的位元組數 (bytes written)
+ */
+uint8_t telemetry_cache_encode(uint8_t channel_mask, uint32_t max_age_us, uint8_t *out, uint8_t cap) {
+    if (channel_mask == 0) channel_mask = (1U << TELEMETRY_CH_COUNT) - 1;
+    uint8_t len = 0;
+    for (uint8_t ch = 0; ch < TELEMETRY_CH_COUNT; ch++) {
+        if (!(channel_mask & (1U << ch))) continue;
+        if (len + TELEMETRY_CACHE_ENTRY_WIRE_SIZE > cap) break;
+        TelemetryCacheEntry entry;
+        TelemetryCacheState state = telemetry_cache_read(ch, max_age_us, &entry);
+        uint32_t raw;
+        memcpy(&raw, &entry.value, sizeof(raw));
+        uint8_t *p = out + len;
+        *p++ = ch;
+        *p++ = state;
+        p = telemetry_cache_put_u32(p, entry.age_us);
+        telemetry_cache_put_u32(p, raw);
+        len += TELEMETRY_CACHE_ENTRY_WIRE_SIZE;
+    }
+    return len;
+}
+
+const char *telemetry_cache_state_name(TelemetryCacheState state) {
+    if (state > TELEMETRY_CACHE_STALE) return "unknown";
+    return telemetry_cache_state_names[state];
+}
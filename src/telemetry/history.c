@@ -0,0 +1,124 @@
+#include "telemetry/history.h"
+
+#define TELEMETRY_HISTORY_MASK  (TELEMETRY_HISTORY_LEN - 1)
+
+typedef struct {
+    uint32_t    t_us[TELEMETRY_HISTORY_LEN];
+    float       value[TELEMETRY_HISTORY_LEN];
+    uint32_t    written;    // 累計寫入筆數，槽位為 written & MASK (running sample count, slot = index & MASK)
+} TelemetryHistoryRing;
+
+static TelemetryHistoryRing telemetry_history_rings[TELEMETRY_CH_COUNT];
+
+/**
+ * @brief 遙測接收端：常數時間附加一筆樣本，覆蓋最舊的槽位
+ *        Telemetry sink: append one sample in constant time, overwriting the oldest slot
+ *
+ * @note 只在分派任務中呼叫 (single writer, the dispatcher task)
+ */
+static void telemetry_history_sink(const TelemetrySample *sample) {
+    if (sample->channel >= TELEMETRY_CH_COUNT) return;
+    TelemetryHistoryRing *ring = &telemetry_history_rings[sample->channel];
+    uint32_t index = __atomic_load_n(&ring->written, __ATOMIC_RELAXED);
+    ring->t_us[index & TELEMETRY_HISTORY_MASK]  = sample->t_us;
+    ring->value[index & TELEMETRY_HISTORY_MASK] = sample->value;
+    __atomic_store_n(&ring->written, index + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 註冊歷史紀錄的遙測接收端，應在 UART 開始接收前呼叫
+ *        Register the history's telemetry sink; call before UART reception starts
+ */
+void telemetry_history_setup(void) {
+    telemetry_sink_register(telemetry_history_sink);
+}
+
+/**
+ * @brief 最舊且不會立即被覆蓋的樣本序號
+ *        Index of the oldest sample that is not about to be overwritten
+ *
+ * @note 保留一個槽位給可能正在進行的寫入 (one slot is left for a write that may be in progress)
+ */
+uint32_t telemetry_history_oldest(TelemetryChannel channel) {
+    if (channel >= TELEMETRY_CH_COUNT) return 0;
+    uint32_t written = __atomic_load_n(&telemetry_history_rings[channel].written, __ATOMIC_ACQUIRE);
+    return written >= TELEMETRY_HISTORY_LEN ? written - TELEMETRY_HISTORY_LEN + 1 : 0;
+}
+
+/**
+ * @brief 從 cursor 開始依時間順序複製最多 max 筆樣本，並前移 cursor
+ *        Copy up to max samples in time order starting at cursor, advancing cursor
+ *
+ * @param channel 遙測通道 (telemetry channel)
+ * @param cursor 樣本序號，落後太多時會跳到最舊的有效樣本 (sample index, moved up to the oldest valid one when overrun)
+ * @param t_us 輸出時間欄 (output time column)
+ * @param value 輸出數值欄 (output value column)
+ * @param max 輸出容量 (output capacity)
+ * @return uint16_t 複製的筆數，0 表示已讀到最新 (samples copied, 0 once caught up)
+ *
+ * @note 複製後再檢查一次寫入序號，期間被覆蓋的話整批重讀
+ *       The write index is re-checked after copying; a batch overrun meanwhile is read again
+ */
+uint16_t telemetry_history_read(TelemetryChannel channel, uint32_t *cursor, uint32_t *t_us, float *value, uint16_t max) {
+    if (channel >= TELEMETRY_CH_COUNT) return 0;
+    TelemetryHistoryRing *ring = &telemetry_history_rings[channel];
+    while (1) {
+        uint32_t oldest = telemetry_history_oldest(channel);
+        uint32_t written = __atomic_load_n(&ring->written, __ATOMIC_ACQUIRE);
+        if ((int32_t)(*cursor - oldest) < 0) *cursor = oldest;
+        uint32_t avail = written - *cursor;
+        uint16_t count = avail < max ? (uint16_t)avail : max;
+        for (uint16_t i = 0; i < count; i++) {
+            uint32_t slot = (*cursor + i) & TELEMETRY_HISTORY_MASK;
+            t_us[i]  = ring->t_us[slot];
+            value[i] = ring->value[slot];
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t after = __atomic_load_n(&ring->written, __ATOMIC_RELAXED);
+        if (after - *cursor < TELEMETRY_HISTORY_LEN) {
+            *cursor += count;
+            return count;
+        }
+    }
+}
+
+TelemetryDecimator telemetry_decimator_new(uint32_t step_us) {
+    return (TelemetryDecimator){ .step_us = step_us };
+}
+
+/**
+ * @brief 加入一筆樣本，若因此關閉前一個區間則輸出其結果
+ *        Add one sample; when it closes the previous bucket, output that bucket
+ *
+ * @note step_us 為 0 時不降採樣，每筆樣本直接輸出 (step_us 0 passes every sample through)
+ *
+ * @return true out_t_us/out_value 有一筆輸出 (one point was written to out_t_us/out_value)
+ */
+bool telemetry_decimator_push(TelemetryDecimator *self, uint32_t t_us, float value, uint32_t *out_t_us, float *out_value) {
+    if (self->step_us == 0) {
+        *out_t_us = t_us;
+        *out_value = value;
+        return 1;
+    }
+    bool emitted = false;
+    if (self->count > 0 && t_us - self->first_us >= self->step_us) {
+        emitted = telemetry_decimator_flush(self, out_t_us, out_value);
+    }
+    if (self->count == 0) self->first_us = t_us;
+    self->sum += value;
+    self->count++;
+    return emitted;
+}
+
+/**
+ * @brief 輸出尚未關閉的區間 (查詢結束時呼叫)
+ *        Output the open bucket, called at the end of a query
+ */
+bool telemetry_decimator_flush(TelemetryDecimator *self, uint32_t *out_t_us, float *out_value) {
+    if (self->count == 0) return 0;
+    *out_t_us = self->first_us;
+    *out_value = self->sum / self->count;
+    self->sum = 0;
+    self->count = 0;
+    return 1;
+}
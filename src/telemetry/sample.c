@@ -0,0 +1,102 @@
+#include "telemetry/sample.h"
+#include "mcu_const.h"
+#include <string.h>
+#include "esp_timer.h"
+
+#define CMD_STORE_LEN   2
+
+static TelemetrySink telemetry_sinks[TELEMETRY_SINK_MAX];
+static uint8_t telemetry_sink_count = 0;
+
+typedef struct {
+    const uint8_t       *cmd;
+    TelemetryChannel    channel;
+    uint8_t             size;
+} TelemetryStore;
+
+static const TelemetryStore telemetry_stores[TELEMETRY_CH_COUNT] = {
+    { CMD_LEFT_SPEED_STORE,  TELEMETRY_CH_LEFT_SPEED,  sizeof(float) },
+    { CMD_LEFT_ADC_STORE,    TELEMETRY_CH_LEFT_ADC,    sizeof(uint16_t) },
+    { CMD_RIGHT_SPEED_STORE, TELEMETRY_CH_RIGHT_SPEED, sizeof(float) },
+    { CMD_RIGHT_ADC_STORE,   TELEMETRY_CH_RIGHT_ADC,   sizeof(uint16_t) },
+};
+
+static const char *const telemetry_channel_names[TELEMETRY_CH_COUNT] = {
+    [TELEMETRY_CH_LEFT_SPEED]   = "left_speed",
+    [TELEMETRY_CH_LEFT_ADC]     = "left_adc",
+    [TELEMETRY_CH_RIGHT_SPEED]  = "right_speed",
+    [TELEMETRY_CH_RIGHT_ADC]    = "right_adc",
+};
+
+/**
+ * @brief 從 VecU8 前端讀出 size 個大端序位元組
+ *        Read size big-endian bytes from the front of VecU8
+ */
+static bool telemetry_read_be(const VecU8 *vec_u8, uint16_t offset, uint8_t size, uint32_t *out) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++) {
+        uint8_t byte;
+        if (!vec_u8_get_byte(vec_u8, &byte, offset + i)) return 0;
+        value = (value << 8) | byte;
+    }
+    *out = value;
+    return 1;
+}
+
+/**
+ * @brief 若 VecU8 以 *_STORE 命令開頭，取出其數值並自 VecU8 移除
+ *        If VecU8 starts with a *_STORE command, decode its value and consume it
+ *
+ * @note 速度為 IEEE-754 f32，ADC 為 u16，皆為大端序 (speed is f32, ADC is u16, both big-endian)
+ *
+ * @param vec_u8 去除命令碼後的資料向量 (data vector without the command code)
+ * @param sample 輸出樣本，不含時間戳 (output sample, timestamp left untouched)
+ * @return false 非 STORE 命令或資料長度不足 (not a STORE command or truncated value)
+ */
+bool telemetry_take_store(VecU8 *vec_u8, TelemetrySample *sample) {
+    for (uint8_t i = 0; i < TELEMETRY_CH_COUNT; i++) {
+        uint32_t raw;
+        const TelemetryStore *store = &telemetry_stores[i];
+        if (!vec_u8_starts_with(vec_u8, store->cmd, CMD_STORE_LEN)) continue;
+        if (!telemetry_read_be(vec_u8, CMD_STORE_LEN, store->size, &raw)) return 0;
+        sample->channel = store->channel;
+        if (store->size == sizeof(float)) {
+            memcpy(&sample->value, &raw, sizeof(float));
+        } else {
+            sample->value = (float)raw;
+        }
+        vec_u8_rm_range(vec_u8, 0, CMD_STORE_LEN + store->size);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 註冊遙測接收端，新樣本會依序交給每個接收端
+ *        Register a telemetry sink; every new sample is handed to each sink in order
+ *
+ * @note 僅應於開機時呼叫 (call during startup only)
+ *
+ * @return false 接收端數量已達上限 (sink table full)
+ */
+bool telemetry_sink_register(TelemetrySink sink) {
+    if (telemetry_sink_count >= TELEMETRY_SINK_MAX) return 0;
+    telemetry_sinks[telemetry_sink_count++] = sink;
+    return 1;
+}
+
+/**
+ * @brief 加上時間戳並發佈一筆遙測樣本
+ *        Timestamp a telemetry sample and hand it to every registered sink
+ */
+void telemetry_publish(TelemetrySample *sample) {
+    sample->t_us = (uint32_t)esp_timer_get_time();
+    for (uint8_t i = 0; i < telemetry_sink_count; i++) {
+        telemetry_sinks[i](sample);
+    }
+}
+
+const char *telemetry_channel_name(TelemetryChannel channel) {
+    if (channel >= TELEMETRY_CH_COUNT) return "unknown";
+    return telemetry_channel_names[channel];
+}
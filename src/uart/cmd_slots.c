@@ -0,0 +1,179 @@
+#include "uart/cmd_slots.h"
+#include "mcu_const.h"
+#include "metrics.h"
+#include "esp_timer.h"
+#include <string.h>
+
+static const uint8_t uart_cmd_slot_codes[UART_CMD_SLOT_COUNT] = {
+    [UART_CMD_SLOT_ESTOP]       = CMD_CODE_VECH_CONTROL,
+    [UART_CMD_SLOT_MOTION]      = CMD_CODE_VECH_CONTROL,
+    [UART_CMD_SLOT_LEFT_SPEED]  = CMD_CODE_DATA_TRRE,
+    [UART_CMD_SLOT_LEFT_ADC]    = CMD_CODE_DATA_TRRE,
+    [UART_CMD_SLOT_RIGHT_SPEED] = CMD_CODE_DATA_TRRE,
+    [UART_CMD_SLOT_RIGHT_ADC]   = CMD_CODE_DATA_TRRE,
+};
+
+static const uint8_t uart_cmd_slot_args_len[UART_CMD_SLOT_COUNT] = {
+    [UART_CMD_SLOT_ESTOP]       = 1,
+    [UART_CMD_SLOT_MOTION]      = 1,
+    [UART_CMD_SLOT_LEFT_SPEED]  = 3,
+    [UART_CMD_SLOT_LEFT_ADC]    = 3,
+    [UART_CMD_SLOT_RIGHT_SPEED] = 3,
+    [UART_CMD_SLOT_RIGHT_ADC]   = 3,
+};
+
+/**
+ * @brief 判斷命令屬於哪個槽位
+ *        Classify a command into its slot
+ *
+ * @note ONLY_ONCE 請求仍走 FIFO，每一個都必須送達；串接的 DATA_TRRE 由 uart_cmd_batch_add 先拆開
+ *       ONLY_ONCE requests stay in the FIFO, each one must arrive; uart_cmd_batch_add splits chained
+ *       DATA_TRRE records before they get here
+ *
+ * @return UartCmdSlot 不屬於任何槽位時為 UART_CMD_SLOT_NONE (UART_CMD_SLOT_NONE when not slotted)
+ */
+UartCmdSlot uart_cmd_slot_of(uint8_t code, const uint8_t *args, uint8_t args_len) {
+    if (code == CMD_CODE_VECH_CONTROL && args_len == 1) return UART_CMD_SLOT_MOTION;
+    if (code != CMD_CODE_DATA_TRRE || args_len != 3) return UART_CMD_SLOT_NONE;
+    if (args[2] != CMD_CODE_LOOP_START && args[2] != CMD_CODE_LOOP_STOP) return UART_CMD_SLOT_NONE;
+    uint8_t motor = args[0];
+    uint8_t kind  = args[1];
+    if (motor != CMD_CODE_MOTOR_LEFT && motor != CMD_CODE_MOTOR_RIGHT) return UART_CMD_SLOT_NONE;
+    if (kind != CMD_CODE_SPEED && kind != CMD_CODE_ADC) return UART_CMD_SLOT_NONE;
+    if (motor == CMD_CODE_MOTOR_LEFT) {
+        return kind == CMD_CODE_SPEED ? UART_CMD_SLOT_LEFT_SPEED : UART_CMD_SLOT_LEFT_ADC;
+    }
+    return kind == CMD_CODE_SPEED ? UART_CMD_SLOT_RIGHT_SPEED : UART_CMD_SLOT_RIGHT_ADC;
+}
+
+/**
+ * @brief 是否為緊急停止命令
+ *        Whether a command is the emergency stop
+ */
+bool uart_cmd_is_estop(uint8_t code, const uint8_t *args, uint8_t args_len) {
+    return code == CMD_CODE_VECH_CONTROL && args_len == 1 && args[0] == CMD_MOVE_STOP[1];
+}
+
+/**
+ * @brief 排入緊急停止，作廢尚未送出的行進命令
+ *        Queue the emergency stop, superseding any motion not sent yet
+ *
+ * @note 重複的停止請求保留最早的請求時間與追蹤，延遲以最早的請求計算
+ *       Repeated stop requests keep the oldest request time and trace, latency counts from the first one
+ *
+ * @param trace 來源封包的追蹤時間戳，可為 NULL (trace stamps of the source packet, may be NULL)
+ */
+void uart_cmd_slots_estop(UartCmdSlots *self, const PktTrace *trace) {
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    taskENTER_CRITICAL(&self->lock);
+    UartCmdSlotEntry *entry = &self->set.entries[UART_CMD_SLOT_ESTOP];
+    if (!(self->set.pending & (1U << UART_CMD_SLOT_ESTOP))) {
+        entry->args[0] = CMD_MOVE_STOP[1];
+        entry->trace = trace != NULL ? *trace : (PktTrace){0};
+        self->set.estop_us = now_us;
+        self->set.pending |= 1U << UART_CMD_SLOT_ESTOP;
+    }
+    self->set.pending &= ~(1U << UART_CMD_SLOT_MOTION);
+    taskEXIT_CRITICAL(&self->lock);
+}
+
+/**
+ * @brief 寫入槽位，覆蓋尚未送出的舊命令
+ *        Write a slot, replacing a command that has not been sent yet
+ *
+ * @return true 覆蓋了待送命令 (a pending command was overwritten)
+ */
+bool uart_cmd_slot_set_put(UartCmdSlotSet *self, UartCmdSlot slot, const uint8_t *args) {
+    if (slot >= UART_CMD_SLOT_COUNT) return 0;
+    bool overwritten = (self->pending >> slot) & 1U;
+    memcpy(self->entries[slot].args, args, uart_cmd_slot_args_len[slot]);
+    self->entries[slot].trace = (PktTrace){0};
+    self->pending |= 1U << slot;
+    return overwritten;
+}
+
+/**
+ * @brief 把一批槽位命令併入待送槽位
+ *        Merge a batch's slotted commands into the pending slots
+ */
+void uart_cmd_slots_merge(UartCmdSlots *self, const UartCmdSlotSet *set) {
+    uint32_t overwrites = 0;
+    taskENTER_CRITICAL(&self->lock);
+    for (uint8_t slot = 0; slot < UART_CMD_SLOT_COUNT; slot++) {
+        if (!((set->pending >> slot) & 1U)) continue;
+        if ((self->set.pending >> slot) & 1U) overwrites++;
+        self->set.entries[slot] = set->entries[slot];
+        self->set.pending |= 1U << slot;
+    }
+    taskEXIT_CRITICAL(&self->lock);
+    if (overwrites > 0) metrics_add(METRIC_UART_CMD_COALESCED, overwrites);
+}
+
+/**
+ * @brief 取出待送槽位並組成一個 UART 封包
+ *        Take pending slots and build one UART frame from them
+ *
+ * @note 緊急停止與行進命令依序單獨送出；其餘回報模式槽位串接成同一個 DATA_TRRE 封包
+ *       E-stop, then motion, each go in a frame of their own; the report-mode slots are chained
+ *       into one DATA_TRRE frame
+ *
+ * @param taken 取出的槽位，寫入失敗時交給 uart_cmd_slots_restore (taken slots, for uart_cmd_slots_restore on failure)
+ * @param frame 輸出封包 (output frame)
+ * @return false 沒有待送槽位 (nothing pending)
+ */
+bool uart_cmd_slots_take(UartCmdSlots *self, UartCmdSlotSet *taken, UartPacket *frame) {
+    taskENTER_CRITICAL(&self->lock);
+    uint8_t pending = self->set.pending;
+    uint8_t mask = pending;
+    if (pending & (1U << UART_CMD_SLOT_ESTOP)) {
+        mask = 1U << UART_CMD_SLOT_ESTOP;
+    } else if (pending & (1U << UART_CMD_SLOT_MOTION)) {
+        mask = 1U << UART_CMD_SLOT_MOTION;
+    }
+    taken->pending = mask;
+    taken->estop_us = self->set.estop_us;
+    for (uint8_t slot = 0; slot < UART_CMD_SLOT_COUNT; slot++) {
+        if ((mask >> slot) & 1U) taken->entries[slot] = self->set.entries[slot];
+    }
+    self->set.pending &= ~mask;
+    taskEXIT_CRITICAL(&self->lock);
+    if (mask == 0) return 0;
+
+    VecU8 datas = vec_u8_new();
+    bool first = true;
+    for (uint8_t slot = 0; slot < UART_CMD_SLOT_COUNT; slot++) {
+        if (!((mask >> slot) & 1U)) continue;
+        if (first) {
+            vec_u8_push_byte(&datas, uart_cmd_slot_codes[slot]);
+            first = false;
+        }
+        vec_u8_push(&datas, taken->entries[slot].args, uart_cmd_slot_args_len[slot]);
+    }
+    *frame = uart_packet_new();
+    uart_pkt_add_data(frame, &datas);
+    for (uint8_t slot = 0; slot < UART_CMD_SLOT_COUNT; slot++) {
+        if ((mask >> slot) & 1U) {
+            frame->trace = taken->entries[slot].trace;
+            break;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief 寫入失敗時放回取出的槽位，期間已有更新命令的槽位保留新值
+ *        Put taken slots back after a failed write; slots rewritten meanwhile keep the newer command
+ *
+ * @note 期間排入的緊急停止會作廢放回的行進命令 (a stop queued meanwhile supersedes the restored motion)
+ */
+void uart_cmd_slots_restore(UartCmdSlots *self, const UartCmdSlotSet *taken) {
+    taskENTER_CRITICAL(&self->lock);
+    for (uint8_t slot = 0; slot < UART_CMD_SLOT_COUNT; slot++) {
+        if (!((taken->pending >> slot) & 1U) || ((self->set.pending >> slot) & 1U)) continue;
+        if (slot == UART_CMD_SLOT_MOTION && (self->set.pending & (1U << UART_CMD_SLOT_ESTOP))) continue;
+        self->set.entries[slot] = taken->entries[slot];
+        self->set.pending |= 1U << slot;
+        if (slot == UART_CMD_SLOT_ESTOP) self->set.estop_us = taken->estop_us;
+    }
+    taskEXIT_CRITICAL(&self->lock);
+}
@@ -0,0 +1,157 @@
+#include "uart/command.h"
+#include "mcu_const.h"
+#include <string.h>
+
+#define UART_CMD_DEF(str, cmd_code, bytes) { str, cmd_code, bytes, sizeof(bytes) }
+
+/**
+ * @brief 命令名稱對照表，命令內容來自 mcu_const.h
+ *        Command name table; the bytes come from mcu_const.h
+ *
+ * @note CMD_MOVE_* 已含命令碼，故只取第二個位元組作為參數
+ *       CMD_MOVE_* already carry the command code, only the second byte is the argument
+ */
+static const UartCmdDef uart_cmd_defs[] = {
+    { "move_stop",     CMD_CODE_VECH_CONTROL, CMD_MOVE_STOP + 1,     1 },
+    { "move_forward",  CMD_CODE_VECH_CONTROL, CMD_MOVE_FORWARD + 1,  1 },
+    { "move_backward", CMD_CODE_VECH_CONTROL, CMD_MOVE_BACKWARD + 1, 1 },
+    { "move_left",     CMD_CODE_VECH_CONTROL, CMD_MOVE_LEFT + 1,     1 },
+    { "move_right",    CMD_CODE_VECH_CONTROL, CMD_MOVE_RIGHT + 1,    1 },
+    UART_CMD_DEF("left_speed_start",  CMD_CODE_DATA_TRRE, CMD_LEFT_SPEED_START),
+    UART_CMD_DEF("left_speed_stop",   CMD_CODE_DATA_TRRE, CMD_LEFT_SPEED_STOP),
+    UART_CMD_DEF("left_speed_once",   CMD_CODE_DATA_TRRE, CMD_LEFT_SPEED_ONCE),
+    UART_CMD_DEF("left_adc_start",    CMD_CODE_DATA_TRRE, CMD_LEFT_ADC_START),
+    UART_CMD_DEF("left_adc_stop",     CMD_CODE_DATA_TRRE, CMD_LEFT_ADC_STOP),
+    UART_CMD_DEF("left_adc_once",     CMD_CODE_DATA_TRRE, CMD_LEFT_ADC_ONCE),
+    UART_CMD_DEF("right_speed_start", CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_START),
+    UART_CMD_DEF("right_speed_stop",  CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_STOP),
+    UART_CMD_DEF("right_speed_once",  CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_ONCE),
+    UART_CMD_DEF("right_adc_start",   CMD_CODE_DATA_TRRE, CMD_RIGHT_ADC_START),
+    UART_CMD_DEF("right_adc_stop",    CMD_CODE_DATA_TRRE, CMD_RIGHT_ADC_STOP),
+    UART_CMD_DEF("right_adc_once",    CMD_CODE_DATA_TRRE, CMD_RIGHT_ADC_ONCE),
+};
+
+/**
+ * @brief 依名稱查詢命令
+ *        Look a command up by name
+ *
+ * @param name 名稱，不需 '\0' 結尾 (name, not NUL terminated)
+ * @param name_len 名稱長度 (name length)
+ * @return const UartCmdDef* 找不到時為 NULL (NULL when unknown)
+ */
+const UartCmdDef *uart_cmd_find(const char *name, size_t name_len) {
+    for (size_t i = 0; i < sizeof(uart_cmd_defs) / sizeof(uart_cmd_defs[0]); i++) {
+        const UartCmdDef *def = &uart_cmd_defs[i];
+        if (strlen(def->name) == name_len && memcmp(def->name, name, name_len) == 0) {
+            return def;
+        }
+    }
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+void uart_cmd_batch_init(UartCmdBatch *self, UartLink *link) {
+    self->link  = link;
+    self->count = 0;
+    self->cmds  = 0;
+    self->slotted = 0;
+    self->slots.pending = 0;
+    self->trace = (PktTrace){0};
+}
+
+/**
+ * @brief 加入一個命令；與上一個封包同為 DATA_TRRE 時合併進同一個 UART 封包
+ *        Add one command; consecutive DATA_TRRE commands are coalesced into one UART frame
+ *
+ * @note 只合併緊鄰的 DATA_TRRE 封包，中間夾著其他命令碼時另開封包以保持 FIFO 順序
+ *       Only directly adjacent DATA_TRRE frames merge; another code in between starts a new frame
+ *       so the FIFO order is kept
+ *
+ * @note STM32 端會逐一處理 DATA_TRRE 封包中串接的子命令，其他命令碼各自成一個封包
+ *       The STM32 walks every sub-command chained in a DATA_TRRE frame; other codes get a frame each
+ * @note 行進與回報模式命令寫入批次的槽位，同一批內後者覆蓋前者；緊急停止直接進入優先通道
+ *       Motion and report-mode commands go to the batch's slots, a later one overriding an earlier
+ *       one; the emergency stop goes straight to the priority lane
+ * @note 串接多個子命令的 DATA_TRRE 先拆成單一子命令再分類，回報模式因此只存在於槽位，
+ *       FIFO 中不會有較舊的模式命令在槽位之後送出而蓋掉較新的模式，每個子命令各計一個命令
+ *       A DATA_TRRE chaining several sub-commands is split and each one classified, so report modes
+ *       only ever live in the slots and no older mode change can leave the FIFO after a newer
+ *       slotted one; every sub-command counts as one command
+ *
+ * @return false 批次已滿 (batch full)
+ */
+bool uart_cmd_batch_add(UartCmdBatch *self, uint8_t code, const uint8_t *args, uint8_t args_len) {
+    if (code == CMD_CODE_DATA_TRRE && args_len > UART_CMD_SLOT_ARGS_MAX && args_len % UART_CMD_SLOT_ARGS_MAX == 0) {
+        bool ok = true;
+        for (uint8_t i = 0; i < args_len; i += UART_CMD_SLOT_ARGS_MAX) {
+            if (!uart_cmd_batch_add(self, code, args + i, UART_CMD_SLOT_ARGS_MAX)) ok = false;
+        }
+        return ok;
+    }
+    if (uart_cmd_is_estop(code, args, args_len)) {
+        // 不等批次提交，立即進入優先通道 (straight into the priority lane, not held until commit)
+        PktTrace trace = self->trace;
+        pkt_trace_stamp(&trace, PKT_STAGE_TX_ENQUEUE);
+        self->slots.pending &= ~(1U << UART_CMD_SLOT_MOTION);
+        uart_cmd_slots_estop(&self->link->slots, &trace);
+        self->cmds++;
+        self->slotted++;
+        return 1;
+    }
+    UartCmdSlot slot = uart_cmd_slot_of(code, args, args_len);
+    if (slot != UART_CMD_SLOT_NONE) {
+        uart_cmd_slot_set_put(&self->slots, slot, args);
+        self->cmds++;
+        self->slotted++;
+        return 1;
+    }
+    if (self->count > 0) {
+        uint8_t last = self->count - 1;
+        VecU8 *datas = &self->packets[last].datas;
+        if (
+            code == CMD_CODE_DATA_TRRE &&
+            self->codes[last] == CMD_CODE_DATA_TRRE &&
+            datas->len + args_len <= PACKET_DATA_MAX_SIZE
+        ) {
+            vec_u8_push(datas, args, args_len);
+            self->cmds++;
+            return 1;
+        }
+    }
+    if (self->count >= UART_TRCV_BUF_CAP) return 0;
+    if (1 + args_len > PACKET_DATA_MAX_SIZE) return 0;
+    UartPacket *packet = &self->packets[self->count];
+    *packet = uart_packet_new();
+    vec_u8_push_byte(&packet->datas, code);
+    vec_u8_push(&packet->datas, args, args_len);
+    self->codes[self->count] = code;
+    self->count++;
+    self->cmds++;
+    return 1;
+}
+
+bool uart_cmd_batch_add_def(UartCmdBatch *self, const UartCmdDef *def) {
+    return uart_cmd_batch_add(self, def->code, def->args, def->args_len);
+}
+
+/**
+ * @brief 一次把整批封包排入目標埠的傳輸緩衝區；空間不足時整批都不排入。槽位命令一律寫入該埠的槽位
+ *        Queue the whole batch on the destination port at once; nothing is queued when it does not
+ *        fit. Slotted commands are always written to the port's slots
+ *
+ * @note 每個封包與槽位帶著批次的追蹤時間戳 (every frame and slot carries the batch's trace stamps)
+ *
+ * @return false 緩衝區剩餘空間不足，FIFO 部分被丟棄 (not enough free slots, the FIFO part was dropped)
+ */
+bool uart_cmd_batch_commit(UartCmdBatch *self) {
+    pkt_trace_stamp(&self->trace, PKT_STAGE_TX_ENQUEUE);
+    for (uint8_t i = 0; i < self->count; i++) {
+        self->packets[i].trace = self->trace;
+    }
+    for (uint8_t slot = 0; slot < UART_CMD_SLOT_COUNT; slot++) {
+        self->slots.entries[slot].trace = self->trace;
+    }
+    if (self->slots.pending) uart_cmd_slots_merge(&self->link->slots, &self->slots);
+    return uart_trcv_buf_push_all(&self->link->tx_buf, self->packets, self->count);
+}
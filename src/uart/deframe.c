@@ -0,0 +1,187 @@
+#include "uart/deframe.h"
+#include "mcu_const.h"
+
+#define UART_DEFRAME_CREDIT_ARGS    2
+#define UART_DEFRAME_RECORD_HEAD    2   // motor + kind
+
+typedef enum {
+    UART_DEFRAME_END_DATA,      // 依格式一定是資料 (data by the layout)
+    UART_DEFRAME_END_YES,       // 依格式一定是結尾 (the end by the layout)
+    UART_DEFRAME_END_MAYBE,     // 格式無法判斷，看下一個位元組 (undecided, the next byte decides)
+} UartDeframeEnd;
+
+/**
+ * @brief 封包外的單獨結束碼：後接 `{` 或位於讀取結尾 (a lone end code outside a frame)
+ */
+static bool uart_deframe_is_end(const uint8_t *data, uint16_t len, uint16_t i) {
+    return data[i] == PACKET_END_CODE && (i + 1 == len || data[i + 1] == PACKET_START_CODE);
+}
+
+static void uart_deframe_start(UartDeframer *self, uint8_t byte) {
+    self->state       = UART_DEFRAME_IN_FRAME;
+    self->buf[0]      = byte;
+    self->len         = 1;
+    self->overflow    = false;
+    self->end_pending = false;
+    self->layout      = UART_DEFRAME_LAYOUT_UNKNOWN;
+    self->rec_pos     = 0;
+    self->rec_size    = 0;
+}
+
+/**
+ * @brief 依封包格式追蹤一個資料位元組；不符合格式時改為未知格式
+ *        Follow one data byte through the frame's layout; a byte that does not fit makes it unknown
+ */
+static void uart_deframe_track(UartDeframer *self, uint8_t byte) {
+    if (self->len == 2) {
+        // 第一個資料位元組為命令碼 (the first data byte is the command code)
+        if (byte == CMD_CODE_FLOW_CREDIT) self->layout = UART_DEFRAME_LAYOUT_CREDIT;
+        if (byte == CMD_CODE_DATA_TRRE) self->layout = UART_DEFRAME_LAYOUT_REPORTS;
+        return;
+    }
+    switch (self->layout) {
+        case UART_DEFRAME_LAYOUT_CREDIT:
+            if (++self->rec_pos > UART_DEFRAME_CREDIT_ARGS) self->layout = UART_DEFRAME_LAYOUT_UNKNOWN;
+            break;
+        case UART_DEFRAME_LAYOUT_REPORTS:
+            if (self->rec_pos == 0) {
+                if (byte != CMD_CODE_MOTOR_LEFT && byte != CMD_CODE_MOTOR_RIGHT) self->layout = UART_DEFRAME_LAYOUT_UNKNOWN;
+            } else if (self->rec_pos == 1) {
+                // 速度為 f32，ADC 為 u16 (speed is f32, ADC is u16)
+                if (byte == CMD_CODE_SPEED) self->rec_size = UART_DEFRAME_RECORD_HEAD + sizeof(float);
+                else if (byte == CMD_CODE_ADC) self->rec_size = UART_DEFRAME_RECORD_HEAD + sizeof(uint16_t);
+                else self->layout = UART_DEFRAME_LAYOUT_UNKNOWN;
+            }
+            if (++self->rec_pos == self->rec_size) {
+                self->rec_pos  = 0;
+                self->rec_size = 0;
+            }
+            break;
+        case UART_DEFRAME_LAYOUT_UNKNOWN:
+            break;
+    }
+}
+
+/**
+ * @brief 判斷封包中的 `}` 是否為結尾 (decide whether a `}` inside a frame ends it)
+ *
+ * @note 數值回報在紀錄邊界上的下一個位元組是馬達編號，不會是 `}`，所以邊界上的 `}` 必為結尾；
+ *       但第三個位元組為 STOP/ONCE/START 時也可能是模式回應 (motor kind mode) 的結尾，只能看下一個位元組
+ *       After a whole value report the next byte would be a motor number, never `}`, so a `}` on a
+ *       record boundary is the end; after three bytes whose last is STOP/ONCE/START it may also end
+ *       a mode echo (motor kind mode), which only the next byte can tell
+ */
+static UartDeframeEnd uart_deframe_end_of(const UartDeframer *self) {
+    switch (self->layout) {
+        case UART_DEFRAME_LAYOUT_CREDIT:
+            return self->rec_pos == UART_DEFRAME_CREDIT_ARGS ? UART_DEFRAME_END_YES : UART_DEFRAME_END_DATA;
+        case UART_DEFRAME_LAYOUT_REPORTS:
+            if (self->rec_pos == 0) return self->len > 2 ? UART_DEFRAME_END_YES : UART_DEFRAME_END_MAYBE;
+            if (self->rec_pos == 1) return UART_DEFRAME_END_MAYBE;
+            if (self->rec_pos == 3 && self->buf[self->len - 1] <= CMD_CODE_LOOP_START) return UART_DEFRAME_END_MAYBE;
+            return UART_DEFRAME_END_DATA;
+        case UART_DEFRAME_LAYOUT_UNKNOWN:
+            break;
+    }
+    return UART_DEFRAME_END_MAYBE;
+}
+
+static bool uart_deframe_finish(UartDeframer *self, UartDeframeEvent *event, UartPacket *packet) {
+    self->state       = UART_DEFRAME_IDLE;
+    self->end_pending = false;
+    // 過長或沒有內容的 `{}` 都不是有效封包 (too long, or an empty `{}`, is not a valid frame)
+    if (self->overflow || self->len <= 2) {
+        *event = UART_DEFRAME_MALFORMED;
+        return 1;
+    }
+    VecU8 vec_u8 = vec_u8_new();
+    vec_u8_push(&vec_u8, self->buf, self->len);
+    *packet = uart_packet_new();
+    *event = uart_pkt_pack(packet, &vec_u8) ? UART_DEFRAME_FRAME : UART_DEFRAME_MALFORMED;
+    return 1;
+}
+
+/**
+ * @brief 從本次讀取的資料中取出下一個事件，未完成的封包保留到下一次讀取
+ *        Take the next event out of one read; an unfinished frame is kept for the next read
+ *
+ * @note 呼叫到回傳 false 為止，offset 初始請設為 0 (call until it returns false, start offset at 0)
+ *
+ * @param data 本次讀取的位元組 (bytes of this read)
+ * @param len 位元組數 (number of bytes)
+ * @param offset 目前位置 (cursor)
+ * @param event 輸出事件 (output event)
+ * @param packet event 為 UART_DEFRAME_FRAME 時的封包 (the frame when event is UART_DEFRAME_FRAME)
+ * @return false 本次讀取已處理完 (this read is used up)
+ */
+bool uart_deframe_next(UartDeframer *self, const uint8_t *data, uint16_t len, uint16_t *offset,
+    UartDeframeEvent *event, UartPacket *packet) {
+    while (*offset < len) {
+        uint16_t i = (*offset)++;
+        uint8_t byte = data[i];
+        switch (self->state) {
+            case UART_DEFRAME_IDLE:
+                if (byte != PACKET_START_CODE) {
+                    self->state = UART_DEFRAME_IN_NOISE;
+                    // 單獨的結束碼表示起始碼遺失 (a lone end code means the start code was lost)
+                    if (!uart_deframe_is_end(data, len, i)) break;
+                    self->state = UART_DEFRAME_IDLE;
+                    *event = UART_DEFRAME_MALFORMED;
+                    return 1;
+                }
+                uart_deframe_start(self, byte);
+                break;
+            case UART_DEFRAME_IN_NOISE:
+                if (byte == PACKET_START_CODE) {
+                    uart_deframe_start(self, byte);
+                    *event = UART_DEFRAME_NOISE;
+                    return 1;
+                }
+                if (uart_deframe_is_end(data, len, i)) {
+                    self->state = UART_DEFRAME_IDLE;
+                    *event = UART_DEFRAME_MALFORMED;
+                    return 1;
+                }
+                break;
+            case UART_DEFRAME_IN_FRAME: {
+                if (self->end_pending) {
+                    // 上次讀取結尾的 `}`：下一個位元組是 `{` 才是結尾 (the `}` ending the last read ends the frame only before `{`)
+                    self->end_pending = false;
+                    if (byte == PACKET_START_CODE) {
+                        (*offset)--;
+                        return uart_deframe_finish(self, event, packet);
+                    }
+                    uart_deframe_track(self, PACKET_END_CODE);
+                }
+                UartDeframeEnd end = byte == PACKET_END_CODE ? uart_deframe_end_of(self) : UART_DEFRAME_END_DATA;
+                if (self->len < sizeof(self->buf)) {
+                    self->buf[self->len++] = byte;
+                } else {
+                    self->overflow = true;
+                }
+                if (end == UART_DEFRAME_END_MAYBE) {
+                    if (i + 1 == len) {
+                        self->end_pending = true;
+                        break;
+                    }
+                    if (data[i + 1] == PACKET_START_CODE) end = UART_DEFRAME_END_YES;
+                }
+                if (end == UART_DEFRAME_END_YES) return uart_deframe_finish(self, event, packet);
+                uart_deframe_track(self, byte);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 線路靜默時呼叫：結束停在讀取結尾 `}` 上的封包
+ *        Call when the line went quiet: close a frame left open on a `}` that ended the last read
+ *
+ * @return false 沒有待定的封包 (no frame was pending)
+ */
+bool uart_deframe_flush(UartDeframer *self, UartDeframeEvent *event, UartPacket *packet) {
+    if (self->state != UART_DEFRAME_IN_FRAME || !self->end_pending) return 0;
+    return uart_deframe_finish(self, event, packet);
+}
@@ -0,0 +1,128 @@
+#include "uart/flow.h"
+#include "mcu_const.h"
+#include "metrics.h"
+
+/**
+ * @brief 初始化流量控制狀態，應在 UART 任務啟動前呼叫
+ *        Initialise the flow-control state; call before the UART tasks start
+ *
+ * @param window 本端接收緩衝區可容納的封包數 (frames our receive buffer holds)
+ * @param starve_us 等待信用的上限，逾時視為信用遺失並重新同步 (credit wait bound, after which credits are assumed lost and resynced)
+ * @param refresh_us 沒有變化時重新宣告信用的間隔 (re-advertise interval when nothing changed)
+ */
+void uart_flow_init(UartFlow *self, uint8_t window, uint32_t starve_us, uint32_t refresh_us) {
+    taskENTER_CRITICAL(&self->lock);
+    self->peer_window   = 0;
+    self->peer_consumed = 0;
+    self->sent          = 0;
+    self->blocked_us    = 0;
+    self->starve_us     = starve_us;
+    self->window        = window;
+    self->consumed      = 0;
+    self->advertised    = 0;
+    self->advertised_us = 0;
+    self->refresh_us    = refresh_us;
+    self->announced     = false;
+    taskEXIT_CRITICAL(&self->lock);
+}
+
+/**
+ * @brief 處理對方的信用封包
+ *        Handle a credit frame from the peer
+ *
+ * @note 對方第一次宣告時以其計數為起點 (the first advertisement becomes the starting point)
+ *
+ * @param data 封包資料，含命令碼 (frame data including the command code)
+ * @return true 是信用封包且已處理，不應再交給封包處理 (a credit frame, consumed here)
+ */
+bool uart_flow_on_credit(UartFlow *self, const uint8_t *data, uint16_t len) {
+    if (len != UART_FLOW_CREDIT_LEN || data[0] != CMD_CODE_FLOW_CREDIT) return 0;
+    taskENTER_CRITICAL(&self->lock);
+    // 對方計數超前表示飢餓重新同步時誤判為遺失的封包其實已送達 (a count ahead of ours means
+    // frames written off at a starvation resync did arrive)
+    if (self->peer_window == 0 || (int8_t)(self->sent - data[2]) < 0) self->sent = data[2];
+    self->peer_window   = data[1];
+    self->peer_consumed = data[2];
+    taskEXIT_CRITICAL(&self->lock);
+    return 1;
+}
+
+/**
+ * @brief 是否還有信用可以送出一個資料封包
+ *        Whether a credit is left for one more data frame
+ *
+ * @note 只在有資料待送時呼叫，第一次被擋下計為一次停頓；等待超過 starve_us
+ *       則視為信用遺失，以對方最後宣告的計數重新同步並放行
+ *       Call only with data waiting. The first refusal counts as a stall; a wait beyond
+ *       starve_us counts as starvation, resyncs to the peer's last count and lets the frame go
+ */
+bool uart_flow_can_send(UartFlow *self, uint32_t now_us) {
+    bool ok = false;
+    bool stalled = false;
+    bool starved = false;
+    taskENTER_CRITICAL(&self->lock);
+    if (self->peer_window == 0 || (uint8_t)(self->sent - self->peer_consumed) < self->peer_window) {
+        self->blocked_us = 0;
+        ok = true;
+    } else if (self->blocked_us == 0) {
+        self->blocked_us = now_us | 1U;
+        stalled = true;
+    } else if (now_us - self->blocked_us >= self->starve_us) {
+        self->sent = self->peer_consumed;
+        self->blocked_us = 0;
+        starved = true;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&self->lock);
+    if (stalled) metrics_inc(METRIC_UART_FLOW_STALLS);
+    if (starved) metrics_inc(METRIC_UART_FLOW_STARVED);
+    return ok;
+}
+
+/**
+ * @brief 記錄送出一個資料封包 (信用封包不計)
+ *        Count one data frame sent (credit frames excluded)
+ */
+void uart_flow_sent(UartFlow *self) {
+    taskENTER_CRITICAL(&self->lock);
+    self->sent++;
+    taskEXIT_CRITICAL(&self->lock);
+}
+
+/**
+ * @brief 記錄本端從接收緩衝區取出 (或因緩衝區滿丟棄) 的封包數
+ *        Count frames taken out of our receive buffer, or dropped because it was full
+ */
+void uart_flow_consumed(UartFlow *self, uint8_t count) {
+    taskENTER_CRITICAL(&self->lock);
+    self->consumed += count;
+    taskEXIT_CRITICAL(&self->lock);
+}
+
+/**
+ * @brief 需要宣告信用時組出信用封包
+ *        Build a credit frame when an advertisement is due
+ *
+ * @note 計數有變化、尚未宣告過或距上次宣告超過 refresh_us 時需要宣告
+ *       Due when the count changed, nothing was announced yet or refresh_us has passed
+ *
+ * @return true frame 為待送的信用封包 (frame holds a credit frame to send)
+ */
+bool uart_flow_credit_due(UartFlow *self, uint32_t now_us, UartPacket *frame) {
+    taskENTER_CRITICAL(&self->lock);
+    bool due = !self->announced || self->consumed != self->advertised ||
+        now_us - self->advertised_us >= self->refresh_us;
+    uint8_t credit[UART_FLOW_CREDIT_LEN] = { CMD_CODE_FLOW_CREDIT, self->window, self->consumed };
+    if (due) {
+        self->announced = true;
+        self->advertised = self->consumed;
+        self->advertised_us = now_us;
+    }
+    taskEXIT_CRITICAL(&self->lock);
+    if (!due) return 0;
+    VecU8 datas = vec_u8_new();
+    vec_u8_push(&datas, credit, sizeof(credit));
+    *frame = uart_packet_new();
+    uart_pkt_add_data(frame, &datas);
+    return 1;
+}
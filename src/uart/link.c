@@ -0,0 +1,30 @@
+#include "uart/link.h"
+
+UartLink uart_links[UART_LINK_COUNT];
+
+/**
+ * @brief 重設所有連線上下文，應在 UART 任務啟動前呼叫
+ *        Reset every link context; call before the UART tasks start
+ */
+void uart_links_init(void) {
+    for (uint8_t i = 0; i < UART_LINK_COUNT; i++) {
+        UartLink *link = &uart_links[i];
+        *link = (UartLink){
+            .index  = i,
+            .tx_buf = uart_trcv_buf_new(),
+            .rx_buf = uart_trcv_buf_new(),
+            .slots  = UART_CMD_SLOTS_INIT,
+            .flow   = { .lock = portMUX_INITIALIZER_UNLOCKED },
+        };
+    }
+}
+
+/**
+ * @brief 依埠號取得連線上下文
+ *        Look a link context up by port number
+ *
+ * @return UartLink* 埠號超出範圍時為 NULL (NULL when the port number is out of range)
+ */
+UartLink *uart_link_get(uint8_t index) {
+    return index < UART_LINK_COUNT ? &uart_links[index] : NULL;
+}
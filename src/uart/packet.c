@@ -81,25 +81,53 @@ UartPacket uart_packet_new(void) {
 // ----------------------------------------------------------------------------------------------------
 
 /**
- * @brief 將封包推入環形緩衝區，若已滿則返回 false
- *        Push a packet into the ring buffer; return false if buffer is full
+ * @brief 將封包推入環形緩衝區，若已滿則返回 false 並累計丟棄數
+ *        Push a packet into the ring buffer; return false and count a drop if buffer is full
  *
  * @param self 指向環形緩衝區的指標 (input/output ring buffer)
  * @param pkt 要推入緩衝區的 UART 封包 (input UART packet)
  * @return bool 是否推入成功 (true if push successful, false if buffer full)
  */
 bool uart_trcv_buf_push(UartTrcvBuf *self, const UartPacket *pkt) {
-    if (self->len >= UART_TRCV_BUF_CAP) return false;
-    uint8_t tail = (self->head + self->len) % UART_TRCV_BUF_CAP;
-    self->packets[tail] = *pkt;
-    self->len++;
-    return true;
+    return uart_trcv_buf_push_all(self, pkt, 1);
 }
 
-bool uart_trcv_buf_get_front(const UartTrcvBuf *self, UartPacket *pkt) {
-    if (self->len == 0) return 0;
-    *pkt = self->packets[self->head];
-    return 1;
+/**
+ * @brief 一次推入多個封包，空間不足時全部不推入
+ *        Push several packets at once; none are pushed when they do not all fit
+ *
+ * @param self 指向環形緩衝區的指標 (input/output ring buffer)
+ * @param pkts 要推入的封包陣列 (input packets)
+ * @param count 封包數量 (number of packets)
+ * @return bool 是否全部推入 (true if all were pushed)
+ */
+bool uart_trcv_buf_push_all(UartTrcvBuf *self, const UartPacket *pkts, uint8_t count) {
+    bool ok = false;
+    taskENTER_CRITICAL(&self->lock);
+    if (UART_TRCV_BUF_CAP - self->len < count) {
+        self->drops += count;
+    } else {
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t tail = (self->head + self->len) % UART_TRCV_BUF_CAP;
+            self->packets[tail] = pkts[i];
+            self->len++;
+        }
+        if (self->len > self->high_water) self->high_water = self->len;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&self->lock);
+    return ok;
+}
+
+bool uart_trcv_buf_get_front(UartTrcvBuf *self, UartPacket *pkt) {
+    bool ok = false;
+    taskENTER_CRITICAL(&self->lock);
+    if (self->len != 0) {
+        *pkt = self->packets[self->head];
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&self->lock);
+    return ok;
 }
 
 /**
@@ -111,14 +139,16 @@ bool uart_trcv_buf_get_front(const UartTrcvBuf *self, UartPacket *pkt) {
  * @return bool 是否彈出成功 (true if pop successful, false if buffer empty)
  */
 bool uart_trcv_buf_pop_front(UartTrcvBuf *self, UartPacket *pkt) {
-    if (self->len == 0) return 0;
-    if (pkt != NULL) *pkt = self->packets[self->head];
-    if (--self->len == 0) {
-        self->head = 0;
-    } else {
+    bool ok = false;
+    taskENTER_CRITICAL(&self->lock);
+    if (self->len != 0) {
+        if (pkt != NULL) *pkt = self->packets[self->head];
         self->head = (self->head + 1) % UART_TRCV_BUF_CAP;
+        self->len--;
+        ok = true;
     }
-    return 1;
+    taskEXIT_CRITICAL(&self->lock);
+    return ok;
 }
 
 /**
@@ -128,23 +158,6 @@ bool uart_trcv_buf_pop_front(UartTrcvBuf *self, UartPacket *pkt) {
  * @return UartTrcvBuf 初始化後的環形緩衝區 (initialized ring buffer)
  */
 UartTrcvBuf uart_trcv_buf_new(void) {
-    UartTrcvBuf buf = {0};
+    UartTrcvBuf buf = UART_TRCV_BUF_INIT;
     return buf;
 }
-
-/**
- * @brief 全域傳輸緩衝區
- *        Global transmit ring buffer
- */
-UartTrcvBuf uart_trsm_pkt_buf;
-
-/**
- * @brief 全域接收緩衝區
- *        Global receive ring buffer
- */
-UartTrcvBuf uart_recv_pkt_buf;
-
-void uart_trcv_buf_init(void) {
-    uart_trsm_pkt_buf = uart_trcv_buf_new();
-    uart_recv_pkt_buf = uart_trcv_buf_new();
-}
\ No newline at end of file
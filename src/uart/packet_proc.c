@@ -1,6 +1,8 @@
 #include "uart/packet_proc.h"
 #include "uart/transceive.h"
 #include "mcu_const.h"
+#include "wifi/udp_transceive.h"
+#include "telemetry/sample.h"
 
 float f32_test = 1;
 uint16_t u16_test = 1;
@@ -9,44 +11,51 @@ uint16_t u16_test = 1;
  * @brief 組合並傳輸封包至傳輸緩衝區
  *        Assemble and transmit packet into transfer buffer
  *
- * @note 根據 transceive_flags 決定回應內容
+ * @note 根據連線的 flags 決定回應內容
  *
+ * @param link 目標埠 (destination port)
  * @return void
  */
-void uart_transmit_pkt_proc(void) {
+void uart_transmit_pkt_proc(UartLink *link) {
     VecU8 new_vec = vec_u8_new();
     vec_u8_push(&new_vec, &(uint8_t){0x10}, 1);
     bool new_vec_wri_flag = false;
     if (new_vec_wri_flag) {
         UartPacket new_packet = uart_packet_new();
         uart_pkt_add_data(&new_packet, &new_vec);
-        uart_trcv_buf_push(&uart_trsm_pkt_buf, &new_packet);
+        uart_trcv_buf_push(&link->tx_buf, &new_packet);
     };
 }
 
-void uart_re_pkt_proc_data_store(VecU8 *vec_u8);
+void uart_re_pkt_proc_data_store(UartLink *link, VecU8 *vec_u8);
 
 /**
  * @brief 從接收緩衝區反覆讀取封包並處理
  *        Pop packets from receive buffer and process them
  *
+ * @param link 來源埠 (source port)
  * @param count 單次最大處理封包數量 (input maximum number of packets to process per time)
  * @return void
  */
-void uart_receive_pkt_proc(uint8_t count) {
+void uart_receive_pkt_proc(UartLink *link, uint8_t count) {
     uint8_t i;
-    for (i = 0; i < 5; i++){
+    for (i = 0; i < count; i++){
         UartPacket packet = uart_packet_new();
-        if (!uart_trcv_buf_pop_front(&uart_recv_pkt_buf, &packet)) {
+        if (!uart_trcv_buf_pop_front(&link->rx_buf, &packet)) {
             break;
         }
+        uart_flow_consumed(&link->flow, 1);
+        pkt_trace_stamp(&packet.trace, PKT_STAGE_DISPATCH);
         VecU8 vec_u8 = vec_u8_new();
         uart_pkt_get_data(&packet, &vec_u8);
         uint8_t code = vec_u8.data[0];
+        if (code == CMD_CODE_DATA_TRRE) {
+            wifi_udp_telemetry_push(link->index, vec_u8.data, vec_u8.len, &packet.trace);
+        }
         vec_u8_rm_range(&vec_u8, 0, 1);
         switch (code) {
             case CMD_CODE_DATA_TRRE:
-                uart_re_pkt_proc_data_store(&vec_u8);
+                uart_re_pkt_proc_data_store(link, &vec_u8);
                 break;
             default:
                 break;
@@ -58,51 +67,34 @@ void uart_receive_pkt_proc(uint8_t count) {
  * @brief 處理接收命令並存儲/回應資料
  *        Process received commands and store or respond data
  *
+ * @note 先解析數值回報；只有剩下剛好 3 位元組時才視為模式命令，否則數值位元組
+ *       (例如速度 0.0 或 ADC 低於 768) 會被誤認為 STOP/ONCE/START
+ *       Value reports are parsed first and only an exact 3-byte remainder is taken as a mode
+ *       command; otherwise value bytes (speed 0.0, ADC below 768) would match STOP/ONCE/START
+ *
+ * @param link 來源埠 (source port)
  * @param vec_u8 指向去除命令碼後的資料向量 (input vector without command code)
  * @return void
  */
-void uart_re_pkt_proc_data_store(VecU8 *vec_u8) {
-    VecU8 new_vec = vec_u8_new();
-    vec_u8_push_byte(&new_vec, CMD_CODE_DATA_TRRE);
-    bool data_proc_flag;
-    bool new_vec_wri_flag = false;
-    while (1) {
-        data_proc_flag = false;
-        if (vec_u8_starts_with(vec_u8, CMD_RIGHT_SPEED_STOP, sizeof(CMD_RIGHT_SPEED_STOP))) {
-            vec_u8_rm_range(vec_u8, 0, sizeof(CMD_RIGHT_SPEED_STOP));
-            data_proc_flag = true;
-            transceive_flags.right_speed = false;
-        }
-        if (vec_u8_starts_with(vec_u8, CMD_RIGHT_SPEED_ONCE, sizeof(CMD_RIGHT_SPEED_ONCE))) {
-            vec_u8_rm_range(vec_u8, 0, sizeof(CMD_RIGHT_SPEED_ONCE));
-            data_proc_flag = true;
-            new_vec_wri_flag = true;
-        }
-        if (vec_u8_starts_with(vec_u8, CMD_RIGHT_SPEED_START, sizeof(CMD_RIGHT_SPEED_START))) {
-            vec_u8_rm_range(vec_u8, 0, sizeof(CMD_RIGHT_SPEED_START));
-            data_proc_flag = true;
-            transceive_flags.right_speed = true;
+void uart_re_pkt_proc_data_store(UartLink *link, VecU8 *vec_u8) {
+    while (vec_u8->len > 0) {
+        TelemetrySample sample;
+        if (telemetry_take_store(vec_u8, &sample)) {
+            // 遙測通道屬於主要埠的 AGV (telemetry channels belong to the primary port's AGV)
+            if (link->index == UART_LINK_PRIMARY) telemetry_publish(&sample);
+            continue;
         }
-        if (vec_u8_starts_with(vec_u8, CMD_RIGHT_ADC_STOP, sizeof(CMD_RIGHT_ADC_STOP))) {
-            vec_u8_rm_range(vec_u8, 0, sizeof(CMD_RIGHT_ADC_STOP));
-            data_proc_flag = true;
-            transceive_flags.right_adc = false;
-        }
-        if (vec_u8_starts_with(vec_u8, CMD_RIGHT_ADC_ONCE, sizeof(CMD_RIGHT_ADC_ONCE))) {
-            vec_u8_rm_range(vec_u8, 0, sizeof(CMD_RIGHT_ADC_ONCE));
-            data_proc_flag = true;
-            new_vec_wri_flag = true;
-        }
-        if (vec_u8_starts_with(vec_u8, CMD_RIGHT_ADC_START, sizeof(CMD_RIGHT_ADC_START))) {
-            vec_u8_rm_range(vec_u8, 0, sizeof(CMD_RIGHT_ADC_START));
-            data_proc_flag = true;
-            transceive_flags.right_adc = true;
+        if (vec_u8->len != sizeof(CMD_RIGHT_SPEED_STOP)) break;
+        if (vec_u8_starts_with(vec_u8, CMD_RIGHT_SPEED_STOP, sizeof(CMD_RIGHT_SPEED_STOP))) {
+            link->flags.right_speed = false;
+        } else if (vec_u8_starts_with(vec_u8, CMD_RIGHT_SPEED_START, sizeof(CMD_RIGHT_SPEED_START))) {
+            link->flags.right_speed = true;
+        } else if (vec_u8_starts_with(vec_u8, CMD_RIGHT_ADC_STOP, sizeof(CMD_RIGHT_ADC_STOP))) {
+            link->flags.right_adc = false;
+        } else if (vec_u8_starts_with(vec_u8, CMD_RIGHT_ADC_START, sizeof(CMD_RIGHT_ADC_START))) {
+            link->flags.right_adc = true;
         }
-        if (!data_proc_flag) break;
-    }
-    if (new_vec_wri_flag) {
-        UartPacket new_packet = uart_packet_new();
-        uart_pkt_add_data(&new_packet, &new_vec);
-        uart_trcv_buf_push(&uart_trsm_pkt_buf, &new_packet);
+        // ONCE 沒有狀態，也不再回送只有命令碼的空 {0x10} 框 (ONCE carries no state and no longer answers with a bare {0x10} frame)
+        break;
     }
 }
@@ -0,0 +1,60 @@
+#include "uart/port.h"
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+// ----------------------------------------------------------------------------------------------------
+#include "vec_mod.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/uart.h"
+#include "driver/gpio.h"
+
+typedef struct {
+    uart_port_t num;
+    gpio_num_t  txd;
+    gpio_num_t  rxd;
+} UartPortPins;
+
+static const UartPortPins uart_port_pins[] = {
+    { UART_NUM_1, GPIO_NUM_4,  GPIO_NUM_5  },
+    { UART_NUM_2, GPIO_NUM_17, GPIO_NUM_16 },
+};
+
+static const int RX_BUF_SIZE = VECU8_MAX_CAPACITY;
+
+/**
+ * @brief 安裝 UART 驅動並設定腳位
+ *        Install the UART driver and route its pins
+ */
+bool uart_port_open(uint8_t port, uint32_t baud) {
+    if (port >= sizeof(uart_port_pins) / sizeof(uart_port_pins[0])) return 0;
+    const UartPortPins *pins = &uart_port_pins[port];
+    if (uart_driver_install(pins->num, RX_BUF_SIZE * 2, 0, 0, NULL, 0) != ESP_OK) return 0;
+    const uart_config_t uart_config = {
+        .baud_rate = baud,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    uart_param_config(pins->num, &uart_config);
+    uart_set_pin(pins->num, pins->txd, pins->rxd, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    return 1;
+}
+
+int uart_port_write(uint8_t port, const uint8_t *data, size_t len) {
+    return uart_write_bytes(uart_port_pins[port].num, data, len);
+}
+
+/**
+ * @note 不足一個 tick 的等待改為兩個 tick：一個 tick 可能立刻到期，等不到 RX 逾時中斷送來的位元組
+ *       A wait shorter than a tick becomes two ticks; a single tick may expire at once, before the
+ *       RX timeout interrupt hands over the bytes still in the hardware FIFO
+ */
+int uart_port_read(uint8_t port, uint8_t *buf, size_t cap, uint32_t timeout_ms) {
+    TickType_t ticks = pdMS_TO_TICKS(timeout_ms);
+    if (timeout_ms > 0 && ticks == 0) ticks = 2;
+    return uart_read_bytes(uart_port_pins[port].num, buf, cap, ticks);
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include "uart/port.h"
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+// ----------------------------------------------------------------------------------------------------
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "uart_port_pty";
+
+static const char *const uart_port_links[] = {
+    CONFIG_STATION_SIM_UART_LINK,
+#if CONFIG_STATION_UART_PORT_COUNT > 1
+    CONFIG_STATION_SIM_UART2_LINK,
+#endif
+};
+
+#define UART_PORT_COUNT     (sizeof(uart_port_links) / sizeof(uart_port_links[0]))
+
+static int uart_port_fds[UART_PORT_COUNT] = { [0 ... UART_PORT_COUNT - 1] = -1 };
+
+/**
+ * @brief 開啟虛擬終端的主端，模擬的 STM32 連接從端
+ *        Open the master side of a pseudo-terminal; the simulated STM32 attaches to the slave side
+ *
+ * @note 從端路徑會以 CONFIG_STATION_SIM_UART_LINK (埠 1 為 CONFIG_STATION_SIM_UART2_LINK) 建立符號連結，方便工具固定連線
+ *       The slave path is symlinked at CONFIG_STATION_SIM_UART_LINK (CONFIG_STATION_SIM_UART2_LINK
+ *       for port 1) so tools have a stable path
+ * @note 鮑率對虛擬終端無實際作用 (the baud rate has no effect on a pty)
+ */
+bool uart_port_open(uint8_t port, uint32_t baud) {
+    if (port >= UART_PORT_COUNT) return 0;
+    const char *link = uart_port_links[port];
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        ESP_LOGE(TAG, "Failed to create pty: errno %d", errno);
+        if (fd >= 0) close(fd);
+        return 0;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    // 主機系統呼叫不可阻塞 FreeRTOS 排程執行緒 (host syscalls must never block the scheduler thread)
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    const char *slave = ptsname(fd);
+    unlink(link);
+    if (slave == NULL || symlink(slave, link) != 0) {
+        ESP_LOGW(TAG, "Failed to link %s: errno %d", link, errno);
+    }
+    ESP_LOGI(TAG, "Simulated UART %u on %s (%s), %lu baud ignored",
+        port, slave ? slave : "?", link, (unsigned long)baud);
+    uart_port_fds[port] = fd;
+    return 1;
+}
+
+int uart_port_write(uint8_t port, const uint8_t *data, size_t len) {
+    int fd = uart_port_fds[port];
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(fd, data + done, len - done);
+        if (n > 0) {
+            done += n;
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return -1;
+        } else {
+            vTaskDelay(1);
+        }
+    }
+    return (int)done;
+}
+
+/**
+ * @brief 以非阻塞讀取加上 tick 等待模擬 uart_read_bytes：讀滿 cap 或逾時才返回
+ *        Emulate uart_read_bytes with non-blocking reads and tick waits: return once cap bytes arrived or on timeout
+ */
+int uart_port_read(uint8_t port, uint8_t *buf, size_t cap, uint32_t timeout_ms) {
+    int fd = uart_port_fds[port];
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    size_t got = 0;
+    while (got < cap) {
+        ssize_t n = read(fd, buf + got, cap - got);
+        if (n > 0) {
+            got += n;
+            continue;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR && errno != EIO) return -1;
+        if (xTaskGetTickCount() - start >= timeout) break;
+        vTaskDelay(1);
+    }
+    return (int)got;
+}
+
+#endif
@@ -1,113 +1,274 @@
 #include "uart/transceive.h"
 #include "uart/packet.h"
-#include "prioritites_sequ.h"
+#include "uart/packet_proc.h"
+#include "uart/deframe.h"
+#include "uart/port.h"
+#include "task_layout.h"
+#include "dispatcher.h"
+#include "metrics.h"
+#include "capture.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_system.h"
 #include "esp_log.h"
-#include "driver/uart.h"
+#include "esp_timer.h"
 #include "string.h"
-#include "driver/gpio.h"
 
-static const int RX_BUF_SIZE = VECU8_MAX_CAPACITY;
+static const char *TAG = "uart_trcv";
 
-#define TXD_PIN (GPIO_NUM_4)
-#define RXD_PIN (GPIO_NUM_5)
+#define UART_BAUD_RATE          CONFIG_STATION_UART_BAUD
+#define UART_READ_TIMEOUT_MS    10
+// 讀取結尾為 `}` 時等待下一個位元組的時間 (how long to wait for the next byte after a read ending in `}`)
+#define UART_READ_END_WAIT_MS   2
+#define UART_TX_RETRY_MS        10
+#define UART_TX_IDLE_WAIT_MS    10
+#define UART_FLOW_REFRESH_MS    100
 
-#define UART_READ_TIMEOUT_MS 10
+// 各埠的 RX/TX 任務 (RX/TX tasks of each port)
+static const TaskId uart_rx_task_ids[] = { TASK_ID_UART_RX, TASK_ID_UART2_RX };
+static const TaskId uart_tx_task_ids[] = { TASK_ID_UART_TX, TASK_ID_UART2_TX };
+_Static_assert(UART_LINK_COUNT <= sizeof(uart_tx_task_ids) / sizeof(uart_tx_task_ids[0]), "no task slots for every UART port");
 
-/**
- * @brief 傳輸/接收操作旗標
- *        Transmit/receive operation flags
- *
- * @details 控制資料處理流程 (Control data processing flow)
- */
-TransceiveFlags transceive_flags = {0};
-
-static void uart_tasks_spawn(void);
+static void uart_dispatch_rx(EventBits_t events, void *arg);
+static void uart_tasks_spawn(UartLink *link);
 void uart_setup(void) {
-    uart_trcv_buf_init();
-    uart_driver_install(UART_NUM_1, RX_BUF_SIZE * 2, 0, 0, NULL, 0);
-    const uart_config_t uart_config = {
-        .baud_rate = 115200,
-        .data_bits = UART_DATA_8_BITS,
-        .parity = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
-        .source_clk = UART_SCLK_DEFAULT,
-    };
-    uart_param_config(UART_NUM_1, &uart_config);
-    uart_set_pin(UART_NUM_1, TXD_PIN, RXD_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    uart_tasks_spawn();
+    uart_links_init();
+    dispatcher_register(DISPATCH_EV_UART_RX, uart_dispatch_rx, NULL);
+    for (uint8_t i = 0; i < UART_LINK_COUNT; i++) {
+        UartLink *link = &uart_links[i];
+#if CONFIG_STATION_UART_FLOW_CONTROL
+        uart_flow_init(&link->flow, UART_TRCV_BUF_CAP, CONFIG_STATION_UART_FLOW_STARVE_MS * 1000U, UART_FLOW_REFRESH_MS * 1000U);
+#endif
+        // 單一埠失效不影響其他埠 (one port failing leaves the others running)
+        if (!uart_port_open(i, UART_BAUD_RATE)) {
+            ESP_LOGE(TAG, "UART port %u unavailable, its control path disabled", i);
+            continue;
+        }
+        link->open = true;
+        uart_tasks_spawn(link);
+    }
 }
 
-bool uart_write_t(const char* logName, UartPacket *packet) {
+bool uart_write_t(UartLink *link, const char* logName, UartPacket *packet) {
     VecU8 vec_u8 = vec_u8_new();
     uart_pkt_unpack(packet, &vec_u8);
-    int len = uart_write_bytes(UART_NUM_1, vec_u8.data, vec_u8.len);
+    int64_t start_us = esp_timer_get_time();
+    int len = uart_port_write(link->index, vec_u8.data, vec_u8.len);
     if (len <= 0) {
+        link->stats.tx_errors++;
+        metrics_inc(METRIC_UART_TX_ERRORS);
         return 0;
     }
-    ESP_LOGI(logName, "Wrote %d bytes", len);
+    // 驅動沒有 TX 環形緩衝區，返回時資料已進入硬體 FIFO (no driver TX ring, so the bytes are in the FIFO)
+    pkt_trace_finish(&packet->trace, PKT_DIR_WIFI_TO_UART);
+    capture_record(CAPTURE_SRC_UART_TX, vec_u8.data, len);
+    metrics_observe(METRIC_HIST_UART_TX_WRITE_US, (uint32_t)(esp_timer_get_time() - start_us));
+    link->stats.tx_frames++;
+    link->stats.tx_bytes += len;
+    metrics_inc(METRIC_UART_TX_FRAMES);
+    metrics_add(METRIC_UART_TX_BYTES, len);
+    ESP_LOGD(logName, "Port %u wrote %d bytes", link->index, len);
     return 1;
 }
 
+/**
+ * @brief 喚醒該埠的傳輸任務，有新命令排入槽位或 FIFO 時呼叫
+ *        Wake the port's TX task; call after queueing into its slots or FIFO
+ */
+void uart_tx_kick(UartLink *link) {
+    TaskHandle_t tx_task = task_layout_handle(uart_tx_task_ids[link->index]);
+    if (tx_task != NULL) xTaskNotifyGive(tx_task);
+}
+
 static void uart_write_task(void *arg) {
     static const char *TX_TASK_TAG = "TX_TASK";
+    UartLink *link = arg;
+    UartCmdSlots *slots = &link->slots;
+    UartFlow *flow = &link->flow;
     esp_log_level_set(TX_TASK_TAG, ESP_LOG_INFO);
 
     while (1) {
-        UartPacket packet = uart_packet_new();
-        if (!uart_trcv_buf_get_front(&uart_trsm_pkt_buf, &packet)) {
-            vTaskDelay(pdMS_TO_TICKS(10));
+        UartCmdSlotSet taken;
+        UartPacket packet;
+        uint32_t now_us = (uint32_t)esp_timer_get_time();
+#if CONFIG_STATION_UART_FLOW_CONTROL
+        // 信用封包不佔信用，先送出以免雙方互等 (credit frames use no credit and go first so neither side waits on the other)
+        if (uart_flow_credit_due(flow, now_us, &packet)) {
+            uart_write_t(link, TX_TASK_TAG, &packet);
             continue;
         }
-        if (!uart_write_t(TX_TASK_TAG, &packet)) {
-            vTaskDelay(pdMS_TO_TICKS(10));
+#endif
+        // 優先通道與槽位中的最新意圖先於 FIFO，順序保證見 cmd_slots.h
+        // The priority lane and the slots go ahead of the FIFO; see cmd_slots.h for the ordering guarantee
+        if (uart_cmd_slots_take(slots, &taken, &packet)) {
+            bool estop = taken.pending & (1U << UART_CMD_SLOT_ESTOP);
+            // 緊急停止不等信用 (the e-stop is never held back for credits)
+            if (!estop && !uart_flow_can_send(flow, now_us)) {
+                uart_cmd_slots_restore(slots, &taken);
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UART_TX_IDLE_WAIT_MS));
+                continue;
+            }
+            if (!uart_write_t(link, TX_TASK_TAG, &packet)) {
+                uart_cmd_slots_restore(slots, &taken);
+                vTaskDelay(pdMS_TO_TICKS(UART_TX_RETRY_MS));
+                continue;
+            }
+            uart_flow_sent(flow);
+            if (estop) {
+                uint32_t latency_us = (uint32_t)esp_timer_get_time() - taken.estop_us;
+                metrics_observe(METRIC_HIST_UART_ESTOP_US, latency_us);
+                metrics_gauge_max(METRIC_GAUGE_UART_ESTOP_MAX_US, latency_us);
+            }
             continue;
         }
-        uart_trcv_buf_pop_front(&uart_trsm_pkt_buf, NULL);
+        packet = uart_packet_new();
+        // 由 uart_tx_kick 喚醒 (信用到達時也是)，逾時只是未通知的 FIFO 寫入者與信用重新宣告的保底
+        // Woken by uart_tx_kick, also when credits arrive; the timeout backs up FIFO writers that
+        // do not notify and paces the credit refresh
+        if (!uart_trcv_buf_get_front(&link->tx_buf, &packet) || !uart_flow_can_send(flow, now_us)) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UART_TX_IDLE_WAIT_MS));
+            continue;
+        }
+        if (!uart_write_t(link, TX_TASK_TAG, &packet)) {
+            vTaskDelay(pdMS_TO_TICKS(UART_TX_RETRY_MS));
+            continue;
+        }
+        uart_flow_sent(flow);
+        uart_trcv_buf_pop_front(&link->tx_buf, NULL);
     }
     
     vTaskDelete(NULL);
 }
 
-static bool uart_read_t(const char* logName, UartPacket *packet) {
-    uint8_t data[VECU8_MAX_CAPACITY] = {0};
-    int len = uart_read_bytes(UART_NUM_1, data, VECU8_MAX_CAPACITY, pdMS_TO_TICKS(UART_READ_TIMEOUT_MS));
+static int uart_read_t(UartLink *link, const char* logName, uint8_t *data, uint32_t timeout_ms) {
+    int len = uart_port_read(link->index, data, VECU8_MAX_CAPACITY, timeout_ms);
     if (len <= 0) {
         return 0;
     }
-    ESP_LOGI(logName, "Read %d bytes: '%s'", len, data);
-    ESP_LOG_BUFFER_HEXDUMP(logName, data, len, ESP_LOG_INFO);
-    VecU8 vec_u8 = vec_u8_new();
-    vec_u8_push(&vec_u8, &data, len);
-    UartPacket new = uart_packet_new();
-    if (uart_pkt_pack(&new, &vec_u8)) {
-        ESP_LOGI(logName, "Pack %d bytes", len);
+    // 在切框前記錄，重播時連錯誤的框也能重現 (recorded before de-framing so replays include bad frames)
+    capture_record(CAPTURE_SRC_UART_RX, data, len);
+    // 每次讀寫只在除錯等級記錄，主控台輸出不進入熱路徑 (per-read logs stay at debug level, off the hot path)
+    ESP_LOGD(logName, "Port %u read %d bytes: '%.*s'", link->index, len, len, (const char *)data);
+    link->stats.rx_bytes += len;
+    metrics_add(METRIC_UART_RX_BYTES, len);
+    return len;
+}
+
+/**
+ * @brief 處理一個完整的接收封包：信用封包交給流量控制，其餘排入接收緩衝區
+ *        Handle one complete frame: credit frames go to flow control, the rest into the receive buffer
+ *
+ * @return true 封包已排入，需要通知分派任務 (queued, the dispatcher needs a post)
+ */
+static bool uart_rx_frame(UartLink *link, const char* logName, UartPacket *packet, int64_t read_us) {
+    link->stats.rx_frames++;
+    metrics_inc(METRIC_UART_RX_FRAMES);
+#if CONFIG_STATION_UART_FLOW_CONTROL
+    VecU8 datas = vec_u8_new();
+    uart_pkt_get_data(packet, &datas);
+    if (uart_flow_on_credit(&link->flow, datas.data, datas.len)) {
+        uart_tx_kick(link);
+        return 0;
+    }
+#endif
+    pkt_trace_stamp(&packet->trace, PKT_STAGE_ENQUEUE);
+    if (!uart_trcv_buf_push(&link->rx_buf, packet)) {
+        // 丟棄的封包也歸還信用 (a dropped frame gives its credit back too)
+        uart_flow_consumed(&link->flow, 1);
+        ESP_LOGW(logName, "Port %u receive buffer full, frame dropped", link->index);
+        return 0;
     }
-    *packet = new;
+    uint32_t expected = 0;
+    uint32_t pending_us = (uint32_t)read_us | 1U;
+    __atomic_compare_exchange_n(&link->rx_pending_us, &expected, pending_us, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
     return 1;
 }
 
+/**
+ * @brief 處理一個切框事件 (handle one de-framing event)
+ *
+ * @return true 封包已排入，需要通知分派任務 (queued, the dispatcher needs a post)
+ */
+static bool uart_rx_deframed(UartLink *link, const char *tag, UartDeframeEvent event, UartPacket *packet,
+    const PktTrace *trace, int64_t start_us, bool *first_frame) {
+    if (event != UART_DEFRAME_FRAME) {
+        link->stats.frame_errors++;
+        metrics_inc(METRIC_UART_FRAME_ERRORS);
+        // 損壞的封包也用掉對方一個信用，雜訊則不是封包 (a damaged frame used one of the peer's credits, noise is no frame)
+        if (event == UART_DEFRAME_MALFORMED) {
+            uart_flow_consumed(&link->flow, 1);
+            uart_tx_kick(link);
+        }
+        return 0;
+    }
+    if (*first_frame) {
+        *first_frame = false;
+        metrics_gauge_set(METRIC_GAUGE_BOOT_FIRST_UART_FRAME_MS, (uint32_t)(start_us / 1000));
+        ESP_LOGI(tag, "First frame %lu ms after reset", (unsigned long)(start_us / 1000));
+    }
+    packet->trace = *trace;
+    return uart_rx_frame(link, tag, packet, start_us);
+}
+
 static void uart_read_task(void *arg) {
     static const char *RX_TASK_TAG = "RX_TASK";
     esp_log_level_set(RX_TASK_TAG, ESP_LOG_INFO);
-    ESP_LOGI(RX_TASK_TAG, "Uart read task start");
+    UartLink *link = arg;
+    ESP_LOGI(RX_TASK_TAG, "Uart %u read task start", link->index);
+    // 開機後第一個框只以主要埠計 (the boot gauge follows the primary port only)
+    bool first_frame = link->index == UART_LINK_PRIMARY;
+    // 一次讀取可能含多個封包，也可能只有半個 (one read may hold several frames or half of one)
+    UartDeframer deframer = UART_DEFRAMER_INIT;
+    uint8_t data[VECU8_MAX_CAPACITY];
 
     while (1) {
-        UartPacket packet = uart_packet_new();
-        if (!uart_read_t(RX_TASK_TAG, &packet)) {
-            continue;
+        // 讀取結尾的 `}` 未定時只短暫等待，線路靜默即結束該封包
+        // While a `}` ending the last read is undecided, wait only briefly; silence closes that frame
+        uint32_t timeout_ms = deframer.end_pending ? UART_READ_END_WAIT_MS : UART_READ_TIMEOUT_MS;
+        int len = uart_read_t(link, RX_TASK_TAG, data, timeout_ms);
+        PktTrace trace = {0};
+        pkt_trace_stamp(&trace, PKT_STAGE_RX);
+        int64_t start_us = esp_timer_get_time();
+        bool queued = false;
+        UartDeframeEvent event;
+        UartPacket packet;
+        if (len <= 0) {
+            if (uart_deframe_flush(&deframer, &event, &packet)) {
+                queued = uart_rx_deframed(link, RX_TASK_TAG, event, &packet, &trace, start_us, &first_frame);
+            }
         }
-        uart_trcv_buf_push(&uart_recv_pkt_buf, &packet);
-        ESP_LOGI(RX_TASK_TAG, "Buf len: %d", uart_recv_pkt_buf.len);
+        uint16_t offset = 0;
+        while (len > 0 && uart_deframe_next(&deframer, data, len, &offset, &event, &packet)) {
+            queued |= uart_rx_deframed(link, RX_TASK_TAG, event, &packet, &trace, start_us, &first_frame);
+        }
+        if (queued) dispatcher_post(DISPATCH_EV_UART_RX);
     }
 
     vTaskDelete(NULL);
 }
 
-static void uart_tasks_spawn(void) {
-    xTaskCreate(uart_read_task, "uart_rx_task", 4096, NULL, UART_READ_TASK_PRIO_SEQU, NULL);
-    xTaskCreate(uart_write_task, "uart_tx_task", 4096, NULL, UART_WRITE_TASK_PRIO_SEQU, NULL);
+/**
+ * @brief 分派任務中處理各埠接收緩衝區內所有封包
+ *        Process every queued frame of every port on the dispatcher task
+ *
+ * @note 所有埠共用同一個事件位元，每次都輪詢全部埠 (the ports share one event bit, so all are polled every time)
+ */
+static void uart_dispatch_rx(EventBits_t events, void *arg) {
+    for (uint8_t i = 0; i < UART_LINK_COUNT; i++) {
+        UartLink *link = &uart_links[i];
+        if (!link->open) continue;
+        uint32_t read_us = __atomic_exchange_n(&link->rx_pending_us, 0, __ATOMIC_RELAXED);
+        // 推入後才設定時間，為 0 表示上次處理後沒有新封包 (set after the push, so 0 means nothing new since the last pass)
+        if (read_us == 0) continue;
+        uart_receive_pkt_proc(link, UART_TRCV_BUF_CAP);
+#if CONFIG_STATION_UART_FLOW_CONTROL
+        uart_tx_kick(link);  // 宣告釋出的接收槽位 (advertise the freed receive slots)
+#endif
+        metrics_observe(METRIC_HIST_UART_RX_PROC_US, (uint32_t)esp_timer_get_time() - read_us);
+    }
+}
+
+static void uart_tasks_spawn(UartLink *link) {
+    task_layout_spawn(uart_rx_task_ids[link->index], uart_read_task, link);
+    task_layout_spawn(uart_tx_task_ids[link->index], uart_write_task, link);
 }
@@ -14,9 +14,12 @@ void vec_u8_realign(VecU8 *self) {
     if (first_part >= self->len) {
         memmove(self->data, self->data + self->head, self->len);
     } else {
+        // 繞回的後段位於陣列開頭，先暫存以免被前段覆蓋 (the wrapped part sits at index 0, save it before the first part lands there)
+        uint8_t second[VECU8_MAX_CAPACITY];
         uint16_t second_part = self->len - first_part;
+        memcpy(second, self->data, second_part);
         memmove(self->data, self->data + self->head, first_part);
-        memmove(self->data + first_part, self->data, second_part);
+        memcpy(self->data + first_part, second, second_part);
     }
     self->head = 0;
 }
@@ -139,6 +142,20 @@ static inline uint32_t swap32(uint32_t value) {
          | ((value & 0x00FF0000U) >>  8)
          | ((value & 0xFF000000U) >> 24);
 }
+/**
+ * @brief 將 uint32_t 轉換為大端序並推入 VecU8
+ *        Converts a 32-bit unsigned integer to big-endian and pushes into VecU8
+ *
+ * @param self 指向 VecU8 實例的指標 (pointer to VecU8 instance)
+ * @param value 要推入的 32-bit 原始值 (original 32-bit value)
+ * @return true 成功推入 (successfully pushed)
+ * @return false 推入失敗（超過容量） (failed to push, exceeds capacity)
+ */
+bool vec_u8_push_u32(VecU8 *self, uint32_t value) {
+    uint32_t u32 = swap32(value);
+    return vec_u8_push(self, &u32, sizeof(u32));
+}
+
 /**
  * @brief 將 float 轉換為 IEEE-754 大端序並推入 VecU8
  *        Converts a float to IEEE-754 big-endian representation and pushes into VecU8
@@ -170,7 +187,7 @@ bool vec_u8_push_f32(VecU8 *self, float value) {
 bool vec_u8_rm_range(VecU8 *self, uint16_t offset, uint16_t size) {
     if (offset >= self->len) return 0;
     if (size == 0) return 1;
-    if (size >= self->len) {
+    if (offset == 0 && size >= self->len) {
         self->head = 0;
         self->len  = 0;
         return 1;
@@ -0,0 +1,123 @@
+#include "wifi/aggregator.h"
+#include "wifi/datagram.h"
+#include "metrics.h"
+
+/**
+ * @brief 初始化聚合器
+ *        Initialize the aggregator
+ *
+ * @param self 聚合器 (aggregator)
+ * @param begin 開啟新封包時呼叫，負責寫入標頭 (called to write the header of each new datagram)
+ * @param max_deadline_us 紀錄最長保留時間 (upper bound on how long a record may be held)
+ */
+void wifi_aggr_init(WifiAggr *self, WifiAggrBeginFn begin, uint32_t max_deadline_us) {
+    WifiAggr aggr = {0};
+    aggr.begin           = begin;
+    aggr.max_deadline_us = max_deadline_us;
+    aggr.gap_ewma_us     = max_deadline_us;
+    aggr.rec_ewma_len    = 4;
+    *self = aggr;
+}
+
+/**
+ * @brief 依到達間隔估算本封包應保留多久
+ *        Derive the hold deadline of the open datagram from the measured arrival rate
+ *
+ * 間隔大於上限時等待無益，立即送出；否則等待到預估封包填滿為止，但不超過上限。
+ * When records arrive slower than the bound, waiting buys nothing so the datagram goes out
+ * at once; otherwise hold it for the expected fill time, capped at the bound.
+ */
+static void wifi_aggr_adapt(WifiAggr *self, uint32_t now_us, uint8_t len) {
+    if (self->has_last) {
+        uint32_t gap = now_us - self->last_us;
+        uint32_t cap = self->max_deadline_us * 2;
+        if (gap > cap) gap = cap;
+        int32_t delta = (int32_t)gap - (int32_t)self->gap_ewma_us;
+        self->gap_ewma_us += delta >> WIFI_AGGR_EWMA_SHIFT;
+    }
+    int32_t len_delta = (int32_t)len - (int32_t)self->rec_ewma_len;
+    self->rec_ewma_len += len_delta >> WIFI_AGGR_EWMA_SHIFT;
+    self->last_us  = now_us;
+    self->has_last = true;
+
+    if (self->gap_ewma_us >= self->max_deadline_us) {
+        self->deadline_us = 0;
+        return;
+    }
+    uint32_t fit = wifi_dgram_room(&self->dgram) / (self->rec_ewma_len + WIFI_DGRAM_RECORD_HDR_SIZE);
+    uint32_t deadline = self->gap_ewma_us * fit;
+    self->deadline_us = (deadline < self->max_deadline_us) ? deadline : self->max_deadline_us;
+}
+
+/**
+ * @brief 交出目前累積的封包 (不論是否到期)
+ *        Hand out the open datagram regardless of its deadline
+ *
+ * @return false 沒有累積中的封包 (nothing pending)
+ */
+bool wifi_aggr_flush(WifiAggr *self, VecU8 *out) {
+    if (!self->open) return 0;
+    *out = self->dgram;
+    self->open = false;
+    return 1;
+}
+
+/**
+ * @brief 加入一筆紀錄；若目前封包放不下，先交出舊封包再開新封包
+ *        Add one record; when it does not fit, the open datagram is handed out first
+ *
+ * @note 連新封包也放不下的紀錄 (過長) 計入 METRIC_WIFI_UDP_TELEMETRY_DROPS
+ *       A record that does not fit even an empty datagram (too long) counts in METRIC_WIFI_UDP_TELEMETRY_DROPS
+ *
+ * @param out 輸出已滿的封包 (output datagram that had to be closed)
+ * @return true out 已被填入，應送往傳輸緩衝區 (out holds a datagram to transmit)
+ */
+bool wifi_aggr_push(WifiAggr *self, uint8_t type, const uint8_t *payload, uint8_t len, uint32_t now_us, VecU8 *out) {
+    bool flushed = false;
+    if (self->open && wifi_dgram_room(&self->dgram) < len) {
+        flushed = wifi_aggr_flush(self, out);
+    }
+    while (1) {
+        if (!self->open) {
+            if (!self->begin(&self->dgram)) break;
+            self->open    = true;
+            self->open_us = now_us;
+        }
+        if (wifi_dgram_push_record(&self->dgram, type, payload, len)) {
+            wifi_aggr_adapt(self, now_us, len);
+            return flushed;
+        }
+        // 紀錄數已達上限：交出舊封包後重試一次 (record count maxed out: hand the datagram out and retry once)
+        if (flushed || wifi_dgram_room(&self->dgram) < len) break;
+        flushed = wifi_aggr_flush(self, out);
+    }
+    // 不留下沒有紀錄的空封包 (never leave an empty datagram open)
+    if (self->open && wifi_dgram_room(&self->dgram) == WIFI_DGRAM_MAX_PAYLOAD) self->open = false;
+    metrics_inc(METRIC_WIFI_UDP_TELEMETRY_DROPS);
+    return flushed;
+}
+
+/**
+ * @brief 封包已到期或已無法再容納平均大小的紀錄時交出
+ *        Hand out the open datagram once its deadline expired or it cannot take another typical record
+ */
+bool wifi_aggr_poll(WifiAggr *self, uint32_t now_us, VecU8 *out) {
+    if (!self->open) return 0;
+    bool full = wifi_dgram_room(&self->dgram) < self->rec_ewma_len;
+    bool due  = (uint32_t)(now_us - self->open_us) >= self->deadline_us;
+    if (!full && !due) return 0;
+    return wifi_aggr_flush(self, out);
+}
+
+/**
+ * @brief 距離目前封包到期還有多久，供排程器決定等待時間
+ *        Time until the open datagram is due, for the caller's wait timeout
+ *
+ * @return uint32_t 微秒；沒有累積中的封包時回傳 UINT32_MAX (us, UINT32_MAX when idle)
+ */
+uint32_t wifi_aggr_time_left(const WifiAggr *self, uint32_t now_us) {
+    if (!self->open) return UINT32_MAX;
+    uint32_t held = now_us - self->open_us;
+    if (held >= self->deadline_us) return 0;
+    return self->deadline_us - held;
+}
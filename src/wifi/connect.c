@@ -1,3 +1,7 @@
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+// ----------------------------------------------------------------------------------------------------
 #include <arpa/inet.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
@@ -8,11 +12,17 @@
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include "lwip/sockets.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "metrics.h"
+#include "boot.h"
 #include "wifi/connect.h"
 
-#define CONNECT_MAXIMUM_RETRY   5
 #define WIFI_CONNECTED_BIT      BIT0
-#define WIFI_FAIL_BIT           BIT1
+
+#define WIFI_CACHE_NVS_NAMESPACE    "wifi_cache"
+#define WIFI_CACHE_KEY_BSSID        "bssid"
+#define WIFI_CACHE_KEY_CHANNEL      "channel"
 
 static const char *TAG = "wifi connect";
 
@@ -20,20 +30,116 @@ char connect_wifi_ssid[] = "HY-TPL-BF94";
 char connect_wifi_pswd[] = "23603356";
 char connect_wifi_DHCP[] = "192.168.0.20";
 
+static StaticEventGroup_t s_wifi_event_group_buf;
 static EventGroupHandle_t s_wifi_event_group;
-static int wifi_connect_retry_count = 0;
+static uint32_t wifi_connect_retry_count = 0;
+static esp_timer_handle_t wifi_connect_retry_timer = NULL;
+static wifi_config_t wifi_connect_config;
+
+// 上次成功連線的 AP (last AP we got an association with)
+typedef struct {
+    uint8_t     bssid[6];
+    uint8_t     channel;
+    bool        valid;
+} WifiApCache;
+static WifiApCache wifi_ap_cache = {0};
+
+static bool wifi_ever_connected = false;
+static int64_t wifi_drop_us = 0;
+
+/**
+ * @brief 從 NVS 讀取快取的 BSSID 與頻道
+ *        Load the cached BSSID and channel from NVS
+ */
+static void wifi_ap_cache_load(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_CACHE_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) return;
+    size_t len = sizeof(wifi_ap_cache.bssid);
+    wifi_ap_cache.valid =
+        nvs_get_blob(nvs, WIFI_CACHE_KEY_BSSID, wifi_ap_cache.bssid, &len) == ESP_OK &&
+        len == sizeof(wifi_ap_cache.bssid) &&
+        nvs_get_u8(nvs, WIFI_CACHE_KEY_CHANNEL, &wifi_ap_cache.channel) == ESP_OK &&
+        wifi_ap_cache.channel != 0;
+    nvs_close(nvs);
+}
+
+/**
+ * @brief 連線成功後更新快取，內容相同時不寫入 flash
+ *        Update the cache after associating; flash is only written when it changed
+ */
+static void wifi_ap_cache_store(const uint8_t bssid[6], uint8_t channel) {
+    if (
+        wifi_ap_cache.valid &&
+        wifi_ap_cache.channel == channel &&
+        memcmp(wifi_ap_cache.bssid, bssid, sizeof(wifi_ap_cache.bssid)) == 0
+    ) {
+        return;
+    }
+    memcpy(wifi_ap_cache.bssid, bssid, sizeof(wifi_ap_cache.bssid));
+    wifi_ap_cache.channel = channel;
+    wifi_ap_cache.valid   = true;
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_CACHE_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) return;
+    if (
+        nvs_set_blob(nvs, WIFI_CACHE_KEY_BSSID, bssid, sizeof(wifi_ap_cache.bssid)) != ESP_OK ||
+        nvs_set_u8(nvs, WIFI_CACHE_KEY_CHANNEL, channel) != ESP_OK ||
+        nvs_commit(nvs) != ESP_OK
+    ) {
+        ESP_LOGW(TAG, "failed to store AP cache");
+    }
+    nvs_close(nvs);
+}
+
+/**
+ * @brief 依重試次數選擇連線方式：第一次用快取的 AP 只掃單一頻道，失敗後改為全頻道掃描
+ *        Pick how to connect: the first attempt targets the cached AP on its channel only,
+ *        later attempts fall back to a full scan
+ */
+static void wifi_connect_apply_config(void) {
+    wifi_sta_config_t *sta = &wifi_connect_config.sta;
+    bool use_cache = wifi_ap_cache.valid && wifi_connect_retry_count == 0;
+    if (use_cache == sta->bssid_set) return;
+    if (use_cache) {
+        memcpy(sta->bssid, wifi_ap_cache.bssid, sizeof(sta->bssid));
+        sta->channel     = wifi_ap_cache.channel;
+        sta->scan_method = WIFI_FAST_SCAN;
+    } else {
+        sta->channel     = 0;
+        sta->scan_method = WIFI_ALL_CHANNEL_SCAN;
+        metrics_inc(METRIC_WIFI_CACHE_MISSES);
+    }
+    sta->bssid_set = use_cache;
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_connect_config);
+}
+
+static void wifi_connect_attempt(void *arg) {
+    wifi_connect_apply_config();
+    esp_wifi_connect();
+}
+
+/**
+ * @brief 指數退避的重連延遲，永不放棄
+ *        Exponential backoff delay for the next reconnect; never gives up
+ */
+static uint32_t wifi_connect_backoff_ms(uint32_t retry) {
+    if (retry == 0) return 0;
+    uint32_t shift = retry - 1;
+    if (shift > 16) shift = 16;
+    uint32_t delay = WIFI_CONNECT_BACKOFF_MIN_MS << shift;
+    return (delay < WIFI_CONNECT_BACKOFF_MAX_MS) ? delay : WIFI_CONNECT_BACKOFF_MAX_MS;
+}
 
 /**
  * @brief Wi-Fi 事件處理函式
  *
- * 處理 Wi-Fi 相關事件，如啟動後連線、斷線重連與取得 IP
+ * 處理 Wi-Fi 相關事件，如啟動後連線、斷線後退避重連與取得 IP
  *
  * @param arg        使用者參數 (未使用)
  * @param event_base 事件來源
  * @param event_id   事件 ID
  * @param event_data 事件資料
  *
- * Handle Wi-Fi events: start connect, retry on disconnect, and got IP
+ * Handle Wi-Fi events: start connect, reconnect with backoff on disconnect, and got IP
  */
 static void wifi_connect_event_handler(
     void* arg,
@@ -43,40 +149,77 @@ static void wifi_connect_event_handler(
 ) {
     // Called when Wi-Fi starts, initiate connection
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
+        wifi_connect_attempt(NULL);
+    }
+    // Associated, remember the AP for the next fast reconnect
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*) event_data;
+        wifi_ap_cache_store(event->bssid, event->channel);
     }
-    // On disconnection, retry or signal failure
+    // On disconnection, schedule a retry with backoff
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (wifi_connect_retry_count < CONNECT_MAXIMUM_RETRY) {
-            esp_wifi_connect();
-            wifi_connect_retry_count++;
-            ESP_LOGI(TAG, "retry to connect to the AP");
-        } else {
-            // Exceeded max retries, set failure bit
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+        if (xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT) {
+            xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+            wifi_drop_us = esp_timer_get_time();
+            metrics_inc(METRIC_WIFI_DISCONNECTS);
+        }
+        uint32_t delay_ms = wifi_connect_backoff_ms(wifi_connect_retry_count);
+        wifi_connect_retry_count++;
+        ESP_LOGI(TAG, "retry %lu to connect to the AP in %lu ms",
+                 (unsigned long)wifi_connect_retry_count, (unsigned long)delay_ms);
+        esp_timer_stop(wifi_connect_retry_timer);
+        if (delay_ms == 0 || esp_timer_start_once(wifi_connect_retry_timer, (uint64_t)delay_ms * 1000) != ESP_OK) {
+            wifi_connect_attempt(NULL);
         }
     }
-    // Obtained IP, reset retry count and set success bit
+    // Obtained IP, reset retry count, record timings and set success bit
     else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
         ESP_LOGI(TAG, "got ip:" IPSTR, IP2STR(&event->ip_info.ip));
+        int64_t now_us = esp_timer_get_time();
+        if (!wifi_ever_connected) {
+            metrics_gauge_set(METRIC_GAUGE_WIFI_BOOT_TO_IP_MS, (uint32_t)(now_us / 1000));
+            wifi_ever_connected = true;
+            boot_mark_ready(BOOT_STAGE_WIFI);
+        } else if (wifi_drop_us != 0) {
+            uint32_t recovery_ms = (uint32_t)((now_us - wifi_drop_us) / 1000);
+            metrics_gauge_set(METRIC_GAUGE_WIFI_LAST_RECOVERY_MS, recovery_ms);
+            metrics_gauge_max(METRIC_GAUGE_WIFI_MAX_RECOVERY_MS, recovery_ms);
+            wifi_drop_us = 0;
+        }
         wifi_connect_retry_count = 0;
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
 
+/**
+ * @brief 套用 Kconfig 選擇的網路設定檔
+ *        Apply the network profile selected in Kconfig
+ *
+ * @note 低延遲模式關閉 modem sleep，否則接收會被延後到下一個 DTIM
+ *       Low latency turns modem sleep off; otherwise reception waits for the next DTIM beacon
+ */
+static void wifi_connect_apply_profile(void) {
+#if CONFIG_STATION_NET_PROFILE_LOW_LATENCY
+    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
+    ESP_LOGI(TAG, "network profile: low latency");
+#else
+    ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MIN_MODEM));
+    ESP_LOGI(TAG, "network profile: power save");
+#endif
+}
+
 /**
  * @brief 初始化並啟動 Wi-Fi STA 模式
  *
- * 設定 SSID、密碼，啟動 Wi-Fi 並等待連接結果
+ * 設定 SSID、密碼並啟動 Wi-Fi，不等待連線結果
  *
- * Initialize Wi-Fi in Station mode, configure SSID/password and wait for connection
+ * Initialize Wi-Fi in Station mode, configure SSID/password and start it without waiting
  */
 void wifi_init_sta(void) {
     // Create wifi event group
-    s_wifi_event_group = xEventGroupCreate();
-    // Initialize NVS for storing Wi-Fi parameters
-    ESP_ERROR_CHECK(nvs_flash_init());
+    s_wifi_event_group = xEventGroupCreateStatic(&s_wifi_event_group_buf);
+    // NVS is brought up by boot_nvs_setup() before Wi-Fi starts
     // Initialize TCP/IP network interface
     ESP_ERROR_CHECK(esp_netif_init());
     // Create default event loop
@@ -103,42 +246,47 @@ void wifi_init_sta(void) {
     ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_connect_event_handler, NULL, NULL));
     ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_connect_event_handler, NULL, NULL));
     
+    // Retry timer, fired from the esp_timer task
+    esp_timer_create_args_t retry_args = {
+        .callback = wifi_connect_attempt,
+        .name     = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_args, &wifi_connect_retry_timer));
+    wifi_ap_cache_load();
+
     // Configure Wi-Fi connection parameters
-    wifi_config_t wifi_config;
-    memset(&wifi_config, 0, sizeof(wifi_config));
-    strcpy((char *)wifi_config.sta.ssid,     connect_wifi_ssid);
-    strcpy((char *)wifi_config.sta.password, connect_wifi_pswd);
-    wifi_config.sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    wifi_config_t *wifi_config = &wifi_connect_config;
+    memset(wifi_config, 0, sizeof(*wifi_config));
+    strcpy((char *)wifi_config->sta.ssid,     connect_wifi_ssid);
+    strcpy((char *)wifi_config->sta.password, connect_wifi_pswd);
+    wifi_config->sta.threshold.authmode = WIFI_AUTH_WPA2_PSK;
+    wifi_config->sta.scan_method        = WIFI_ALL_CHANNEL_SCAN;
 
     // Set Wi-Fi mode to Station
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    // Set Station configuration
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    // Start Wi-Fi
+    // Set Station configuration, the cached AP is applied on the first attempt
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, wifi_config));
+    // Start Wi-Fi, connecting continues from the event handler
     ESP_ERROR_CHECK(esp_wifi_start());
+    wifi_connect_apply_profile();
+    ESP_LOGI(TAG, "Connecting to SSID:%s%s...", connect_wifi_ssid, wifi_ap_cache.valid ? " (cached AP)" : "");
+}
 
-    // Wait for connection result: success or fail
-    ESP_LOGI(TAG, "Connecting to SSID:%s...", connect_wifi_ssid);
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-            pdFALSE, pdFALSE, portMAX_DELAY);
-    
-    // Connected successfully
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "connected to ap SSID:%s password:%s",
-                 connect_wifi_ssid, connect_wifi_pswd);
-    }
-    // Failed to connect
-    else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGI(TAG, "failed to connect to SSID:%s, password:%s",
-                 connect_wifi_ssid, connect_wifi_pswd);
-    }
-
-    // Delete event group
-    vEventGroupDelete(s_wifi_event_group);
+/**
+ * @brief 等待取得 IP
+ *        Wait until the station has an IP address
+ *
+ * @param timeout 最長等待時間 (ticks)
+ * @return true 已連線 (connected)
+ */
+bool wifi_connect_wait(TickType_t timeout) {
+    if (s_wifi_event_group == NULL) return 0;
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE, timeout);
+    return (bits & WIFI_CONNECTED_BIT) != 0;
 }
 
 void wifi_connect_setup(void) {
     wifi_init_sta();
 }
 
+#endif
@@ -0,0 +1,27 @@
+#include "sdkconfig.h"
+
+#if CONFIG_IDF_TARGET_LINUX
+// ----------------------------------------------------------------------------------------------------
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "boot.h"
+#include "wifi/connect.h"
+
+static const char *TAG = "wifi connect";
+
+/**
+ * @brief Linux 目標沒有 Wi-Fi：主機網路視為已連線，socket 走本機 loopback
+ *        The Linux target has no Wi-Fi: the host network counts as connected and sockets use loopback
+ */
+void wifi_connect_setup(void) {
+    metrics_gauge_set(METRIC_GAUGE_WIFI_BOOT_TO_IP_MS, (uint32_t)(esp_timer_get_time() / 1000));
+    ESP_LOGI(TAG, "Simulation: using host network, peer %s", CONFIG_STATION_PEER_IP);
+    boot_mark_ready(BOOT_STAGE_WIFI);
+}
+
+bool wifi_connect_wait(TickType_t timeout) {
+    return 1;
+}
+
+#endif
@@ -0,0 +1,315 @@
+#include "wifi/datagram.h"
+#include <string.h>
+
+#define WIFI_DGRAM_REC_COUNT_IDX    3
+
+static inline uint16_t read_u16(const uint8_t *buf) {
+    return ((uint16_t)buf[0] << 8) | buf[1];
+}
+
+static inline uint32_t read_u32(const uint8_t *buf) {
+    return ((uint32_t)buf[0] << 24)
+         | ((uint32_t)buf[1] << 16)
+         | ((uint32_t)buf[2] <<  8)
+         |  (uint32_t)buf[3];
+}
+
+/**
+ * @brief 比較兩個會回繞的 16-bit 序號 (a - b)
+ *        Signed distance between two wrapping 16-bit sequence numbers (a - b)
+ */
+static inline int16_t seq_diff(uint16_t a, uint16_t b) {
+    return (int16_t)(uint16_t)(a - b);
+}
+
+/**
+ * @brief 清空 VecU8 並寫入封包標頭，紀錄數由 push_record 累加
+ *        Reset VecU8 and write the datagram header; record count is bumped by push_record
+ *
+ * @param vec_u8 輸出向量 (output vector, reset to head 0)
+ * @param hdr 標頭欄位，rec_count 會被忽略 (header fields, rec_count ignored)
+ * @return true 成功寫入 (header written)
+ */
+bool wifi_dgram_begin(VecU8 *vec_u8, const WifiDgramHeader *hdr) {
+    *vec_u8 = vec_u8_new();
+    vec_u8_push_byte(vec_u8, WIFI_DGRAM_MAGIC);
+    vec_u8_push_byte(vec_u8, WIFI_DGRAM_VERSION);
+    vec_u8_push_byte(vec_u8, hdr->flags);
+    vec_u8_push_byte(vec_u8, 0);
+    vec_u8_push_u16(vec_u8, hdr->seq);
+    vec_u8_push_u16(vec_u8, hdr->ack);
+    return vec_u8_push_u32(vec_u8, hdr->ack_bits);
+}
+
+/**
+ * @brief 附加一筆紀錄至封包末端，空間不足時不做任何修改
+ *        Append one record to the datagram; leaves it untouched when it does not fit
+ *
+ * @param vec_u8 由 wifi_dgram_begin 建立的封包 (datagram started by wifi_dgram_begin)
+ * @param type 紀錄類型 (record type, WIFI_DGRAM_REC_*)
+ * @param payload 紀錄內容 (record payload)
+ * @param len 內容長度 (payload length)
+ * @return false 封包已滿或紀錄數溢位 (datagram full or record count overflow)
+ */
+bool wifi_dgram_push_record(VecU8 *vec_u8, uint8_t type, const uint8_t *payload, uint8_t len) {
+    if (vec_u8->len < WIFI_DGRAM_HEADER_SIZE) return 0;
+    if (wifi_dgram_room(vec_u8) < len) return 0;
+    vec_u8_realign(vec_u8);
+    if (vec_u8->data[WIFI_DGRAM_REC_COUNT_IDX] == UINT8_MAX) return 0;
+    vec_u8_push_byte(vec_u8, type);
+    vec_u8_push_byte(vec_u8, len);
+    vec_u8_push(vec_u8, payload, len);
+    vec_u8->data[WIFI_DGRAM_REC_COUNT_IDX]++;
+    return 1;
+}
+
+/**
+ * @brief 封包尚可容納的紀錄內容長度 (不含紀錄標頭)
+ *        Payload bytes that still fit in the datagram, excluding the record header
+ */
+uint16_t wifi_dgram_room(const VecU8 *vec_u8) {
+    uint16_t used = vec_u8->len + WIFI_DGRAM_RECORD_HDR_SIZE;
+    if (used >= WIFI_DGRAM_MAX_SIZE) return 0;
+    return WIFI_DGRAM_MAX_SIZE - used;
+}
+
+/**
+ * @brief 解析並驗證封包標頭
+ *        Parse and validate the datagram header
+ *
+ * @param buf 原始封包 (raw datagram bytes)
+ * @param len 封包長度 (datagram length)
+ * @param hdr 輸出標頭 (output header)
+ * @return false 長度不足、magic 或版本不符 (too short, bad magic or unsupported version)
+ */
+bool wifi_dgram_parse_header(const uint8_t *buf, uint16_t len, WifiDgramHeader *hdr) {
+    if (len < WIFI_DGRAM_HEADER_SIZE) return 0;
+    if (buf[0] != WIFI_DGRAM_MAGIC) return 0;
+    if (buf[1] != WIFI_DGRAM_VERSION) return 0;
+    hdr->version    = buf[1];
+    hdr->flags      = buf[2];
+    hdr->rec_count  = buf[3];
+    hdr->seq        = read_u16(buf + 4);
+    hdr->ack        = read_u16(buf + 6);
+    hdr->ack_bits   = read_u32(buf + 8);
+    return 1;
+}
+
+/**
+ * @brief 逐筆取出紀錄，payload 直接指向原始緩衝區 (不複製)
+ *        Iterate records in place; payload points into the source buffer (no copy)
+ *
+ * @param buf 原始封包 (raw datagram bytes)
+ * @param len 封包長度 (datagram length)
+ * @param offset 目前位置，初始請設為 0 (cursor, start with 0)
+ * @param rec 輸出紀錄 (output record)
+ * @return false 沒有更多紀錄或紀錄被截斷 (no more records or truncated record)
+ */
+bool wifi_dgram_next_record(const uint8_t *buf, uint16_t len, uint16_t *offset, WifiDgramRecord *rec) {
+    if (*offset < WIFI_DGRAM_HEADER_SIZE) *offset = WIFI_DGRAM_HEADER_SIZE;
+    if (*offset + WIFI_DGRAM_RECORD_HDR_SIZE > len) return 0;
+    uint8_t rec_len = buf[*offset + 1];
+    if (*offset + WIFI_DGRAM_RECORD_HDR_SIZE + rec_len > len) return 0;
+    rec->type    = buf[*offset];
+    rec->len     = rec_len;
+    rec->payload = buf + *offset + WIFI_DGRAM_RECORD_HDR_SIZE;
+    *offset += WIFI_DGRAM_RECORD_HDR_SIZE + rec_len;
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+WifiDgramTxWindow wifi_dgram_tx_window_new(void) {
+    WifiDgramTxWindow win = {0};
+    win.next_seq = 1;
+    return win;
+}
+
+/**
+ * @brief 若重送視窗仍有空位，配發下一個可靠序號並先佔住該槽位
+ *        Hand out the next reliable sequence number and claim a window slot for it
+ *
+ * @note 佔住的槽位 (tries 為 0) 在 wifi_dgram_tx_track 前不會逾時，序號因此不會被跳過
+ *       A claimed slot (tries 0) never times out before wifi_dgram_tx_track, so no seq is skipped
+ *
+ * @param self 重送視窗 (retransmit window)
+ * @param seq 輸出序號 (output sequence number)
+ * @return false 視窗已滿，呼叫端應延後傳送控制命令 (window full, hold control commands back)
+ */
+bool wifi_dgram_tx_reserve(WifiDgramTxWindow *self, uint16_t *seq) {
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        WifiDgramTxSlot *slot = &self->slots[i];
+        if (slot->used) continue;
+        *slot = (WifiDgramTxSlot){ .seq = self->next_seq++, .used = true };
+        *seq = slot->seq;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 保存可靠封包，等待確認或重送；優先填入 wifi_dgram_tx_reserve 佔住的槽位
+ *        Keep a reliable datagram until it is acked or retransmitted, filling the slot its seq claimed
+ *
+ * @param now_us 視為首次送出的時間 (time counted as the first send)
+ */
+bool wifi_dgram_tx_track(WifiDgramTxWindow *self, uint16_t seq, const VecU8 *dgram, uint32_t now_us) {
+    WifiDgramTxSlot *target = NULL;
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        WifiDgramTxSlot *slot = &self->slots[i];
+        if (slot->used && slot->tries == 0 && slot->seq == seq) {
+            target = slot;
+            break;
+        }
+        if (!slot->used && target == NULL) target = slot;
+    }
+    if (target == NULL) return 0;
+    target->dgram   = *dgram;
+    target->seq     = seq;
+    target->sent_us = now_us;
+    target->tries   = 1;
+    target->used    = true;
+    return 1;
+}
+
+/**
+ * @brief 放棄一個已佔住但未送出的序號，歸還其槽位
+ *        Give up a claimed seq that was never sent and free its slot
+ *
+ * @note 只釋放 tries 為 0 的槽位；已送出的封包只能由確認或重試上限釋放
+ *       Only a slot with tries 0 is freed; a datagram already sent leaves by ack or retry limit only
+ *
+ * @return false 沒有此序號的佔住槽位 (no claimed slot with that seq)
+ */
+bool wifi_dgram_tx_release(WifiDgramTxWindow *self, uint16_t seq) {
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        WifiDgramTxSlot *slot = &self->slots[i];
+        if (slot->used && slot->tries == 0 && slot->seq == seq) {
+            slot->used = false;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 依累積確認與選擇確認釋放視窗中的封包
+ *        Release window slots covered by the cumulative ack or the selective ack bits
+ *
+ * @return uint8_t 被釋放的封包數 (number of slots released)
+ */
+uint8_t wifi_dgram_tx_on_ack(WifiDgramTxWindow *self, uint16_t ack, uint32_t ack_bits) {
+    uint8_t released = 0;
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        WifiDgramTxSlot *slot = &self->slots[i];
+        if (!slot->used) continue;
+        int16_t diff = seq_diff(slot->seq, ack);
+        bool acked = diff <= 0;
+        if (!acked && diff <= 32) {
+            acked = (ack_bits >> (diff - 1)) & 1U;
+        }
+        if (acked) {
+            slot->used = false;
+            released++;
+        }
+    }
+    return released;
+}
+
+/**
+ * @brief 找出逾時未確認的封包以便選擇性重送，超過重試上限者直接丟棄
+ *        Find one unacked datagram past its RTO for selective retransmit; give up after max tries
+ *
+ * @param self 重送視窗 (retransmit window)
+ * @param now_us 目前時間 (current time in us)
+ * @param dgram 輸出要重送的封包 (output datagram to resend)
+ * @param expired 若有封包因重試上限被丟棄則設為 true (set when a slot was given up)
+ * @return true 有封包需要重送 (a datagram is due)
+ */
+bool wifi_dgram_tx_next_due(WifiDgramTxWindow *self, uint32_t now_us, VecU8 *dgram, bool *expired) {
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        WifiDgramTxSlot *slot = &self->slots[i];
+        if (!slot->used || slot->tries == 0) continue;
+        if ((uint32_t)(now_us - slot->sent_us) < WIFI_DGRAM_RTO_US * slot->tries) continue;
+        if (slot->tries >= WIFI_DGRAM_MAX_TRIES) {
+            slot->used = false;
+            if (expired != NULL) *expired = true;
+            continue;
+        }
+        slot->tries++;
+        slot->sent_us = now_us;
+        *dgram = slot->dgram;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 距離下一個封包逾時還有多久，供排程器決定喚醒時間
+ *        Time until the next unacked datagram passes its RTO, for the caller's wakeup
+ *
+ * @return uint32_t 微秒；視窗為空時回傳 UINT32_MAX (us, UINT32_MAX when nothing is in flight)
+ */
+uint32_t wifi_dgram_tx_time_left(const WifiDgramTxWindow *self, uint32_t now_us) {
+    uint32_t left = UINT32_MAX;
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        const WifiDgramTxSlot *slot = &self->slots[i];
+        if (!slot->used || slot->tries == 0) continue;
+        uint32_t held = now_us - slot->sent_us;
+        uint32_t rto  = WIFI_DGRAM_RTO_US * slot->tries;
+        if (held >= rto) return 0;
+        if (rto - held < left) left = rto - held;
+    }
+    return left;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+WifiDgramRxWindow wifi_dgram_rx_window_new(void) {
+    WifiDgramRxWindow win = {0};
+    return win;
+}
+
+/**
+ * @brief 檢查可靠序號是否已處理過，不更新視窗
+ *        Tell whether a reliable seq was already handled, without recording it
+ */
+WifiDgramRxResult wifi_dgram_rx_check(const WifiDgramRxWindow *self, uint16_t seq) {
+    if (!self->synced) return WIFI_DGRAM_RX_NEW;
+    int16_t diff = seq_diff(seq, self->ack);
+    if (diff <= 0) return WIFI_DGRAM_RX_DUPLICATE;
+    if (diff > 32) return WIFI_DGRAM_RX_NEW;
+    return (self->ack_bits & (1U << (diff - 1))) ? WIFI_DGRAM_RX_DUPLICATE : WIFI_DGRAM_RX_NEW;
+}
+
+/**
+ * @brief 記錄收到的可靠序號並更新累積/選擇確認，用於去除重送造成的重複命令
+ *        Record a received reliable seq, advance the cumulative/selective ack and detect duplicates
+ *
+ * @param self 接收視窗 (receive window)
+ * @param seq 收到的序號 (received sequence number)
+ * @return WIFI_DGRAM_RX_DUPLICATE 已處理過，命令不可再次執行 (already seen, do not re-execute)
+ */
+WifiDgramRxResult wifi_dgram_rx_accept(WifiDgramRxWindow *self, uint16_t seq) {
+    if (!self->synced) {
+        self->ack      = seq - 1;
+        self->ack_bits = 0;
+        self->synced   = true;
+    }
+    int16_t diff = seq_diff(seq, self->ack);
+    if (diff <= 0) return WIFI_DGRAM_RX_DUPLICATE;
+    if (diff > 32) {
+        // 對方跳號過遠，直接重新同步 (peer jumped past the bitmap, resync)
+        self->ack      = seq;
+        self->ack_bits = 0;
+        return WIFI_DGRAM_RX_NEW;
+    }
+    uint32_t bit = 1U << (diff - 1);
+    if (self->ack_bits & bit) return WIFI_DGRAM_RX_DUPLICATE;
+    self->ack_bits |= bit;
+    while (self->ack_bits & 1U) {
+        self->ack++;
+        self->ack_bits >>= 1;
+    }
+    return WIFI_DGRAM_RX_NEW;
+}
@@ -4,14 +4,14 @@
  * @brief 全域傳輸緩衝區
  *        Global transmit ring buffer
  */
-WifiTrcvBuf wifi_tcp_transmit_buffer = {0};
-WifiTrcvBuf wifi_udp_transmit_buffer = {0};
+WifiTrcvBuf wifi_tcp_transmit_buffer = WIFI_TRCV_BUF_INIT;
+WifiTrcvBuf wifi_udp_transmit_buffer = WIFI_TRCV_BUF_INIT;
 /**
  * @brief 全域接收緩衝區
  *        Global receive ring buffer
  */
-WifiTrcvBuf wifi_tcp_receive_buffer = {0};
-WifiTrcvBuf wifi_udp_receive_buffer = {0};
+WifiTrcvBuf wifi_tcp_receive_buffer = WIFI_TRCV_BUF_INIT;
+WifiTrcvBuf wifi_udp_receive_buffer = WIFI_TRCV_BUF_INIT;
 
 /**
  * @brief 生成一個新的 Wifi 封包，包含起始碼與結束碼
@@ -21,7 +21,7 @@ WifiTrcvBuf wifi_udp_receive_buffer = {0};
  * @return WifiPacket 已封裝的 Wifi 封包 (packed Wifi packet)
  */
 WifiPacket wifi_packet_new(const ip4_addr_t *ip, const VecU8 *vec_u8) {
-    WifiPacket packet;
+    WifiPacket packet = {0};
     packet.ip = *ip;
     packet.data = vec_u8_new();
     vec_u8_push(&packet.data, vec_u8->data, vec_u8->len);
@@ -70,35 +70,51 @@ void wifi_packet_unpack(const WifiPacket *packet, ip4_addr_t *ip, VecU8 *vec_u8)
  * @brief 建立傳輸/接收環形緩衝區，初始化頭指標與計數
  *        Create a transmit/receive ring buffer, initialize head index and length
  *
+ * @note head/length 只在 lock 內修改，可由不同任務推入與取出；
+ *       reserve/front 取得的槽位在 commit/pop 前只屬於單一生產者/消費者
+ *       head/length only change under lock so different tasks may push and pop;
+ *       slots from reserve/front belong to the single producer/consumer until commit/pop
+ *
  * @return WifiTrcvBuf 初始化後的環形緩衝區 (initialized ring buffer)
  */
 WifiTrcvBuf wifi_trcv_buffer_new(void) {
-    WifiTrcvBuf transceive_buffer;
-    transceive_buffer.head = 0;
-    transceive_buffer.length = 0;
+    WifiTrcvBuf transceive_buffer = WIFI_TRCV_BUF_INIT;
     return transceive_buffer;
 }
 
 bool wifi_trcv_buffer_get_front(WifiTrcvBuf *buffer, WifiPacket *packet) {
-    if (buffer->length == 0) return 0;
-    *packet = buffer->packet[buffer->head];
-    return 1;
+    bool ok = false;
+    taskENTER_CRITICAL(&buffer->lock);
+    if (buffer->length != 0) {
+        *packet = buffer->packet[buffer->head];
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&buffer->lock);
+    return ok;
 }
 
 /**
- * @brief 將封包推入環形緩衝區，若已滿則返回 false
- *        Push a packet into the ring buffer; return false if buffer is full
+ * @brief 將封包推入環形緩衝區，若已滿則返回 false 並累計丟棄數
+ *        Push a packet into the ring buffer; return false and count a drop if buffer is full
  *
  * @param buffer 指向環形緩衝區的指標 (input/output ring buffer)
  * @param packet 要推入緩衝區的 UART 封包 (input UART packet)
  * @return bool 是否推入成功 (true if push successful, false if buffer full)
  */
 bool wifi_trcv_buffer_push(WifiTrcvBuf *buffer, const WifiPacket *packet) {
-    if (buffer->length >= WIFI_TRCV_BUF_CAP) return false;
-    uint8_t tail = (buffer->head + buffer->length) % WIFI_TRCV_BUF_CAP;
-    buffer->packet[tail] = *packet;
-    buffer->length++;
-    return true;
+    bool ok = false;
+    taskENTER_CRITICAL(&buffer->lock);
+    if (buffer->length >= WIFI_TRCV_BUF_CAP) {
+        buffer->drops++;
+    } else {
+        uint8_t tail = (buffer->head + buffer->length) % WIFI_TRCV_BUF_CAP;
+        buffer->packet[tail] = *packet;
+        buffer->length++;
+        if (buffer->length > buffer->high_water) buffer->high_water = buffer->length;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&buffer->lock);
+    return ok;
 }
 
 /**
@@ -106,16 +122,63 @@ bool wifi_trcv_buffer_push(WifiTrcvBuf *buffer, const WifiPacket *packet) {
  *        Pop a packet from the ring buffer
  *
  * @param buffer 指向環形緩衝區的指標 (input/output ring buffer)
- * @param packet 輸出參數，接收彈出的 UART 封包 (output popped UART packet)
+ * @param packet 輸出參數，接收彈出的 UART 封包，可為 NULL (output popped UART packet, may be NULL)
  * @return bool 是否彈出成功 (true if pop successful, false if buffer empty)
  */
 bool wifi_trcv_buffer_pop(WifiTrcvBuf *buffer, WifiPacket *packet) {
-    if (buffer->length == 0) return 0;
-    *packet = buffer->packet[buffer->head];
-    if (--buffer->length == 0) {
-        buffer->head = 0;
-    } else {
+    bool ok = false;
+    taskENTER_CRITICAL(&buffer->lock);
+    if (buffer->length != 0) {
+        if (packet != NULL) *packet = buffer->packet[buffer->head];
+        // 不在清空時把 head 歸零，否則已 reserve 的槽位會錯位 (never rewind head, a reserved slot would move)
         buffer->head = (buffer->head + 1) % WIFI_TRCV_BUF_CAP;
+        buffer->length--;
+        ok = true;
+    }
+    taskEXIT_CRITICAL(&buffer->lock);
+    return ok;
+}
+
+/**
+ * @brief 取得環形緩衝區尾端的空槽位，讓接收端直接寫入 (不複製)
+ *        Reserve the tail slot so a receiver can fill it in place (zero copy)
+ *
+ * @param buffer 指向環形緩衝區的指標 (input/output ring buffer)
+ * @return WifiPacket* 可寫入的槽位，緩衝區已滿時為 NULL (writable slot, NULL when full)
+ */
+WifiPacket *wifi_trcv_buffer_reserve(WifiTrcvBuf *buffer) {
+    WifiPacket *slot = NULL;
+    taskENTER_CRITICAL(&buffer->lock);
+    if (buffer->length < WIFI_TRCV_BUF_CAP) {
+        slot = &buffer->packet[(buffer->head + buffer->length) % WIFI_TRCV_BUF_CAP];
+    }
+    taskEXIT_CRITICAL(&buffer->lock);
+    return slot;
+}
+
+/**
+ * @brief 確認 wifi_trcv_buffer_reserve 取得的槽位已寫入完成
+ *        Publish the slot previously obtained from wifi_trcv_buffer_reserve
+ */
+void wifi_trcv_buffer_commit(WifiTrcvBuf *buffer) {
+    taskENTER_CRITICAL(&buffer->lock);
+    if (buffer->length < WIFI_TRCV_BUF_CAP) {
+        buffer->length++;
+        if (buffer->length > buffer->high_water) buffer->high_water = buffer->length;
     }
-    return 1;
+    taskEXIT_CRITICAL(&buffer->lock);
+}
+
+/**
+ * @brief 取得環形緩衝區最前端封包的指標，供原地解析
+ *        Peek the front packet in place for parsing without copying it out
+ *
+ * @return WifiPacket* 最前端封包，緩衝區為空時為 NULL (front packet, NULL when empty)
+ */
+WifiPacket *wifi_trcv_buffer_front(WifiTrcvBuf *buffer) {
+    WifiPacket *front = NULL;
+    taskENTER_CRITICAL(&buffer->lock);
+    if (buffer->length != 0) front = &buffer->packet[buffer->head];
+    taskEXIT_CRITICAL(&buffer->lock);
+    return front;
 }
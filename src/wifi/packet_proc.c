@@ -1 +1,131 @@
 #include "wifi/packet_proc.h"
+#include "wifi/datagram.h"
+#include "wifi/udp_transceive.h"
+#include "uart/command.h"
+#include "uart/transceive.h"
+#include "telemetry/cache.h"
+#include "metrics.h"
+#include "esp_timer.h"
+
+// 每個 UART 埠一批，只在分派任務中使用 (one batch per UART port, used by the dispatcher task only)
+static UartCmdBatch wifi_udp_cmd_batches[UART_LINK_COUNT];
+
+/**
+ * @brief 把一筆命令加入目標埠的批次；停止命令立即喚醒該埠的傳輸任務
+ *        Add one command to its port's batch; a stop wakes that port's TX task right away
+ *
+ * @note 不存在或未開啟的埠沒有傳輸任務，命令計為丟棄 (unknown or unopened ports have no TX task, the command counts as a drop)
+ *
+ * @param port 目標 UART 埠 (destination UART port)
+ * @param payload 命令碼加參數 (command code and arguments)
+ */
+static void wifi_udp_add_cmd(uint8_t port, const uint8_t *payload, uint8_t len) {
+    if (len == 0 || port >= UART_LINK_COUNT || !uart_links[port].open) {
+        metrics_inc(METRIC_WIFI_UDP_CMD_DROPS);
+        return;
+    }
+    UartCmdBatch *batch = &wifi_udp_cmd_batches[port];
+    if (!uart_cmd_batch_add(batch, payload[0], payload + 1, len - 1)) {
+        metrics_inc(METRIC_WIFI_UDP_CMD_DROPS);
+    } else if (uart_cmd_is_estop(payload[0], payload + 1, len - 1)) {
+        uart_tx_kick(batch->link);
+    }
+}
+
+/**
+ * @brief 以快取值回覆遙測查詢，不轉送給 STM32
+ *        Answer a telemetry query from the cache without a round trip to the STM32
+ *
+ * @param from 查詢封包，回覆送往其來源位址與埠 (query datagram, the reply goes to its source address and port)
+ * @param rec 查詢紀錄 (query record)
+ */
+static void wifi_udp_answer_query(const WifiPacket *from, const WifiDgramRecord *rec) {
+    uint8_t payload[TELEMETRY_CACHE_ENTRY_WIRE_SIZE * TELEMETRY_CH_COUNT];
+    uint8_t mask = rec->len >= 1 ? rec->payload[0] : 0;
+    uint32_t max_age_us = TELEMETRY_CACHE_DEFAULT_MAX_AGE_US;
+    if (rec->len >= 3) {
+        max_age_us = (((uint32_t)rec->payload[1] << 8) | rec->payload[2]) * 1000U;
+    }
+    uint8_t len = telemetry_cache_encode(mask, max_age_us, payload, sizeof(payload));
+    wifi_udp_send_snapshot(&from->ip, from->port, payload, len);
+    metrics_inc(METRIC_TELEMETRY_QUERIES);
+}
+
+/**
+ * @brief 原地解析 wifi_udp_receive_buffer 中所有封包並分派紀錄
+ *        Parse every datagram in wifi_udp_receive_buffer in place and dispatch its records
+ *
+ * @note 可靠封包處理完後整批只回一次確認 (one ack per batch for reliable datagrams)
+ * @note 命令因 UART 佇列已滿而被丟棄的可靠封包不確認 (reliable datagrams whose commands hit a full UART queue are not acked)
+ *
+ * @return void
+ */
+void wifi_udp_receive_pkt_proc(void) {
+    ip4_addr_t ack_ip;
+    uint16_t ack_port = 0;
+    bool ack_pending = false;
+    WifiPacket *packet;
+    while ((packet = wifi_trcv_buffer_front(&wifi_udp_receive_buffer)) != NULL) {
+        int64_t start_us = esp_timer_get_time();
+        pkt_trace_stamp(&packet->trace, PKT_STAGE_DISPATCH);
+        const uint8_t *buf = packet->data.data;
+        uint16_t len = packet->data.len;
+        WifiDgramHeader hdr;
+        if (!wifi_dgram_parse_header(buf, len, &hdr)) {
+            metrics_inc(METRIC_WIFI_UDP_RX_BAD);
+            wifi_trcv_buffer_pop(&wifi_udp_receive_buffer, NULL);
+            continue;
+        }
+        bool fresh = wifi_udp_accept_header(&hdr);
+        // 同一封包內送往同一埠的命令合併後整批排入 (commands of one datagram are coalesced and queued per port)
+        for (uint8_t i = 0; i < UART_LINK_COUNT; i++) {
+            uart_cmd_batch_init(&wifi_udp_cmd_batches[i], &uart_links[i]);
+            wifi_udp_cmd_batches[i].trace = packet->trace;
+        }
+        uint16_t offset = 0;
+        WifiDgramRecord rec;
+        while (fresh && wifi_dgram_next_record(buf, len, &offset, &rec)) {
+            switch (rec.type) {
+                case WIFI_DGRAM_REC_CMD:
+                    wifi_udp_add_cmd(UART_LINK_PRIMARY, rec.payload, rec.len);
+                    break;
+                case WIFI_DGRAM_REC_PORT_CMD:
+                    if (rec.len == 0) {
+                        metrics_inc(METRIC_WIFI_UDP_CMD_DROPS);
+                        break;
+                    }
+                    wifi_udp_add_cmd(rec.payload[0], rec.payload + 1, rec.len - 1);
+                    break;
+                case WIFI_DGRAM_REC_QUERY:
+                    wifi_udp_answer_query(packet, &rec);
+                    break;
+                default:
+                    break;
+            }
+        }
+        bool queued = true;
+        for (uint8_t i = 0; i < UART_LINK_COUNT; i++) {
+            UartCmdBatch *batch = &wifi_udp_cmd_batches[i];
+            if (batch->cmds == 0) continue;
+            if (!uart_cmd_batch_commit(batch)) {
+                metrics_add(METRIC_WIFI_UDP_CMD_DROPS, batch->cmds - batch->slotted);
+                queued = false;
+            }
+            uart_tx_kick(batch->link);
+        }
+        // 命令未能全部排入的可靠封包不確認，由對方重送；槽位命令重送時覆寫同一槽位，不會重複執行
+        // A reliable datagram whose commands did not all fit stays unacked for the peer to resend;
+        // its slotted commands just overwrite the same slots again
+        if ((hdr.flags & WIFI_DGRAM_FLAG_RELIABLE) && (!fresh || queued)) {
+            if (fresh) wifi_udp_confirm_header(&hdr);
+            ack_ip = packet->ip;
+            ack_port = packet->port;
+            ack_pending = true;
+        }
+        wifi_trcv_buffer_pop(&wifi_udp_receive_buffer, NULL);
+        metrics_observe(METRIC_HIST_WIFI_UDP_RX_PROC_US, (uint32_t)(esp_timer_get_time() - start_us));
+    }
+    if (ack_pending) {
+        wifi_udp_send_ack(&ack_ip, ack_port);
+    }
+}
@@ -1,8 +1,12 @@
 #include "wifi/tcp_transceive.h"
-#include "prioritites_sequ.h"
+#include "wifi/udp_transceive.h"
+#include "wifi/udp_echo.h"
+#include "task_layout.h"
+#include "capture.h"
 #include "mcu_const.h"
 #include <stdint.h>
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -11,7 +15,8 @@
 #include "lwip/netdb.h"
 #include "http_parser/http_parser.h"
 
-#define TARGET_IP   "192.168.0.11"
+#define TARGET_IP   CONFIG_STATION_PEER_IP
+#define TARGET_PORT CONFIG_STATION_PEER_TCP_PORT
 #define TCP_PORT    60000
 
 static const char *TAG = "wifi_tcp_trcv";
@@ -21,11 +26,12 @@ static const char *TAG = "wifi_tcp_trcv";
 
 static void wifi_tasks_spawn(void);
 void wifi_transceive_setup(void) {
+    wifi_udp_setup();
     wifi_tasks_spawn();
 }
 
 typedef struct {
-    char *method_str;       // HTTP method (e.g., "GET", "POST")
+    const char *method_str; // HTTP method (e.g., "GET", "POST")
     char *url;              // Request URI (e.g., "/hello")
     // 簡單把 header 存成陣列，實務上可能希望用 map 或 Hash table
     struct {
@@ -44,17 +50,55 @@ static size_t tmp_f_len   = 0;
 static char *tmp_value    = NULL;
 static size_t tmp_v_len   = 0;
 
+/**
+ * @brief 解析結果的固定記憶體區，每筆 request 開始時整區重置，不使用 heap
+ *        Fixed arena for parsed strings, reset at the start of every request instead of using the heap
+ *
+ * @note 整筆 request 最多 VECU8_MAX_CAPACITY 位元組，字串總長不會超過兩倍
+ *       A request is at most VECU8_MAX_CAPACITY bytes, so its strings never exceed twice that
+ */
+#define WIFI_TCP_ARENA_SIZE (VECU8_MAX_CAPACITY * 2)
+static char wifi_tcp_arena[WIFI_TCP_ARENA_SIZE];
+static size_t wifi_tcp_arena_used = 0;
+static char *wifi_tcp_arena_last = NULL;
+
+static char *wifi_tcp_arena_alloc(size_t len) {
+    if (len > sizeof(wifi_tcp_arena) - wifi_tcp_arena_used) return NULL;
+    char *ptr = wifi_tcp_arena + wifi_tcp_arena_used;
+    wifi_tcp_arena_used += len;
+    wifi_tcp_arena_last = ptr;
+    return ptr;
+}
+
+/**
+ * @brief 在 str 後面接上 at，必要時搬到新位置；str 為最後配置的字串時原地延長
+ *        Append at to str (length len), in place when str is the latest allocation
+ *
+ * @return char* 新字串，空間不足時為 NULL (new string, NULL when the arena is full)
+ */
+static char *wifi_tcp_arena_append(char *str, size_t len, const char *at, size_t length) {
+    char *dst;
+    if (str != NULL && str == wifi_tcp_arena_last && wifi_tcp_arena_alloc(length) != NULL) {
+        wifi_tcp_arena_last = str;
+        dst = str;
+    } else {
+        dst = wifi_tcp_arena_alloc(len + length + 1);
+        if (dst == NULL) return NULL;
+        if (str != NULL) memcpy(dst, str, len);
+    }
+    memcpy(dst + len, at, length);
+    dst[len + length] = '\0';
+    return dst;
+}
+
 // helper：把完整的一對 Header field+value 加入 current_req.headers[]
 static void add_header_entry() {
     if (current_req.num_headers < 16) {
         current_req.headers[current_req.num_headers].field = tmp_field;
         current_req.headers[current_req.num_headers].value = tmp_value;
         current_req.num_headers++;
-    } else {
-        // 若超過上限，可選擇忽略或 free tmp_field/tmp_value
-        free(tmp_field);
-        free(tmp_value);
     }
+    // 超過上限的 header 直接忽略，空間隨下一筆 request 回收 (extra headers are dropped, the arena is reset per request)
     tmp_field = NULL; tmp_f_len = 0;
     tmp_value = NULL; tmp_v_len = 0;
 }
@@ -65,14 +109,8 @@ static void add_header_entry() {
 // on_message_begin：每次收到新 request 時，會在最一開始呼叫
 static int on_message_begin_cb(http_parser *parser) {
     // 先清空 current_req 裡面之前殘留的資料
-    if (current_req.url) { free(current_req.url); }
-    if (current_req.method_str) { free(current_req.method_str); }
-    for (size_t i = 0; i < current_req.num_headers; i++) {
-        free(current_req.headers[i].field);
-        free(current_req.headers[i].value);
-    }
-    if (current_req.body) { free(current_req.body); }
-
+    wifi_tcp_arena_used = 0;
+    wifi_tcp_arena_last = NULL;
     memset(&current_req, 0, sizeof(current_req));
     tmp_field = NULL; tmp_f_len = 0;
     tmp_value = NULL; tmp_v_len = 0;
@@ -81,17 +119,9 @@ static int on_message_begin_cb(http_parser *parser) {
 
 // on_url：解析到 URL 時被呼叫 (只對 HTTP_REQUEST 有意義)
 static int on_url_cb(http_parser *parser, const char *at, size_t length) {
-    if (current_req.url == NULL) {
-        current_req.url = (char *)malloc(length + 1);
-        memcpy(current_req.url, at, length);
-        current_req.url[length] = '\0';
-    } else {
-        size_t old_len = strlen(current_req.url);
-        current_req.url = (char *)realloc(current_req.url, old_len + length + 1);
-        memcpy(current_req.url + old_len, at, length);
-        current_req.url[old_len + length] = '\0';
-    }
-    return 0;
+    size_t old_len = current_req.url ? strlen(current_req.url) : 0;
+    current_req.url = wifi_tcp_arena_append(current_req.url, old_len, at, length);
+    return current_req.url == NULL;
 }
 
 // on_header_field：解析到 Header 名稱時被呼叫
@@ -101,34 +131,16 @@ static int on_header_field_cb(http_parser *parser, const char *at, size_t length
         add_header_entry();
     }
     // 開始累積新的 field 片段
-    if (tmp_field == NULL) {
-        tmp_field = (char *)malloc(length + 1);
-        memcpy(tmp_field, at, length);
-        tmp_field[length] = '\0';
-        tmp_f_len = length;
-    } else {
-        tmp_field = (char *)realloc(tmp_field, tmp_f_len + length + 1);
-        memcpy(tmp_field + tmp_f_len, at, length);
-        tmp_f_len += length;
-        tmp_field[tmp_f_len] = '\0';
-    }
-    return 0;
+    tmp_field = wifi_tcp_arena_append(tmp_field, tmp_f_len, at, length);
+    tmp_f_len += length;
+    return tmp_field == NULL;
 }
 
 // on_header_value：解析到 Header 值時被呼叫
 static int on_header_value_cb(http_parser *parser, const char *at, size_t length) {
-    if (tmp_value == NULL) {
-        tmp_value = (char *)malloc(length + 1);
-        memcpy(tmp_value, at, length);
-        tmp_value[length] = '\0';
-        tmp_v_len = length;
-    } else {
-        tmp_value = (char *)realloc(tmp_value, tmp_v_len + length + 1);
-        memcpy(tmp_value + tmp_v_len, at, length);
-        tmp_v_len += length;
-        tmp_value[tmp_v_len] = '\0';
-    }
-    return 0;
+    tmp_value = wifi_tcp_arena_append(tmp_value, tmp_v_len, at, length);
+    tmp_v_len += length;
+    return tmp_value == NULL;
 }
 
 // on_headers_complete：所有 header 解析完成時呼叫
@@ -138,11 +150,10 @@ static int on_headers_complete_cb(http_parser *parser) {
         add_header_entry();
     }
     // 把 Method 存起來
-    const char *m = http_method_str(parser->method);
-    current_req.method_str = strdup(m);
-    // 若有 Content-Length，就先 allocate 一塊 body buffer
-    if (parser->content_length > 0) {
-        current_req.body = (char *)malloc(parser->content_length + 1);
+    current_req.method_str = http_method_str(parser->method);
+    // 若有 Content-Length，就先在固定區配置 body buffer (放不下時略過 body)
+    if (parser->content_length > 0 && parser->content_length < WIFI_TCP_ARENA_SIZE) {
+        current_req.body = wifi_tcp_arena_alloc(parser->content_length + 1);
         current_req.body_len = 0;
     }
     return 0;
@@ -182,6 +193,10 @@ static int on_message_complete_cb(http_parser *parser) {
 #ifndef MIN
   #define MIN(a, b)  (((a) < (b)) ? (a) : (b))
 #endif
+// 只在 TCP 接收任務中使用，放在靜態區而非任務堆疊 (TCP receive task only, kept off its stack)
+static char wifi_tcp_header_buf[BUFFER_SIZE + 1];
+static uint8_t wifi_tcp_body_buf[BUFFER_SIZE];
+
 static bool wifi_tcp_read(WifiPacket *packet, int sock) {
     struct sockaddr_in client_addr;
     socklen_t client_len = sizeof(client_addr);
@@ -193,7 +208,7 @@ static bool wifi_tcp_read(WifiPacket *packet, int sock) {
     ESP_LOGI(TAG, "TCP connection from %s:%d", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
 
     // 1. 先讀 header（直到 "\r\n\r\n"）
-    char header_buf[BUFFER_SIZE];
+    char *header_buf = wifi_tcp_header_buf;
     int total_header_len   = 0;
     int header_end_index   = -1;
     VecU8 vec_u8          = vec_u8_new();
@@ -201,7 +216,7 @@ static bool wifi_tcp_read(WifiPacket *packet, int sock) {
     while (1) {
         int len = recv(client_sock,
                        header_buf + total_header_len,
-                       20,
+                       MIN(20, BUFFER_SIZE - total_header_len),
                        // BUFFER_SIZE - total_header_len,
                        0);
         if (len < 0) {
@@ -216,6 +231,7 @@ static bool wifi_tcp_read(WifiPacket *packet, int sock) {
             return false;
         }
         total_header_len += len;
+        header_buf[total_header_len] = '\0';
         ESP_LOGI(TAG, "recv get \n%.*s", (int)total_header_len, header_buf);
         char *pos = strstr(header_buf, "\r\n\r\n");
         if (pos != NULL) {
@@ -260,7 +276,7 @@ static bool wifi_tcp_read(WifiPacket *packet, int sock) {
     // 5. 若 body 還沒接收完，就持續 recv，直到讀滿 content_len 字節
     int remaining = content_len - already_body;
     while (remaining > 0) {
-        uint8_t tmp_buf[BUFFER_SIZE];
+        uint8_t *tmp_buf = wifi_tcp_body_buf;
         int len2 = recv(client_sock, tmp_buf, MIN(remaining, BUFFER_SIZE), 0);
         if (len2 <= 0) {
             ESP_LOGE(TAG, "recv body failed: errno %d", errno);
@@ -272,6 +288,7 @@ static bool wifi_tcp_read(WifiPacket *packet, int sock) {
     }
 
     close(client_sock);
+    capture_record(CAPTURE_SRC_TCP_RX, vec_u8.data, vec_u8.len);
     ESP_LOGI(TAG, "TCP client disconnected");
     ESP_LOGI(TAG, "Body (%d bytes): %.*s", (int)current_req.body_len, (int)current_req.body_len, current_req.body);
 
@@ -344,8 +361,8 @@ static void wifi_tcp_read_task(void *pvParameters) {
         return;
     }
     ESP_LOGI(TAG, "TCP listening on port %d", TCP_PORT);
+    static WifiPacket packet;
     while(1) {
-        WifiPacket packet;
         if (!wifi_tcp_read(&packet, sock)) {
             continue;
         }
@@ -400,7 +417,7 @@ static int wifi_tcp_write(const char *remote_ip, const uint16_t remote_port, con
 void wifi_tcp_write_task(void) {
     VecU8 vec_u8 = vec_u8_new();
     vec_u8_push(&vec_u8, CMD_RIGHT_ADC_STORE, sizeof(CMD_RIGHT_ADC_STORE));
-    int sent = wifi_tcp_write(TARGET_IP, TCP_PORT, &vec_u8);
+    int sent = wifi_tcp_write(TARGET_IP, TARGET_PORT, &vec_u8);
     if (sent < 0) {
         ESP_LOGE(TAG, "TCP send failed: %d", sent);
     }
@@ -408,8 +425,11 @@ void wifi_tcp_write_task(void) {
 }
 
 static void wifi_tasks_spawn(void) {
-    // xTaskCreate(wifi_udp_read_task, "udp_server", 4096, NULL, WIFI_UDP_READ_TASK_PRIO_SEQU, NULL);
-    xTaskCreate(wifi_tcp_read_task, "tcp_recv", 8192, NULL, WIFI_TCP_READ_TASK_PRIO_SEQU, NULL);
+    task_layout_spawn(TASK_ID_WIFI_UDP_RX, wifi_udp_read_task, NULL);
+    task_layout_spawn(TASK_ID_WIFI_TCP_RX, wifi_tcp_read_task, NULL);
+#if CONFIG_STATION_UDP_ECHO
+    task_layout_spawn(TASK_ID_WIFI_UDP_ECHO, wifi_udp_echo_task, NULL);
+#endif
     // BaseType_t ret = 
     // if (ret != pdPASS) {
     //     ESP_LOGE(TAG, "xTaskCreate(wifi_tcp_read_task) failed");
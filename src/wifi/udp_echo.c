@@ -0,0 +1,48 @@
+#include "wifi/udp_echo.h"
+#include "sdkconfig.h"
+#include <errno.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+
+#if CONFIG_STATION_UDP_ECHO
+
+#define WIFI_UDP_ECHO_BUF_SIZE  512
+
+static const char *TAG = "wifi_udp_echo";
+
+/**
+ * @brief 原樣回送收到的 UDP 封包，供 tools/udp_pingpong.py 量測往返延遲
+ *        Echo every datagram back unchanged so tools/udp_pingpong.py can measure round trips
+ */
+void wifi_udp_echo_task(void *pvParameters) {
+    static uint8_t buf[WIFI_UDP_ECHO_BUF_SIZE];
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        vTaskDelete(NULL);
+        return;
+    }
+    struct sockaddr_in addr = {
+        .sin_family         = AF_INET,
+        .sin_port           = htons(CONFIG_STATION_UDP_ECHO_PORT),
+        .sin_addr.s_addr    = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Socket bind failed: errno %d", errno);
+        close(sock);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Echoing on port %d", CONFIG_STATION_UDP_ECHO_PORT);
+    while (1) {
+        struct sockaddr_in peer;
+        socklen_t socklen = sizeof(peer);
+        int len = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr*)&peer, &socklen);
+        if (len < 0) continue;
+        sendto(sock, buf, len, 0, (struct sockaddr*)&peer, socklen);
+    }
+}
+
+#endif
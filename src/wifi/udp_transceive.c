@@ -1,53 +1,118 @@
 #include "wifi/udp_transceive.h"
-#include "prioritites_sequ.h"
+#include "task_layout.h"
+#include "dispatcher.h"
+#include "metrics.h"
+#include "capture.h"
 #include "mcu_const.h"
+#include "wifi/datagram.h"
+#include "wifi/aggregator.h"
+#include "wifi/packet_proc.h"
 #include <errno.h>
 #include <stdint.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "lwip/sockets.h"
 #include "lwip/netdb.h"
 
-#define TARGET_IP   "192.168.0.11"
+#define TARGET_IP   CONFIG_STATION_PEER_IP
+#define TARGET_PORT CONFIG_STATION_PEER_UDP_PORT
 #define UDP_PORT    60001
 
+// 遙測聚合最長保留時間 (telemetry aggregation hold bound)
+#define WIFI_UDP_AGGR_DEADLINE_US   WIFI_AGGR_DEFAULT_DEADLINE_US
+#define WIFI_UDP_RX_LOG_PERIOD_US   5000000
+// 緩衝池滿時等待分派任務騰出槽位的上限 (bound on waiting for the dispatcher to free a pooled slot)
+#define WIFI_UDP_RX_FULL_WAIT_MS    20
+
 static const char *TAG = "wifi_udp_trcv";
 
-static bool wifi_udp_read(WifiPacket *packet, int sock) {
-    uint8_t rx_buffer[VECU8_MAX_CAPACITY];
+static int wifi_udp_tx_sock = -1;
+static WifiDgramRxWindow wifi_udp_rx_window;
+
+/**
+ * @brief 直接接收一個 UDP 封包到緩衝池的槽位中
+ *        Receive one datagram straight into a pooled slot
+ *
+ * @param packet 由 wifi_trcv_buffer_reserve 取得的槽位 (slot from wifi_trcv_buffer_reserve)
+ * @param sock 已綁定的 socket (bound socket)
+ * @param flags 0 為阻塞，MSG_DONTWAIT 為非阻塞 (0 blocks, MSG_DONTWAIT drains)
+ * @return int 收到的位元組數；被截斷或空的封包計數後丟棄並回傳 0；沒有資料或錯誤時為負值
+ *             (bytes received; 0 when a truncated or empty datagram was counted and dropped; negative when drained or on error)
+ */
+static int wifi_udp_read(WifiPacket *packet, int sock, int flags) {
     struct sockaddr_in client_addr;
-    socklen_t socklen = sizeof(client_addr);
-    int len = recvfrom(sock, rx_buffer, sizeof(rx_buffer), 0, (struct sockaddr*)&client_addr, &socklen);
-    if (len <= 0) {
+    struct iovec iov;
+    struct msghdr msg = {
+        .msg_name       = &client_addr,
+        .msg_namelen    = sizeof(client_addr),
+        .msg_iov        = &iov,
+        .msg_iovlen     = 1,
+    };
+    packet->data = vec_u8_new();
+    iov.iov_base = packet->data.data;
+    iov.iov_len  = VECU8_MAX_CAPACITY;
+    int len = recvmsg(sock, &msg, flags);
+    if (len < 0) {
+        return -1;
+    }
+    metrics_inc(METRIC_WIFI_UDP_RX_DATAGRAMS);
+    if (msg.msg_flags & MSG_TRUNC) {
+        metrics_inc(METRIC_WIFI_UDP_RX_TRUNCATED);
         return 0;
     }
-    ip4_addr_t ip;
-    ip.addr = client_addr.sin_addr.s_addr;
-    VecU8 vec_u8 = vec_u8_new();
-    vec_u8_push(&vec_u8, rx_buffer, len);
-    *packet = wifi_packet_new(&ip, &vec_u8);
-    ESP_LOGI(TAG, "Received %d bytes from %s:%d → %.*s",
-        len,
-        inet_ntoa(client_addr.sin_addr),
-        ntohs(client_addr.sin_port),
-        len,
-        rx_buffer);
-    return 1;
+    if (len == 0) {
+        metrics_inc(METRIC_WIFI_UDP_RX_BAD);
+        return 0;
+    }
+    packet->ip.addr = client_addr.sin_addr.s_addr;
+    packet->port = ntohs(client_addr.sin_port);
+    packet->data.len = len;
+    packet->trace = (PktTrace){0};
+    pkt_trace_stamp(&packet->trace, PKT_STAGE_RX);
+    capture_record(CAPTURE_SRC_UDP_RX, packet->data.data, len);
+    metrics_add(METRIC_WIFI_UDP_RX_BYTES, len);
+    return len;
+}
+
+/**
+ * @brief 定期輸出接收統計，避免每個封包都記錄 log
+ *        Print receive counters at most every WIFI_UDP_RX_LOG_PERIOD_US, keeping logs off the hot path
+ */
+static void wifi_udp_rx_log_stats(void) {
+    static int64_t last_us = 0;
+    static uint32_t last_datagrams = 0;
+    int64_t now_us = esp_timer_get_time();
+    if (now_us - last_us < WIFI_UDP_RX_LOG_PERIOD_US) return;
+    last_us = now_us;
+    uint32_t datagrams = metrics_counter_total(METRIC_WIFI_UDP_RX_DATAGRAMS);
+    if (datagrams == last_datagrams) return;
+    last_datagrams = datagrams;
+    ESP_LOGI(TAG, "rx datagrams=%lu bytes=%lu drops=%lu bad=%lu dups=%lu",
+        (unsigned long)datagrams,
+        (unsigned long)metrics_counter_total(METRIC_WIFI_UDP_RX_BYTES),
+        (unsigned long)metrics_counter_total(METRIC_WIFI_UDP_CMD_DROPS),
+        (unsigned long)metrics_counter_total(METRIC_WIFI_UDP_RX_BAD),
+        (unsigned long)metrics_counter_total(METRIC_WIFI_UDP_RX_DUPS));
 }
 
 /**
  * @brief UDP 伺服器任務
  *
- * 阻塞接收 UDP 封包並印出來源 IP:Port 與內容
+ * 阻塞等待第一個封包，之後以非阻塞方式一次收完所有待處理封包，
+ * 直接寫入 wifi_udp_receive_buffer 的槽位，再通知分派任務整批解析。
+ * 緩衝池滿時等分派任務處理後再繼續收，未讀的封包留在 socket 中不會遺失。
  *
  * @param pvParameters 任務參數 (未使用)
  * @return 不會返回
  *
- * UDP server task: blocks to receive packets and logs source IP:port and data
+ * UDP server task: block for the first datagram, then drain every pending datagram
+ * non-blockingly into pooled wifi_udp_receive_buffer slots and wake the dispatcher to parse
+ * the batch. On a full pool it waits for the dispatcher, so the socket holds the rest.
  */
-static void wifi_udp_read_task(void *pvParameters) {
+void wifi_udp_read_task(void *pvParameters) {
     int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
     if (sock < 0) {
         ESP_LOGE(TAG, "Unable to create socket: errno %d", sock);
@@ -67,11 +132,24 @@ static void wifi_udp_read_task(void *pvParameters) {
     }
     ESP_LOGI(TAG, "Socket bound, listening on port %d", UDP_PORT);
     while (1) {
-        WifiPacket packet;
-        if (!wifi_udp_read(&packet, sock)) {
-            continue;
+        int flags = 0;
+        while (1) {
+            WifiPacket *slot = wifi_trcv_buffer_reserve(&wifi_udp_receive_buffer);
+            if (slot == NULL) {
+                dispatcher_post(DISPATCH_EV_UDP_RX);
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WIFI_UDP_RX_FULL_WAIT_MS));
+                continue;
+            }
+            int len = wifi_udp_read(slot, sock, flags);
+            if (len < 0) break;
+            flags = MSG_DONTWAIT;
+            // 已丟棄的封包不佔用槽位 (a dropped datagram leaves the slot free)
+            if (len == 0) continue;
+            pkt_trace_stamp(&slot->trace, PKT_STAGE_ENQUEUE);
+            wifi_trcv_buffer_commit(&wifi_udp_receive_buffer);
         }
-        wifi_trcv_buffer_push(&wifi_udp_receive_buffer, &packet);
+        dispatcher_post(DISPATCH_EV_UDP_RX);
+        wifi_udp_rx_log_stats();
     }
     close(sock);
     vTaskDelete(NULL);
@@ -80,50 +158,259 @@ static void wifi_udp_read_task(void *pvParameters) {
 /**
  * @brief UDP 發送函式
  *
- * 將 data 經 UDP 發送到 remote_ip:remote_port，
+ * 將 data 經 UDP 發送到 ip:remote_port，socket 建立一次後重複使用，
  * 並回傳實際送出的 byte 數或負值 errno。
  *
- * Send data via UDP to remote_ip:remote_port;
+ * Send data via UDP to ip:remote_port over a lazily created, reused socket;
  * returns number of bytes sent or negative errno on error.
  */
-static int wifi_udp_write(const char *remote_ip, const uint16_t remote_port, const VecU8 *vec_u8) {
-    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-    if (sock < 0) {
-        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
-        return -errno;
+static int wifi_udp_write(const ip4_addr_t *ip, const uint16_t remote_port, const VecU8 *vec_u8) {
+    if (wifi_udp_tx_sock < 0) {
+        wifi_udp_tx_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+        if (wifi_udp_tx_sock < 0) {
+            ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+            return -errno;
+        }
     }
     struct sockaddr_in addr = {
         .sin_family         = AF_INET,
         .sin_port           = htons(remote_port),
-        .sin_addr.s_addr    = inet_addr(remote_ip),
+        .sin_addr.s_addr    = ip->addr,
     };
 
     // ESP_LOG_BUFFER_HEXDUMP(TAG, vec_u8->data, vec_u8->length, ESP_LOG_INFO);
+    int64_t start_us = esp_timer_get_time();
     int ret = sendto(
-        sock, vec_u8->data, vec_u8->len, 0,
+        wifi_udp_tx_sock, vec_u8->data, vec_u8->len, 0,
         (struct sockaddr *)&addr,
         sizeof(addr)
     );
     if (ret < 0) {
         ESP_LOGE(TAG, "sendto() failed: errno %d", errno);
-        close(sock);
+        metrics_inc(METRIC_WIFI_UDP_TX_ERRORS);
+        close(wifi_udp_tx_sock);
+        wifi_udp_tx_sock = -1;
         return -errno;
     }
     // ESP_LOGI(TAG, "Sent %d bytes to %s:%d", ret, remote_ip, remote_port);
-    close(sock);
+    metrics_observe(METRIC_HIST_WIFI_UDP_TX_SEND_US, (uint32_t)(esp_timer_get_time() - start_us));
+    capture_record(CAPTURE_SRC_UDP_TX, vec_u8->data, ret);
+    metrics_inc(METRIC_WIFI_UDP_TX_DATAGRAMS);
+    metrics_add(METRIC_WIFI_UDP_TX_BYTES, ret);
     return ret;
 }
 
-float f32_test = 1;
-uint16_t u16_test = 1;
-void wifi_udp_write_task(void) {
-    VecU8 vec_u8 = vec_u8_new();
-    vec_u8_push(&vec_u8, CMD_RIGHT_ADC_STORE, sizeof(CMD_RIGHT_ADC_STORE));
-    vec_u8_push_u16(&vec_u8, u16_test);
-    u16_test++;
+/**
+ * @brief 開始一個批次封包並夾帶目前的確認狀態
+ *        Start a batched datagram piggybacking the current ack state
+ *
+ * @note 站台只接收可靠封包 (去除重複並確認)，自己送出的遙測、快照與確認都不需重送，故站台沒有重送視窗
+ *       The station only receives reliable datagrams (dedupe and ack); its own telemetry, snapshots
+ *       and acks are never worth resending, so the station keeps no retransmit window
+ *
+ * @param vec_u8 輸出封包 (output datagram)
+ * @return false 封包無法建立 (the datagram could not be started)
+ */
+bool wifi_udp_dgram_begin(VecU8 *vec_u8) {
+    WifiDgramHeader hdr = {0};
+    if (wifi_udp_rx_window.synced) {
+        hdr.flags   |= WIFI_DGRAM_FLAG_ACK;
+        hdr.ack      = wifi_udp_rx_window.ack;
+        hdr.ack_bits = wifi_udp_rx_window.ack_bits;
+    }
+    return wifi_dgram_begin(vec_u8, &hdr);
+}
+
+/**
+ * @brief 將完成的批次封包排入 UDP 傳輸緩衝區
+ *        Queue a finished datagram into the UDP transmit buffer
+ *
+ * @param trace 封包內最早一筆紀錄的追蹤時間戳，NULL 表示不追蹤 (trace of the oldest record, NULL when untraced)
+ * @return false 傳輸緩衝區已滿 (transmit buffer full)
+ */
+bool wifi_udp_dgram_submit(const VecU8 *vec_u8, const PktTrace *trace) {
+    ip4_addr_t ip;
+    ip.addr = inet_addr(TARGET_IP);
+    WifiPacket packet = wifi_packet_new(&ip, vec_u8);
+    packet.port = TARGET_PORT;
+    if (trace != NULL) packet.trace = *trace;
+    if (!wifi_trcv_buffer_push(&wifi_udp_transmit_buffer, &packet)) return 0;
+    dispatcher_post(DISPATCH_EV_UDP_TX);
+    return 1;
+}
+
+/**
+ * @brief 處理收到的封包標頭：檢查可靠序號是否重複
+ *        Apply a received header: check the reliable seq for duplicates
+ *
+ * @note 序號要等命令成功排入後由 wifi_udp_confirm_header 記錄，失敗時不確認，由對方重送
+ *       The seq is recorded by wifi_udp_confirm_header once the commands are queued; on failure it
+ *       stays unacked so the peer retransmits
+ *
+ * @param hdr 收到的封包標頭 (received datagram header)
+ * @return false 重複的可靠封包，內含命令不可再次執行 (duplicate reliable datagram, skip its commands)
+ */
+bool wifi_udp_accept_header(const WifiDgramHeader *hdr) {
+    if (!(hdr->flags & WIFI_DGRAM_FLAG_RELIABLE)) return 1;
+    if (wifi_dgram_rx_check(&wifi_udp_rx_window, hdr->seq) == WIFI_DGRAM_RX_DUPLICATE) {
+        metrics_inc(METRIC_WIFI_UDP_RX_DUPS);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief 記錄已完整處理的可靠序號，之後的確認會涵蓋它
+ *        Record a fully handled reliable seq so the following acks cover it
+ */
+void wifi_udp_confirm_header(const WifiDgramHeader *hdr) {
+    if (!(hdr->flags & WIFI_DGRAM_FLAG_RELIABLE)) return;
+    wifi_dgram_rx_accept(&wifi_udp_rx_window, hdr->seq);
+}
+
+/**
+ * @brief 立即回覆只含確認的封包，不經過聚合器
+ *        Reply with an ack-only datagram right away, bypassing the aggregator
+ *
+ * @param ip 發送者位址 (sender address)
+ * @param port 發送者的來源埠 (sender's source port)
+ */
+void wifi_udp_send_ack(const ip4_addr_t *ip, uint16_t port) {
+    VecU8 vec_u8;
+    if (!wifi_udp_dgram_begin(&vec_u8)) return;
+    wifi_udp_write(ip, port, &vec_u8);
+}
 
-    int sent = wifi_udp_write(TARGET_IP, UDP_PORT, &vec_u8);
+/**
+ * @brief 立即回覆遙測快照查詢，不經過聚合器也不需確認
+ *        Answer a telemetry snapshot query right away, unreliable and bypassing the aggregator
+ *
+ * @param ip 查詢者位址 (querier address)
+ * @param port 查詢者的來源埠 (querier's source port)
+ * @param payload 快照紀錄內容 (snapshot record payload)
+ * @param len 內容長度 (payload length)
+ */
+void wifi_udp_send_snapshot(const ip4_addr_t *ip, uint16_t port, const uint8_t *payload, uint8_t len) {
+    VecU8 vec_u8;
+    if (!wifi_udp_dgram_begin(&vec_u8)) return;
+    if (!wifi_dgram_push_record(&vec_u8, WIFI_DGRAM_REC_SNAPSHOT, payload, len)) return;
+    wifi_udp_write(ip, port, &vec_u8);
+}
+
+static void wifi_udp_send_packet(WifiPacket *packet) {
+    int sent = wifi_udp_write(&packet->ip, packet->port, &packet->data);
     if (sent < 0) {
         ESP_LOGE(TAG, "UDP send failed: %d", sent);
+        return;
+    }
+    pkt_trace_finish(&packet->trace, PKT_DIR_UART_TO_WIFI);
+}
+
+static WifiAggr wifi_udp_aggr;
+// 聚合中封包最早一筆紀錄的追蹤時間戳 (trace of the oldest record in the open aggregate)
+static PktTrace wifi_udp_aggr_trace;
+
+static WifiAggr *wifi_udp_aggr_get(void) {
+    if (wifi_udp_aggr.begin == NULL) {
+        wifi_aggr_init(&wifi_udp_aggr, wifi_udp_dgram_begin, WIFI_UDP_AGGR_DEADLINE_US);
+    }
+    return &wifi_udp_aggr;
+}
+
+/**
+ * @brief 將一筆遙測紀錄交給聚合器，封包滿了或到期才真正排入傳輸緩衝區
+ *        Hand a telemetry record to the aggregator; it reaches the transmit buffer when full or due
+ *
+ * @note 埠 0 以外的遙測以 REC_PORT_TELEMETRY 標上埠號 (telemetry from other ports is tagged with REC_PORT_TELEMETRY)
+ *
+ * @param port 來源 UART 埠 (source UART port)
+ * @param payload 遙測內容 (telemetry payload)
+ * @param len 內容長度 (payload length)
+ * @param trace 來源 UART 封包的追蹤時間戳 (trace of the source UART frame)
+ */
+void wifi_udp_telemetry_push(uint8_t port, const uint8_t *payload, uint8_t len, const PktTrace *trace) {
+    uint8_t type = WIFI_DGRAM_REC_TELEMETRY;
+    uint8_t tagged[UINT8_MAX];
+    if (port != 0) {
+        if (len > sizeof(tagged) - 1) {
+            metrics_inc(METRIC_WIFI_UDP_TELEMETRY_DROPS);
+            return;
+        }
+        tagged[0] = port;
+        memcpy(tagged + 1, payload, len);
+        type = WIFI_DGRAM_REC_PORT_TELEMETRY;
+        payload = tagged;
+        len++;
+    }
+    VecU8 vec_u8;
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    WifiAggr *aggr = wifi_udp_aggr_get();
+    bool was_open = aggr->open;
+    PktTrace open_trace = wifi_udp_aggr_trace;
+    bool flushed = wifi_aggr_push(aggr, type, payload, len, now_us, &vec_u8);
+    if (flushed) {
+        wifi_udp_dgram_submit(&vec_u8, &open_trace);
+    }
+    if (aggr->open && (flushed || !was_open)) {
+        wifi_udp_aggr_trace = *trace;
+        pkt_trace_stamp(&wifi_udp_aggr_trace, PKT_STAGE_TX_ENQUEUE);
+    }
+    if (wifi_aggr_poll(aggr, now_us, &vec_u8)) {
+        wifi_udp_dgram_submit(&vec_u8, &wifi_udp_aggr_trace);
     }
 }
+
+/**
+ * @brief UDP 傳輸處理：交出到期的聚合封包，再送出緩衝區內的批次封包
+ *        UDP transmit pass: close due aggregates, then flush queued batches
+ */
+void wifi_udp_write_task(void) {
+    VecU8 vec_u8;
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    if (wifi_aggr_poll(wifi_udp_aggr_get(), now_us, &vec_u8)) {
+        wifi_udp_dgram_submit(&vec_u8, &wifi_udp_aggr_trace);
+    }
+
+    WifiPacket packet;
+    while (wifi_trcv_buffer_pop(&wifi_udp_transmit_buffer, &packet)) {
+        wifi_udp_send_packet(&packet);
+    }
+}
+
+/**
+ * @brief 聚合器下一次到期前的剩餘時間，供呼叫端決定休眠長度
+ *        Time left before the aggregator must be polled, so callers can size their sleep
+ */
+uint32_t wifi_udp_aggr_time_left(void) {
+    return wifi_aggr_time_left(wifi_udp_aggr_get(), (uint32_t)esp_timer_get_time());
+}
+
+/**
+ * @brief 分派任務中解析收到的封包，並喚醒可能在等待槽位的接收任務
+ *        Parse received datagrams on the dispatcher and wake the receive task if it waits for a slot
+ */
+static void wifi_udp_dispatch_rx(EventBits_t events, void *arg) {
+    wifi_udp_receive_pkt_proc();
+    TaskHandle_t rx_task = task_layout_handle(TASK_ID_WIFI_UDP_RX);
+    if (rx_task != NULL) xTaskNotifyGive(rx_task);
+}
+
+/**
+ * @brief 分派任務的 UDP 傳輸期限：執行一次傳輸處理，回傳聚合封包的到期時間
+ *        UDP transmit deadline on the dispatcher: run one transmit pass, return the aggregate's deadline
+ */
+static uint32_t wifi_udp_dispatch_tx(uint32_t now_us, void *arg) {
+    wifi_udp_write_task();
+    // 傳輸處理可能開啟新的聚合封包，這裡重新取時間 (the pass may open a new aggregate, so re-read the clock)
+    now_us = (uint32_t)esp_timer_get_time();
+    return wifi_aggr_time_left(wifi_udp_aggr_get(), now_us);
+}
+
+/**
+ * @brief 聚合器、接收視窗與接收解析都只在分派任務中執行
+ *        The aggregator, receive window and receive parsing all run on the dispatcher task only
+ */
+void wifi_udp_setup(void) {
+    dispatcher_register(DISPATCH_EV_UDP_RX, wifi_udp_dispatch_rx, NULL);
+    dispatcher_register_deadline(wifi_udp_dispatch_tx, NULL);
+}
@@ -0,0 +1,454 @@
+#include "vec_mod.h"
+#include "uart/packet.h"
+#include "uart/packet_proc.h"
+#include "uart/deframe.h"
+#include "uart/command.h"
+#include "uart/link.h"
+#include "uart/flow.h"
+#include "wifi/packet.h"
+#include "wifi/datagram.h"
+#include "wifi/aggregator.h"
+#include "telemetry/cache.h"
+#include "telemetry/history.h"
+#include "mcu_const.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * 主機端微基準：每個案例先倍增迭代次數到至少 BENCH_MIN_NS，再以該次數量測並輸出 ns/op，
+ * 產生 UDP 封包的案例另輸出每個封包的操作數。標示 "+copy" 的案例每次迭代含一次 VecU8 複製，用來還原被修改的輸入。
+ * Host microbenchmarks: each case doubles its iteration count until a run takes at least
+ * BENCH_MIN_NS, then reports ns/op, plus ops per datagram for cases that emit datagrams.
+ * Cases marked "+copy" include one VecU8 copy per iteration to restore the input they modify.
+ */
+
+#define BENCH_MIN_NS        200000000ULL
+#define BENCH_START_ITERS   1024
+
+typedef void (*BenchFn)(uint32_t iters);
+
+typedef struct {
+    const char  *name;
+    BenchFn     fn;
+} BenchCase;
+
+static volatile uint32_t bench_sink;
+static VecU8 bench_payload;
+static VecU8 bench_frame;
+static UartPacket bench_packet;
+// 一次 UART 讀取含 BENCH_RX_FRAMES 個速度遙測封包 (one UART read carrying BENCH_RX_FRAMES speed telemetry frames)
+#define BENCH_RX_FRAMES     8
+static uint8_t bench_rx_read[BENCH_RX_FRAMES * 12];
+static uint16_t bench_rx_read_len;
+
+static uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_vec_push(uint32_t iters) {
+    static const uint8_t src[16] = {0};
+    VecU8 vec = vec_u8_new();
+    for (uint32_t i = 0; i < iters; i++) {
+        vec.head = 0;
+        vec.len  = 0;
+        vec_u8_push(&vec, src, sizeof(src));
+        bench_sink += vec.len;
+    }
+}
+
+static void bench_vec_rm_range_front(uint32_t iters) {
+    static const uint8_t src[3] = {1, 2, 3};
+    VecU8 vec = bench_payload;
+    for (uint32_t i = 0; i < iters; i++) {
+        vec_u8_rm_range(&vec, 0, sizeof(src));
+        vec_u8_push(&vec, src, sizeof(src));
+        bench_sink += vec.len;
+    }
+}
+
+static void bench_vec_rm_range_mid(uint32_t iters) {
+    for (uint32_t i = 0; i < iters; i++) {
+        VecU8 vec = bench_payload;
+        vec_u8_rm_range(&vec, 8, 4);
+        bench_sink += vec.len;
+    }
+}
+
+static void bench_vec_starts_with(uint32_t iters) {
+    for (uint32_t i = 0; i < iters; i++) {
+        bench_sink += vec_u8_starts_with(&bench_payload, CMD_RIGHT_SPEED_STORE, sizeof(CMD_RIGHT_SPEED_STORE));
+    }
+}
+
+static void bench_uart_pack(uint32_t iters) {
+    UartPacket packet = uart_packet_new();
+    for (uint32_t i = 0; i < iters; i++) {
+        VecU8 vec = bench_frame;
+        bench_sink += uart_pkt_pack(&packet, &vec);
+    }
+}
+
+static void bench_uart_unpack(uint32_t iters) {
+    VecU8 vec;
+    for (uint32_t i = 0; i < iters; i++) {
+        bench_sink += uart_pkt_unpack(&bench_packet, &vec);
+    }
+}
+
+static void bench_uart_ring(uint32_t iters) {
+    UartTrcvBuf buf = uart_trcv_buf_new();
+    UartPacket packet;
+    for (uint32_t i = 0; i < iters; i++) {
+        uart_trcv_buf_push(&buf, &bench_packet);
+        bench_sink += uart_trcv_buf_pop_front(&buf, &packet);
+    }
+}
+
+static void bench_wifi_ring(uint32_t iters) {
+    static WifiTrcvBuf buf;
+    buf = wifi_trcv_buffer_new();
+    ip4_addr_t ip = { .addr = 0 };
+    WifiPacket packet = wifi_packet_new(&ip, &bench_payload);
+    for (uint32_t i = 0; i < iters; i++) {
+        wifi_trcv_buffer_push(&buf, &packet);
+        bench_sink += wifi_trcv_buffer_pop(&buf, &packet);
+    }
+}
+
+static void bench_wifi_ring_zero_copy(uint32_t iters) {
+    static WifiTrcvBuf buf;
+    buf = wifi_trcv_buffer_new();
+    for (uint32_t i = 0; i < iters; i++) {
+        WifiPacket *slot = wifi_trcv_buffer_reserve(&buf);
+        slot->data.len = bench_payload.len;
+        wifi_trcv_buffer_commit(&buf);
+        bench_sink += wifi_trcv_buffer_front(&buf)->data.len;
+        wifi_trcv_buffer_pop(&buf, NULL);
+    }
+}
+
+static void bench_uart_receive_proc(uint32_t iters) {
+    UartPacket packet = uart_packet_new();
+    VecU8 datas = vec_u8_new();
+    vec_u8_push_byte(&datas, CMD_CODE_DATA_TRRE);
+    vec_u8_push(&datas, CMD_RIGHT_SPEED_STORE, sizeof(CMD_RIGHT_SPEED_STORE));
+    vec_u8_push_f32(&datas, 1.5f);
+    uart_pkt_add_data(&packet, &datas);
+    for (uint32_t i = 0; i < iters; i++) {
+        uart_trcv_buf_push(&uart_links[UART_LINK_PRIMARY].rx_buf, &packet);
+        uart_receive_pkt_proc(&uart_links[UART_LINK_PRIMARY], 1);
+    }
+}
+
+static void bench_uart_rx_read(UartLink *link, uint32_t iters) {
+    UartDeframer deframer = UART_DEFRAMER_INIT;
+    UartDeframeEvent event;
+    UartPacket packet;
+    for (uint32_t i = 0; i < iters; i++) {
+        uint16_t offset = 0;
+        uint8_t queued = 0;
+        while (uart_deframe_next(&deframer, bench_rx_read, bench_rx_read_len, &offset, &event, &packet)) {
+            if (event == UART_DEFRAME_FRAME && uart_trcv_buf_push(&link->rx_buf, &packet)) queued++;
+        }
+        uart_receive_pkt_proc(link, queued);
+        bench_sink += queued;
+    }
+}
+
+static void bench_uart_rx_read_primary(uint32_t iters) {
+    bench_uart_rx_read(&uart_links[UART_LINK_PRIMARY], iters);
+}
+
+static void bench_uart_rx_read_secondary(uint32_t iters) {
+    bench_uart_rx_read(&uart_links[UART_LINK_COUNT - 1], iters);
+}
+
+// 一筆速度遙測紀錄，與 UART 回報相同 (one speed telemetry record, as relayed from the UART)
+static const uint8_t bench_telemetry_rec[] = {CMD_CODE_DATA_TRRE, CMD_CODE_MOTOR_RIGHT, CMD_CODE_SPEED, 0x3F, 0xC0, 0x00, 0x00};
+static uint32_t bench_dgrams;
+
+static bool bench_dgram_begin(VecU8 *vec_u8) {
+    WifiDgramHeader hdr = {0};
+    return wifi_dgram_begin(vec_u8, &hdr);
+}
+
+static void bench_dgram_parse(const VecU8 *vec_u8) {
+    WifiDgramHeader hdr;
+    WifiDgramRecord rec;
+    uint16_t offset = 0;
+    bench_dgrams++;
+    if (!wifi_dgram_parse_header(vec_u8->data, vec_u8->len, &hdr)) return;
+    while (wifi_dgram_next_record(vec_u8->data, vec_u8->len, &offset, &rec)) bench_sink += rec.len;
+}
+
+// 每筆紀錄各自一個封包，即未聚合時的封包率 (one datagram per record, the unbatched datagram rate)
+static void bench_dgram_single(uint32_t iters) {
+    VecU8 vec_u8;
+    for (uint32_t i = 0; i < iters; i++) {
+        bench_dgram_begin(&vec_u8);
+        wifi_dgram_push_record(&vec_u8, WIFI_DGRAM_REC_TELEMETRY, bench_telemetry_rec, sizeof(bench_telemetry_rec));
+        bench_dgram_parse(&vec_u8);
+    }
+}
+
+static void bench_dgram_aggregated(uint32_t iters) {
+    WifiAggr aggr;
+    VecU8 vec_u8;
+    wifi_aggr_init(&aggr, bench_dgram_begin, WIFI_AGGR_DEFAULT_DEADLINE_US);
+    for (uint32_t i = 0; i < iters; i++) {
+        // 每 10 us 一筆，高負載下封包因填滿而送出 (one record every 10 us, datagrams close when full)
+        if (wifi_aggr_push(&aggr, WIFI_DGRAM_REC_TELEMETRY, bench_telemetry_rec, sizeof(bench_telemetry_rec), i * 10, &vec_u8)) {
+            bench_dgram_parse(&vec_u8);
+        }
+        if (wifi_aggr_poll(&aggr, i * 10, &vec_u8)) bench_dgram_parse(&vec_u8);
+    }
+    if (wifi_aggr_flush(&aggr, &vec_u8)) bench_dgram_parse(&vec_u8);
+}
+
+static void bench_telemetry_cache_read(uint32_t iters) {
+    TelemetryCacheEntry entry;
+    for (uint32_t i = 0; i < iters; i++) {
+        bench_sink += telemetry_cache_read(TELEMETRY_CH_RIGHT_SPEED, TELEMETRY_CACHE_DEFAULT_MAX_AGE_US, &entry);
+    }
+}
+
+static void bench_telemetry_cache_encode(uint32_t iters) {
+    uint8_t out[TELEMETRY_CACHE_ENTRY_WIRE_SIZE * TELEMETRY_CH_COUNT];
+    for (uint32_t i = 0; i < iters; i++) {
+        bench_sink += telemetry_cache_encode(0, TELEMETRY_CACHE_DEFAULT_MAX_AGE_US, out, sizeof(out));
+    }
+}
+
+static void bench_telemetry_history_append(uint32_t iters) {
+    TelemetrySample sample = { .channel = TELEMETRY_CH_LEFT_ADC };
+    for (uint32_t i = 0; i < iters; i++) {
+        sample.value = (float)i;
+        telemetry_publish(&sample);
+    }
+}
+
+static void bench_telemetry_history_scan(uint32_t iters) {
+    uint32_t t_us[64];
+    float value[64];
+    for (uint32_t i = 0; i < iters; i++) {
+        TelemetryDecimator decimator = telemetry_decimator_new(1000);
+        uint32_t cursor = telemetry_history_oldest(TELEMETRY_CH_LEFT_ADC);
+        uint16_t count;
+        uint32_t out_t_us;
+        float out_value;
+        while ((count = telemetry_history_read(TELEMETRY_CH_LEFT_ADC, &cursor, t_us, value, 64)) > 0) {
+            for (uint16_t j = 0; j < count; j++) {
+                bench_sink += telemetry_decimator_push(&decimator, t_us[j], value[j], &out_t_us, &out_value);
+            }
+        }
+    }
+}
+
+static void bench_uart_cmd_slots(uint32_t iters) {
+    UartLink *link = &uart_links[UART_LINK_PRIMARY];
+    UartCmdBatch batch;
+    UartCmdSlotSet taken;
+    UartPacket frame;
+    for (uint32_t i = 0; i < iters; i++) {
+        uart_cmd_batch_init(&batch, link);
+        uart_cmd_batch_add(&batch, CMD_CODE_VECH_CONTROL, CMD_MOVE_FORWARD + 1, 1);
+        uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, CMD_LEFT_SPEED_START, 3);
+        uart_cmd_batch_commit(&batch);
+        while (uart_cmd_slots_take(&link->slots, &taken, &frame)) bench_sink += frame.datas.len;
+    }
+}
+
+static const BenchCase bench_cases[] = {
+    { "vec_u8_push 16B",                bench_vec_push },
+    { "vec_u8_rm_range front+push",     bench_vec_rm_range_front },
+    { "vec_u8_rm_range mid+copy",       bench_vec_rm_range_mid },
+    { "vec_u8_starts_with",             bench_vec_starts_with },
+    { "uart_pkt_pack+copy",             bench_uart_pack },
+    { "uart_pkt_unpack",                bench_uart_unpack },
+    { "uart ring push/pop",             bench_uart_ring },
+    { "wifi ring push/pop",             bench_wifi_ring },
+    { "wifi ring reserve/commit/pop",   bench_wifi_ring_zero_copy },
+    { "uart_receive_pkt_proc telemetry", bench_uart_receive_proc },
+    { "uart rx read 8 frames port 0",   bench_uart_rx_read_primary },
+    { "uart rx read 8 frames last port", bench_uart_rx_read_secondary },
+    { "dgram 1 record/datagram",        bench_dgram_single },
+    { "dgram aggregated",               bench_dgram_aggregated },
+    { "telemetry_cache_read",           bench_telemetry_cache_read },
+    { "telemetry_cache_encode all",     bench_telemetry_cache_encode },
+    { "telemetry publish cache+history", bench_telemetry_history_append },
+    { "history scan+decimate full ring", bench_telemetry_history_scan },
+    { "uart cmd slots commit+take",     bench_uart_cmd_slots },
+};
+
+// ----------------------------------------------------------------------------------------------------
+
+/**
+ * 緊急停止延遲模擬：以真實的信用/槽位/FIFO 選擇邏輯驅動 uart_write_task 的順序，
+ * 線路與 128 位元組硬體 FIFO 以模擬時鐘計時 (驅動沒有 TX 環形緩衝區，寫入在資料進入 FIFO 後返回)。
+ * FIFO 保持全滿、每送出一個 FIFO 封包就補上行進與模式命令，遙測以線路速率到達使信用持續到期，
+ * 停止請求隨機落在寫入期間。
+ * E-stop latency simulation: the real credit/slot/FIFO selection drives the uart_write_task order
+ * while the wire and the 128-byte hardware FIFO run on a simulated clock (the driver has no TX
+ * ring, so a write returns once its bytes are in the FIFO). The FIFO is kept full, new motion
+ * and mode commands arrive with every FIFO frame sent, telemetry arrives at line rate so credits
+ * keep falling due, and stop requests land at random points of a write.
+ */
+#define BENCH_ESTOP_TRIALS      20000
+#define BENCH_UART_HW_FIFO      128
+#define BENCH_ESTOP_GAP_MAX_US  5000.0
+
+typedef struct {
+    double  fifo_max_us;    // 請求到進入硬體 FIFO (station_uart_estop_max_us 量測的點) (request to FIFO entry, where the station measures)
+    double  wire_max_us;    // 請求到最後一個位元組離開線路 (request to the last byte on the wire)
+    double  wire_sum_us;
+} BenchEstopResult;
+
+static uint32_t bench_rand_state = 1;
+
+static double bench_rand_unit(void) {
+    bench_rand_state = bench_rand_state * 1664525U + 1013904223U;
+    return (double)(bench_rand_state >> 8) / (double)(1U << 24);
+}
+
+static void bench_estop_refill(UartLink *link, uint8_t fifo_data_len, bool slots) {
+    uint8_t data[PACKET_DATA_MAX_SIZE];
+    memset(data, 0x01, sizeof(data));
+    data[0] = CMD_CODE_DATA_TRRE;
+    while (link->tx_buf.len < UART_TRCV_BUF_CAP) {
+        VecU8 datas = vec_u8_new();
+        vec_u8_push(&datas, data, fifo_data_len);
+        UartPacket packet = uart_packet_new();
+        uart_pkt_add_data(&packet, &datas);
+        uart_trcv_buf_push(&link->tx_buf, &packet);
+    }
+    if (!slots) return;
+    UartCmdBatch batch;
+    uart_cmd_batch_init(&batch, link);
+    uart_cmd_batch_add(&batch, CMD_CODE_VECH_CONTROL, CMD_MOVE_FORWARD + 1, 1);
+    uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_START, 3);
+    uart_cmd_batch_commit(&batch);
+}
+
+static BenchEstopResult bench_estop_sim(uint32_t baud, uint8_t fifo_data_len) {
+    BenchEstopResult result = {0};
+    UartLink *link = &uart_links[UART_LINK_PRIMARY];
+    uart_links_init();
+    uart_flow_init(&link->flow, UART_TRCV_BUF_CAP, 200000, 50000);
+    double byte_us = 10.0 * 1000000.0 / baud;
+    // STM32 以線路速率回報 9 位元組的速度遙測 (the STM32 reports 9-byte speed telemetry at line rate)
+    double rx_frame_us = 9 * byte_us;
+    double rx_next_us = rx_frame_us;
+    double now_us = 0, wire_end_us = 0;
+    double request_us = bench_rand_unit() * BENCH_ESTOP_GAP_MAX_US;
+    bool requested = false;
+    uint32_t trials = 0;
+    bool fifo_sent = true;
+    while (trials < BENCH_ESTOP_TRIALS) {
+        // 每送出一個 FIFO 封包就有新的行進與模式命令，槽位不會把 FIFO 餓死
+        // New motion and mode commands arrive with every FIFO frame sent, so the slots never starve the FIFO
+        bench_estop_refill(link, fifo_data_len, fifo_sent);
+        fifo_sent = false;
+        // 每收到一個回報就有新的信用要宣告 (every report received makes a credit due)
+        while (rx_next_us <= now_us) {
+            uart_flow_consumed(&link->flow, 1);
+            rx_next_us += rx_frame_us;
+        }
+        if (!requested && request_us <= now_us) {
+            uart_cmd_slots_estop(&link->slots, NULL);
+            requested = true;
+        }
+        UartCmdSlotSet taken = {0};
+        UartPacket packet;
+        if (!uart_flow_credit_due(&link->flow, (uint32_t)now_us, &packet)) {
+            if (!uart_cmd_slots_take(&link->slots, &taken, &packet)) {
+                fifo_sent = uart_trcv_buf_pop_front(&link->tx_buf, &packet);
+            }
+        }
+        double frame_us = (packet.datas.len + 2) * byte_us;
+        wire_end_us = (wire_end_us > now_us ? wire_end_us : now_us) + frame_us;
+        double fifo_us = wire_end_us - BENCH_UART_HW_FIFO * byte_us;
+        now_us = fifo_us > now_us ? fifo_us : now_us;
+        if (taken.pending & (1U << UART_CMD_SLOT_ESTOP)) {
+            double fifo_latency = now_us - request_us;
+            double wire_latency = wire_end_us - request_us;
+            if (fifo_latency > result.fifo_max_us) result.fifo_max_us = fifo_latency;
+            if (wire_latency > result.wire_max_us) result.wire_max_us = wire_latency;
+            result.wire_sum_us += wire_latency;
+            trials++;
+            requested = false;
+            request_us = now_us + bench_rand_unit() * BENCH_ESTOP_GAP_MAX_US;
+        }
+    }
+    return result;
+}
+
+static void bench_estop_report(void) {
+    static const uint32_t bauds[] = {115200, 1000000};
+    static const uint8_t fifo_lens[] = {4, PACKET_DATA_MAX_SIZE};
+    printf("\n%-34s %12s %12s %12s\n", "estop latency (simulated)", "fifo max us", "wire max us", "wire avg us");
+    for (size_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        for (size_t j = 0; j < sizeof(fifo_lens) / sizeof(fifo_lens[0]); j++) {
+            BenchEstopResult r = bench_estop_sim(bauds[i], fifo_lens[j]);
+            char name[40];
+            snprintf(name, sizeof(name), "%lu baud, %u B FIFO frames", (unsigned long)bauds[i], fifo_lens[j] + 2);
+            printf("%-34s %12.0f %12.0f %12.0f\n", name, r.fifo_max_us, r.wire_max_us, r.wire_sum_us / BENCH_ESTOP_TRIALS);
+        }
+    }
+}
+
+static void bench_setup(void) {
+    telemetry_cache_setup();
+    telemetry_history_setup();
+    uart_links_init();
+    bench_payload = vec_u8_new();
+    for (uint8_t i = 0; i < 64; i++) vec_u8_push_byte(&bench_payload, i);
+    // 讓資料跨越環形邊界，rm_range 才會走 realign 路徑 (wrap the ring so rm_range has to realign)
+    bench_payload.head = VECU8_MAX_CAPACITY - 16;
+    memcpy(bench_payload.data + bench_payload.head, bench_payload.data, 16);
+
+    bench_frame = vec_u8_new();
+    vec_u8_push_byte(&bench_frame, PACKET_START_CODE);
+    for (uint8_t i = 0; i < 32; i++) vec_u8_push_byte(&bench_frame, i);
+    vec_u8_push_byte(&bench_frame, PACKET_END_CODE);
+
+    for (uint8_t i = 0; i < BENCH_RX_FRAMES; i++) {
+        uint8_t *frame = bench_rx_read + bench_rx_read_len;
+        frame[0] = PACKET_START_CODE;
+        frame[1] = CMD_CODE_DATA_TRRE;
+        memcpy(frame + 2, CMD_RIGHT_SPEED_STORE, sizeof(CMD_RIGHT_SPEED_STORE));
+        memset(frame + 2 + sizeof(CMD_RIGHT_SPEED_STORE), 0x3F, 4);
+        frame[6 + sizeof(CMD_RIGHT_SPEED_STORE)] = PACKET_END_CODE;
+        bench_rx_read_len += 7 + sizeof(CMD_RIGHT_SPEED_STORE);
+    }
+
+    VecU8 vec = bench_frame;
+    bench_packet = uart_packet_new();
+    uart_pkt_pack(&bench_packet, &vec);
+}
+
+int main(void) {
+    bench_setup();
+    printf("%-34s %12s %12s %10s\n", "case", "iters", "ns/op", "op/dgram");
+    for (size_t i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+        const BenchCase *bench = &bench_cases[i];
+        uint32_t iters = BENCH_START_ITERS;
+        uint64_t elapsed = 0;
+        while (1) {
+            bench_dgrams = 0;
+            uint64_t start = bench_now_ns();
+            bench->fn(iters);
+            elapsed = bench_now_ns() - start;
+            if (elapsed >= BENCH_MIN_NS || iters >= (1U << 30)) break;
+            iters *= 2;
+        }
+        printf("%-34s %12lu %12.2f", bench->name, (unsigned long)iters, (double)elapsed / iters);
+        // 產生 UDP 封包的案例另列每個封包承載的操作數 (cases that emit datagrams also show ops carried per datagram)
+        if (bench_dgrams != 0) printf(" %10.1f", (double)iters / bench_dgrams);
+        printf("\n");
+    }
+    bench_estop_report();
+    return 0;
+}
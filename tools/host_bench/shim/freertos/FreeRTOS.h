@@ -0,0 +1,18 @@
+#ifndef HOST_SHIM_FREERTOS_H
+#define HOST_SHIM_FREERTOS_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+// ----------------------------------------------------------------------------------------------------
+
+/**
+ * 主機端單執行緒量測用：臨界區段為空操作，只有一個「核心」
+ * Single-threaded host build: critical sections are no-ops and there is a single "core"
+ */
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define taskENTER_CRITICAL(mux)         ((void)(mux))
+#define taskEXIT_CRITICAL(mux)          ((void)(mux))
+#define portNUM_PROCESSORS              1
+#define xPortGetCoreID()                0
+
+#endif
@@ -0,0 +1,16 @@
+#include "uart/transceive.h"
+#include "wifi/udp_transceive.h"
+
+/**
+ * 主機端替身：韌體中由 UART/UDP 傳輸模組提供的符號
+ * Host stand-ins for symbols the UART and UDP transport modules provide on the device
+ */
+uint32_t host_shim_telemetry_records = 0;
+
+void wifi_udp_telemetry_push(uint8_t port, const uint8_t *payload, uint8_t len, const PktTrace *trace) {
+    (void)port;
+    (void)payload;
+    (void)len;
+    (void)trace;
+    host_shim_telemetry_records++;
+}
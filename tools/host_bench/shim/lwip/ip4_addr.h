@@ -0,0 +1,11 @@
+#ifndef HOST_SHIM_LWIP_IP4_ADDR_H
+#define HOST_SHIM_LWIP_IP4_ADDR_H
+// ----------------------------------------------------------------------------------------------------
+#include <stdint.h>
+// ----------------------------------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t    addr;
+} ip4_addr_t;
+
+#endif
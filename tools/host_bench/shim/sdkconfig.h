@@ -0,0 +1,9 @@
+#ifndef HOST_SHIM_SDKCONFIG_H
+#define HOST_SHIM_SDKCONFIG_H
+
+// 主機建置只需要純模組用到的選項 (only the options the pure modules read)
+#define CONFIG_STATION_TELEMETRY_MAX_AGE_MS 200
+#define CONFIG_STATION_TELEMETRY_HISTORY_LEN 512
+#define CONFIG_STATION_UART_PORT_COUNT 2
+
+#endif
@@ -0,0 +1,965 @@
+#include "vec_mod.h"
+#include "uart/packet.h"
+#include "uart/packet_proc.h"
+#include "uart/deframe.h"
+#include "uart/link.h"
+#include "uart/command.h"
+#include "uart/cmd_slots.h"
+#include "uart/flow.h"
+#include "telemetry/sample.h"
+#include "telemetry/history.h"
+#include "wifi/datagram.h"
+#include "wifi/aggregator.h"
+#include "metrics.h"
+#include "mcu_const.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * 主機端單元測試：每個案例以 TEST_CHECK 斷言，任何失敗都讓程式以非 0 結束 (由 ctest 執行)。
+ * Host unit tests: every case asserts with TEST_CHECK and any failure makes the program exit
+ * non-zero (run by ctest).
+ */
+
+typedef void (*TestFn)(void);
+
+typedef struct {
+    const char  *name;
+    TestFn      fn;
+} TestCase;
+
+static uint32_t test_failures = 0;
+
+#define TEST_CHECK(cond) do {                                               \
+    if (!(cond)) {                                                          \
+        test_failures++;                                                    \
+        printf("  %s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);   \
+    }                                                                       \
+} while (0)
+
+static VecU8 test_vec(const uint8_t *bytes, uint16_t len) {
+    VecU8 vec = vec_u8_new();
+    vec_u8_push(&vec, bytes, len);
+    return vec;
+}
+
+static bool test_vec_equals(const VecU8 *vec, const uint8_t *bytes, uint16_t len) {
+    if (vec->len != len) return 0;
+    for (uint16_t i = 0; i < len; i++) {
+        uint8_t byte;
+        if (!vec_u8_get_byte(vec, &byte, i) || byte != bytes[i]) return 0;
+    }
+    return 1;
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void test_vec_push_capacity(void) {
+    VecU8 vec = vec_u8_new();
+    uint8_t fill[VECU8_MAX_CAPACITY] = {0};
+    TEST_CHECK(vec_u8_push(&vec, fill, VECU8_MAX_CAPACITY - 1));
+    TEST_CHECK(vec_u8_push_byte(&vec, 0xAB));
+    TEST_CHECK(vec.len == VECU8_MAX_CAPACITY);
+    TEST_CHECK(!vec_u8_push_byte(&vec, 0xCD));
+    TEST_CHECK(vec.len == VECU8_MAX_CAPACITY);
+    uint8_t last;
+    TEST_CHECK(vec_u8_get_byte(&vec, &last, VECU8_MAX_CAPACITY - 1) && last == 0xAB);
+    TEST_CHECK(!vec_u8_get_byte(&vec, &last, VECU8_MAX_CAPACITY));
+}
+
+static void test_vec_big_endian(void) {
+    VecU8 vec = vec_u8_new();
+    vec_u8_push_u16(&vec, 0x1234);
+    vec_u8_push_u32(&vec, 0xA1B2C3D4);
+    vec_u8_push_f32(&vec, 1.5f);
+    static const uint8_t expect[] = { 0x12, 0x34, 0xA1, 0xB2, 0xC3, 0xD4, 0x3F, 0xC0, 0x00, 0x00 };
+    TEST_CHECK(test_vec_equals(&vec, expect, sizeof(expect)));
+}
+
+static void test_vec_wrap(void) {
+    // 資料跨越環形邊界時的讀取、比對與 realign (reads, prefix checks and realign across the ring edge)
+    VecU8 vec = vec_u8_new();
+    vec.head = VECU8_MAX_CAPACITY - 3;
+    for (uint8_t i = 0; i < 6; i++) vec.data[(vec.head + i) % VECU8_MAX_CAPACITY] = i;
+    vec.len = 6;
+    static const uint8_t expect[] = { 0, 1, 2, 3, 4, 5 };
+    TEST_CHECK(test_vec_equals(&vec, expect, sizeof(expect)));
+    TEST_CHECK(vec_u8_starts_with(&vec, expect, 5));
+    TEST_CHECK(!vec_u8_starts_with(&vec, (const uint8_t[]){ 0, 1, 2, 9 }, 4));
+    vec_u8_realign(&vec);
+    TEST_CHECK(vec.head == 0);
+    TEST_CHECK(memcmp(vec.data, expect, sizeof(expect)) == 0);
+}
+
+static void test_vec_rm_range(void) {
+    static const uint8_t bytes[] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    VecU8 vec = test_vec(bytes, sizeof(bytes));
+    TEST_CHECK(vec_u8_rm_range(&vec, 0, 2));
+    TEST_CHECK(test_vec_equals(&vec, (const uint8_t[]){ 2, 3, 4, 5, 6, 7 }, 6));
+    TEST_CHECK(vec_u8_rm_range(&vec, 2, 2));
+    TEST_CHECK(test_vec_equals(&vec, (const uint8_t[]){ 2, 3, 6, 7 }, 4));
+    TEST_CHECK(vec_u8_rm_range(&vec, 3, 10));
+    TEST_CHECK(test_vec_equals(&vec, (const uint8_t[]){ 2, 3, 6 }, 3));
+    TEST_CHECK(!vec_u8_rm_range(&vec, 3, 1));
+    TEST_CHECK(vec_u8_rm_range(&vec, 0, 3));
+    TEST_CHECK(vec.len == 0);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static UartPacket test_uart_packet(uint8_t tag) {
+    UartPacket packet = uart_packet_new();
+    VecU8 datas = test_vec(&tag, 1);
+    uart_pkt_add_data(&packet, &datas);
+    return packet;
+}
+
+static uint8_t test_uart_packet_tag(const UartPacket *packet) {
+    uint8_t tag = 0xFF;
+    vec_u8_get_byte(&packet->datas, &tag, 0);
+    return tag;
+}
+
+static void test_uart_ring_order_wrap(void) {
+    UartTrcvBuf buf = uart_trcv_buf_new();
+    UartPacket packet;
+    uint8_t next_in = 0;
+    uint8_t next_out = 0;
+    // 反覆推入/彈出讓 head 繞過陣列尾端多次 (push and pop repeatedly so head wraps several times)
+    for (uint8_t round = 0; round < 4 * UART_TRCV_BUF_CAP; round++) {
+        packet = test_uart_packet(next_in++);
+        TEST_CHECK(uart_trcv_buf_push(&buf, &packet));
+        if (round % 3 == 2) {
+            packet = test_uart_packet(next_in++);
+            TEST_CHECK(uart_trcv_buf_push(&buf, &packet));
+        }
+        while (buf.len > 1) {
+            TEST_CHECK(uart_trcv_buf_pop_front(&buf, &packet));
+            TEST_CHECK(test_uart_packet_tag(&packet) == next_out);
+            next_out++;
+        }
+    }
+    TEST_CHECK(uart_trcv_buf_get_front(&buf, &packet) && test_uart_packet_tag(&packet) == next_out);
+    TEST_CHECK(uart_trcv_buf_pop_front(&buf, NULL));
+    TEST_CHECK(!uart_trcv_buf_pop_front(&buf, &packet));
+    TEST_CHECK(buf.drops == 0);
+}
+
+static void test_uart_ring_full(void) {
+    UartTrcvBuf buf = uart_trcv_buf_new();
+    UartPacket batch[UART_TRCV_BUF_CAP];
+    for (uint8_t i = 0; i < UART_TRCV_BUF_CAP; i++) batch[i] = test_uart_packet(i);
+    TEST_CHECK(uart_trcv_buf_push_all(&buf, batch, 2));
+    // 放不下整批時一個都不推入 (all or nothing when the batch does not fit)
+    TEST_CHECK(!uart_trcv_buf_push_all(&buf, batch, UART_TRCV_BUF_CAP - 1));
+    TEST_CHECK(buf.len == 2);
+    TEST_CHECK(buf.drops == UART_TRCV_BUF_CAP - 1);
+    TEST_CHECK(uart_trcv_buf_push_all(&buf, batch, UART_TRCV_BUF_CAP - 2));
+    TEST_CHECK(!uart_trcv_buf_push(&buf, &batch[0]));
+    TEST_CHECK(buf.len == UART_TRCV_BUF_CAP);
+    TEST_CHECK(buf.high_water == UART_TRCV_BUF_CAP);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void test_uart_pkt_round_trip(void) {
+    static const uint8_t frame[] = { '{', 0x10, 0x01, 0x00, 0x02, '}' };
+    VecU8 raw = test_vec(frame, sizeof(frame));
+    UartPacket packet = uart_packet_new();
+    TEST_CHECK(uart_pkt_pack(&packet, &raw));
+    VecU8 datas = vec_u8_new();
+    TEST_CHECK(uart_pkt_get_data(&packet, &datas));
+    TEST_CHECK(test_vec_equals(&datas, frame + 1, sizeof(frame) - 2));
+    VecU8 out = vec_u8_new();
+    TEST_CHECK(uart_pkt_unpack(&packet, &out));
+    TEST_CHECK(test_vec_equals(&out, frame, sizeof(frame)));
+}
+
+static void test_uart_pkt_bad_frames(void) {
+    UartPacket packet = uart_packet_new();
+    VecU8 raw = test_vec((const uint8_t[]){ 0x10, 0x01, '}' }, 3);
+    TEST_CHECK(!uart_pkt_pack(&packet, &raw));
+    raw = test_vec((const uint8_t[]){ '{', 0x10, 0x01 }, 3);
+    TEST_CHECK(!uart_pkt_pack(&packet, &raw));
+    raw = vec_u8_new();
+    TEST_CHECK(!uart_pkt_pack(&packet, &raw));
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+#define TEST_DEFRAME_MAX    8
+
+typedef struct {
+    UartDeframeEvent    events[TEST_DEFRAME_MAX];
+    uint8_t             first[TEST_DEFRAME_MAX];    // 封包第一個資料位元組 (first data byte of each frame)
+    uint8_t             lens[TEST_DEFRAME_MAX];
+    uint8_t             count;
+} TestDeframed;
+
+static void test_deframe_feed(UartDeframer *deframer, const uint8_t *data, uint16_t len, TestDeframed *out) {
+    uint16_t offset = 0;
+    UartDeframeEvent event;
+    UartPacket packet;
+    while (uart_deframe_next(deframer, data, len, &offset, &event, &packet) && out->count < TEST_DEFRAME_MAX) {
+        out->events[out->count] = event;
+        out->first[out->count] = 0;
+        out->lens[out->count] = event == UART_DEFRAME_FRAME ? packet.datas.len : 0;
+        if (event == UART_DEFRAME_FRAME) vec_u8_get_byte(&packet.datas, &out->first[out->count], 0);
+        out->count++;
+    }
+}
+
+// 線路靜默：結束停在讀取結尾 `}` 上的封包 (the line went quiet: close a frame left open on a trailing `}`)
+static void test_deframe_idle(UartDeframer *deframer, TestDeframed *out) {
+    UartDeframeEvent event;
+    UartPacket packet;
+    if (!uart_deframe_flush(deframer, &event, &packet) || out->count >= TEST_DEFRAME_MAX) return;
+    out->events[out->count] = event;
+    out->first[out->count] = 0;
+    out->lens[out->count] = event == UART_DEFRAME_FRAME ? packet.datas.len : 0;
+    if (event == UART_DEFRAME_FRAME) vec_u8_get_byte(&packet.datas, &out->first[out->count], 0);
+    out->count++;
+}
+
+static void test_deframe_burst(void) {
+    // 一次讀取含信用封包、一筆回報與一筆模式回應 (one read carrying a credit frame, a report and a mode echo)
+    static const uint8_t data[] = { '{', 0x30, 5, 1, '}', '{', 0x10, 0x01, 0x05, 0x00, 0x7D, '}', '{', 0x10, 0x01, 0x00, 0x02, '}' };
+    UartDeframer deframer = UART_DEFRAMER_INIT;
+    TestDeframed out = {0};
+    test_deframe_feed(&deframer, data, sizeof(data), &out);
+    // 模式回應的 `}` 無法依格式判斷，等到線路靜默 (the echo's `}` is undecided until the line goes quiet)
+    TEST_CHECK(out.count == 2);
+    test_deframe_idle(&deframer, &out);
+    TEST_CHECK(out.count == 3);
+    TEST_CHECK(out.events[0] == UART_DEFRAME_FRAME && out.first[0] == 0x30 && out.lens[0] == 3);
+    // 內容中的 0x7D 後面不是 `{`，不算結尾 (the 0x7D inside the payload is not followed by `{`, no end)
+    TEST_CHECK(out.events[1] == UART_DEFRAME_FRAME && out.first[1] == 0x10 && out.lens[1] == 5);
+    TEST_CHECK(out.events[2] == UART_DEFRAME_FRAME && out.lens[2] == 4);
+}
+
+static void test_deframe_split(void) {
+    // 封包跨兩次讀取 (a frame spanning two reads)
+    static const uint8_t part1[] = { '{', 0x10, 0x00, 0x00 };
+    static const uint8_t part2[] = { 0x3F, 0xC0, 0x00, 0x00, '}', '{', 0x20 };
+    static const uint8_t part3[] = { 0x01, '}' };
+    UartDeframer deframer = UART_DEFRAMER_INIT;
+    TestDeframed out = {0};
+    test_deframe_feed(&deframer, part1, sizeof(part1), &out);
+    TEST_CHECK(out.count == 0);
+    test_deframe_feed(&deframer, part2, sizeof(part2), &out);
+    TEST_CHECK(out.count == 1 && out.events[0] == UART_DEFRAME_FRAME && out.lens[0] == 7);
+    test_deframe_feed(&deframer, part3, sizeof(part3), &out);
+    TEST_CHECK(out.count == 1);
+    test_deframe_idle(&deframer, &out);
+    TEST_CHECK(out.count == 2 && out.events[1] == UART_DEFRAME_FRAME && out.first[1] == 0x20);
+}
+
+static void test_deframe_embedded_end(void) {
+    UartDeframer deframer = UART_DEFRAMER_INIT;
+    TestDeframed out = {0};
+    // 讀取在數值中的 0x7D 後切開，不是結尾 (a read split right after a 0x7D inside a value is no end)
+    static const uint8_t part1[] = { '{', 0x10, 0x01, 0x00, 0x42, 0x7D };
+    static const uint8_t part2[] = { 0x00, 0x00, '}', '{', 0x30, 5, 1, '}' };
+    test_deframe_feed(&deframer, part1, sizeof(part1), &out);
+    TEST_CHECK(out.count == 0);
+    test_deframe_feed(&deframer, part2, sizeof(part2), &out);
+    TEST_CHECK(out.count == 2 && out.events[0] == UART_DEFRAME_FRAME && out.lens[0] == 7);
+    TEST_CHECK(out.events[1] == UART_DEFRAME_FRAME && out.first[1] == 0x30);
+    // 數值中的 `}{` 也不是結尾 (nor is a `}{` inside a value)
+    out.count = 0;
+    static const uint8_t brace_pair[] = { '{', 0x10, 0x00, 0x05, 0x7D, 0x7B, '}' };
+    test_deframe_feed(&deframer, brace_pair, sizeof(brace_pair), &out);
+    TEST_CHECK(out.count == 1 && out.events[0] == UART_DEFRAME_FRAME && out.lens[0] == 5);
+    // 未知格式：讀取結尾的 `}` 後面不是 `{`，仍是資料 (unknown layout: a trailing `}` followed by no `{` is data)
+    out.count = 0;
+    static const uint8_t unknown1[] = { '{', 0x20, 0x7D };
+    static const uint8_t unknown2[] = { 0x01, '}', '{', 0x20, 0x02, '}' };
+    test_deframe_feed(&deframer, unknown1, sizeof(unknown1), &out);
+    TEST_CHECK(out.count == 0 && deframer.end_pending);
+    test_deframe_feed(&deframer, unknown2, sizeof(unknown2), &out);
+    TEST_CHECK(out.count == 1 && out.events[0] == UART_DEFRAME_FRAME && out.lens[0] == 3);
+    // 下一次讀取以 `{` 開頭時，待定的 `}` 是結尾 (a pending `}` ends the frame when the next read starts with `{`)
+    static const uint8_t next[] = { '{', 0x20, 0x03, '}' };
+    test_deframe_feed(&deframer, next, sizeof(next), &out);
+    TEST_CHECK(out.count == 2 && out.events[1] == UART_DEFRAME_FRAME && out.lens[1] == 2);
+    test_deframe_idle(&deframer, &out);
+    TEST_CHECK(out.count == 3 && out.events[2] == UART_DEFRAME_FRAME && out.lens[2] == 2);
+}
+
+static void test_deframe_damaged(void) {
+    UartDeframer deframer = UART_DEFRAMER_INIT;
+    TestDeframed out = {0};
+    // 遺失起始碼的封包、空封包與封包前的雜訊 (a frame missing its start, an empty frame, noise before a frame)
+    static const uint8_t lost_start[] = { 0x10, 0x01, 0x00, '}', '{', '}', '{', 0x20, 0x00, '}' };
+    test_deframe_feed(&deframer, lost_start, sizeof(lost_start), &out);
+    test_deframe_idle(&deframer, &out);
+    TEST_CHECK(out.count == 3);
+    TEST_CHECK(out.events[0] == UART_DEFRAME_MALFORMED);
+    TEST_CHECK(out.events[1] == UART_DEFRAME_MALFORMED);
+    TEST_CHECK(out.events[2] == UART_DEFRAME_FRAME && out.first[2] == 0x20);
+    out.count = 0;
+    static const uint8_t noise[] = { 0xFF, 0x00, '{', 0x20, 0x00, '}' };
+    test_deframe_feed(&deframer, noise, sizeof(noise), &out);
+    test_deframe_idle(&deframer, &out);
+    TEST_CHECK(out.count == 2 && out.events[0] == UART_DEFRAME_NOISE && out.events[1] == UART_DEFRAME_FRAME);
+    // 過長的封包只算一個損壞封包 (an oversize frame counts as one damaged frame)
+    out.count = 0;
+    uint8_t big[PACKET_MAX_SIZE];
+    big[0] = '{';
+    memset(big + 1, 0x11, sizeof(big) - 1);
+    test_deframe_feed(&deframer, big, sizeof(big), &out);
+    static const uint8_t tail[] = { 0x11, 0x11, '}' };
+    test_deframe_feed(&deframer, tail, sizeof(tail), &out);
+    test_deframe_idle(&deframer, &out);
+    TEST_CHECK(out.count == 1 && out.events[0] == UART_DEFRAME_MALFORMED);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+#define TEST_SAMPLES_MAX    8
+static TelemetrySample test_samples[TEST_SAMPLES_MAX];
+static uint8_t test_sample_count = 0;
+
+static void test_sample_sink(const TelemetrySample *sample) {
+    if (test_sample_count < TEST_SAMPLES_MAX) test_samples[test_sample_count++] = *sample;
+}
+
+static void test_receive_frame(UartLink *link, const VecU8 *datas) {
+    UartPacket packet = uart_packet_new();
+    VecU8 copy = *datas;
+    uart_pkt_add_data(&packet, &copy);
+    uart_trcv_buf_push(&link->rx_buf, &packet);
+    uart_receive_pkt_proc(link, UART_TRCV_BUF_CAP);
+}
+
+static void test_packet_proc_telemetry(void) {
+    UartLink *link = &uart_links[UART_LINK_PRIMARY];
+    test_sample_count = 0;
+    // 同一框串接速度與 ADC 兩筆回報 (one frame chaining a speed and an ADC report)
+    VecU8 datas = vec_u8_new();
+    vec_u8_push_byte(&datas, CMD_CODE_DATA_TRRE);
+    vec_u8_push(&datas, CMD_LEFT_SPEED_STORE, 2);
+    vec_u8_push_f32(&datas, -2.25f);
+    vec_u8_push(&datas, CMD_RIGHT_ADC_STORE, 2);
+    vec_u8_push_u16(&datas, 4000);
+    test_receive_frame(link, &datas);
+    TEST_CHECK(test_sample_count == 2);
+    TEST_CHECK(test_samples[0].channel == TELEMETRY_CH_LEFT_SPEED && test_samples[0].value == -2.25f);
+    TEST_CHECK(test_samples[1].channel == TELEMETRY_CH_RIGHT_ADC && test_samples[1].value == 4000.0f);
+    TEST_CHECK(link->rx_buf.len == 0);
+}
+
+static void test_packet_proc_secondary_port(void) {
+    // 主要埠以外的遙測不進入站台快取 (telemetry from other ports stays out of the station cache)
+    UartLink *link = uart_link_get(1);
+    TEST_CHECK(link != NULL);
+    if (link == NULL) return;
+    test_sample_count = 0;
+    VecU8 datas = vec_u8_new();
+    vec_u8_push_byte(&datas, CMD_CODE_DATA_TRRE);
+    vec_u8_push(&datas, CMD_LEFT_SPEED_STORE, 2);
+    vec_u8_push_f32(&datas, 3.0f);
+    test_receive_frame(link, &datas);
+    TEST_CHECK(test_sample_count == 0);
+    TEST_CHECK(link->rx_buf.len == 0);
+}
+
+static void test_packet_proc_zero_values(void) {
+    // 數值位元組與模式命令相同時仍是數值 (value bytes that look like a mode command are still values)
+    UartLink *link = &uart_links[UART_LINK_PRIMARY];
+    link->flags.right_speed = true;
+    link->flags.right_adc = true;
+    test_sample_count = 0;
+    VecU8 datas = vec_u8_new();
+    vec_u8_push_byte(&datas, CMD_CODE_DATA_TRRE);
+    vec_u8_push(&datas, CMD_RIGHT_SPEED_STORE, 2);
+    vec_u8_push_f32(&datas, 0.0f);
+    vec_u8_push(&datas, CMD_RIGHT_ADC_STORE, 2);
+    vec_u8_push_u16(&datas, 0x00FF);
+    vec_u8_push(&datas, CMD_RIGHT_ADC_STORE, 2);
+    vec_u8_push_u16(&datas, 0x01F4);
+    test_receive_frame(link, &datas);
+    TEST_CHECK(test_sample_count == 3);
+    TEST_CHECK(test_samples[0].channel == TELEMETRY_CH_RIGHT_SPEED && test_samples[0].value == 0.0f);
+    TEST_CHECK(test_samples[1].channel == TELEMETRY_CH_RIGHT_ADC && test_samples[1].value == 255.0f);
+    TEST_CHECK(test_samples[2].channel == TELEMETRY_CH_RIGHT_ADC && test_samples[2].value == 500.0f);
+    TEST_CHECK(link->flags.right_speed && link->flags.right_adc);
+    TEST_CHECK(link->tx_buf.len == 0);
+}
+
+static void test_packet_proc_mode_echo(void) {
+    // 剛好 3 位元組的剩餘部分才是模式命令 (only an exact 3-byte remainder is a mode command)
+    UartLink *link = &uart_links[UART_LINK_PRIMARY];
+    link->flags.right_speed = true;
+    test_sample_count = 0;
+    VecU8 datas = vec_u8_new();
+    vec_u8_push_byte(&datas, CMD_CODE_DATA_TRRE);
+    vec_u8_push(&datas, CMD_RIGHT_SPEED_STOP, 3);
+    test_receive_frame(link, &datas);
+    TEST_CHECK(!link->flags.right_speed);
+    datas = vec_u8_new();
+    vec_u8_push_byte(&datas, CMD_CODE_DATA_TRRE);
+    vec_u8_push(&datas, CMD_RIGHT_ADC_ONCE, 3);
+    test_receive_frame(link, &datas);
+    TEST_CHECK(test_sample_count == 0);
+    TEST_CHECK(link->tx_buf.len == 0);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static uint8_t test_take_all_slots(UartLink *link, UartPacket *frames, uint8_t max) {
+    UartCmdSlotSet taken;
+    uint8_t count = 0;
+    while (count < max && uart_cmd_slots_take(&link->slots, &taken, &frames[count])) count++;
+    return count;
+}
+
+static void test_cmd_once_then_stop(void) {
+    // 文件所述的重排：模式命令先於較早的單次讀取送出 (the documented reordering: the mode change goes out before the earlier one-shot read)
+    uart_links_init();
+    UartLink *link = &uart_links[UART_LINK_PRIMARY];
+    UartCmdBatch batch;
+    uart_cmd_batch_init(&batch, link);
+    TEST_CHECK(uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_ONCE, 3));
+    TEST_CHECK(uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_STOP, 3));
+    TEST_CHECK(uart_cmd_batch_commit(&batch));
+    UartPacket frames[4];
+    TEST_CHECK(test_take_all_slots(link, frames, 4) == 1);
+    static const uint8_t stop[] = {CMD_CODE_DATA_TRRE, CMD_CODE_MOTOR_RIGHT, CMD_CODE_SPEED, CMD_CODE_LOOP_STOP};
+    static const uint8_t once[] = {CMD_CODE_DATA_TRRE, CMD_CODE_MOTOR_RIGHT, CMD_CODE_SPEED, CMD_CODE_ONLY_ONCE};
+    TEST_CHECK(test_vec_equals(&frames[0].datas, stop, sizeof(stop)));
+    UartPacket fifo;
+    TEST_CHECK(uart_trcv_buf_pop_front(&link->tx_buf, &fifo));
+    TEST_CHECK(test_vec_equals(&fifo.datas, once, sizeof(once)));
+    TEST_CHECK(link->tx_buf.len == 0);
+}
+
+static void test_cmd_chained_modes(void) {
+    // 串接的模式命令拆進槽位，較舊的 START 不會留在 FIFO 裡蓋掉較新的 STOP
+    // Chained mode changes are split into the slots, so an older START cannot sit in the FIFO and undo a newer STOP
+    uart_links_init();
+    UartLink *link = &uart_links[UART_LINK_PRIMARY];
+    static const uint8_t chained[] = {
+        CMD_CODE_MOTOR_RIGHT, CMD_CODE_SPEED, CMD_CODE_LOOP_START,
+        CMD_CODE_MOTOR_LEFT, CMD_CODE_ADC, CMD_CODE_ONLY_ONCE,
+    };
+    UartCmdBatch batch;
+    uart_cmd_batch_init(&batch, link);
+    TEST_CHECK(uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, chained, sizeof(chained)));
+    TEST_CHECK(batch.cmds == 2 && batch.slotted == 1);
+    TEST_CHECK(uart_cmd_batch_commit(&batch));
+    uart_cmd_batch_init(&batch, link);
+    TEST_CHECK(uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_STOP, 3));
+    TEST_CHECK(uart_cmd_batch_commit(&batch));
+
+    UartPacket frames[4];
+    TEST_CHECK(test_take_all_slots(link, frames, 4) == 1);
+    static const uint8_t stop[] = {CMD_CODE_DATA_TRRE, CMD_CODE_MOTOR_RIGHT, CMD_CODE_SPEED, CMD_CODE_LOOP_STOP};
+    TEST_CHECK(test_vec_equals(&frames[0].datas, stop, sizeof(stop)));
+    static const uint8_t once[] = {CMD_CODE_DATA_TRRE, CMD_CODE_MOTOR_LEFT, CMD_CODE_ADC, CMD_CODE_ONLY_ONCE};
+    UartPacket fifo;
+    TEST_CHECK(uart_trcv_buf_pop_front(&link->tx_buf, &fifo));
+    TEST_CHECK(test_vec_equals(&fifo.datas, once, sizeof(once)));
+    TEST_CHECK(link->tx_buf.len == 0);
+}
+
+static void test_cmd_adjacent_merge(void) {
+    // 只有相鄰的單次讀取共用封包，中間的其他命令碼另開封包 (only neighbouring one-shots share a frame)
+    uart_links_init();
+    UartLink *link = &uart_links[UART_LINK_PRIMARY];
+    static const uint8_t other[] = {0x01};
+    UartCmdBatch batch;
+    uart_cmd_batch_init(&batch, link);
+    TEST_CHECK(uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_ONCE, 3));
+    TEST_CHECK(uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, CMD_LEFT_ADC_ONCE, 3));
+    TEST_CHECK(uart_cmd_batch_add(&batch, 0x40, other, sizeof(other)));
+    TEST_CHECK(uart_cmd_batch_add(&batch, CMD_CODE_DATA_TRRE, CMD_LEFT_SPEED_ONCE, 3));
+    TEST_CHECK(batch.cmds == 4 && batch.count == 3 && batch.slotted == 0);
+    TEST_CHECK(uart_cmd_batch_commit(&batch));
+
+    static const uint8_t merged[] = {
+        CMD_CODE_DATA_TRRE,
+        CMD_CODE_MOTOR_RIGHT, CMD_CODE_SPEED, CMD_CODE_ONLY_ONCE,
+        CMD_CODE_MOTOR_LEFT, CMD_CODE_ADC, CMD_CODE_ONLY_ONCE,
+    };
+    static const uint8_t plain[] = {0x40, 0x01};
+    static const uint8_t last[] = {CMD_CODE_DATA_TRRE, CMD_CODE_MOTOR_LEFT, CMD_CODE_SPEED, CMD_CODE_ONLY_ONCE};
+    UartPacket fifo;
+    TEST_CHECK(uart_trcv_buf_pop_front(&link->tx_buf, &fifo));
+    TEST_CHECK(test_vec_equals(&fifo.datas, merged, sizeof(merged)));
+    TEST_CHECK(uart_trcv_buf_pop_front(&link->tx_buf, &fifo));
+    TEST_CHECK(test_vec_equals(&fifo.datas, plain, sizeof(plain)));
+    TEST_CHECK(uart_trcv_buf_pop_front(&link->tx_buf, &fifo));
+    TEST_CHECK(test_vec_equals(&fifo.datas, last, sizeof(last)));
+    TEST_CHECK(link->tx_buf.len == 0);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static bool test_flow_credit(UartFlow *flow, uint8_t window, uint8_t consumed) {
+    uint8_t credit[UART_FLOW_CREDIT_LEN] = { CMD_CODE_FLOW_CREDIT, window, consumed };
+    return uart_flow_on_credit(flow, credit, sizeof(credit));
+}
+
+static void test_flow_stall_starve(void) {
+    UartFlow flow = { .lock = portMUX_INITIALIZER_UNLOCKED };
+    uart_flow_init(&flow, 4, 1000, 50000);
+    // 對方未宣告前不限制 (unthrottled until the peer advertises)
+    for (uint8_t i = 0; i < 10; i++) {
+        TEST_CHECK(uart_flow_can_send(&flow, 0));
+        uart_flow_sent(&flow);
+    }
+    static const uint8_t short_credit[] = { CMD_CODE_FLOW_CREDIT, 2 };
+    TEST_CHECK(!uart_flow_on_credit(&flow, short_credit, sizeof(short_credit)));
+    // 第一次宣告以對方計數為起點 (the first advertisement becomes the starting point)
+    TEST_CHECK(test_flow_credit(&flow, 2, 0));
+    TEST_CHECK(flow.sent == 0);
+
+    uint32_t stalls = metrics_counter_total(METRIC_UART_FLOW_STALLS);
+    uint32_t starved = metrics_counter_total(METRIC_UART_FLOW_STARVED);
+    TEST_CHECK(uart_flow_can_send(&flow, 100));
+    uart_flow_sent(&flow);
+    TEST_CHECK(uart_flow_can_send(&flow, 100));
+    uart_flow_sent(&flow);
+    // 窗口用完：第一次被擋計一次停頓，之後的等待不重複計算 (window used up: one stall per wait)
+    TEST_CHECK(!uart_flow_can_send(&flow, 100));
+    TEST_CHECK(!uart_flow_can_send(&flow, 600));
+    TEST_CHECK(metrics_counter_total(METRIC_UART_FLOW_STALLS) == stalls + 1);
+    // 信用到達後放行 (a credit lets the frame go)
+    TEST_CHECK(test_flow_credit(&flow, 2, 1));
+    TEST_CHECK(uart_flow_can_send(&flow, 700));
+    uart_flow_sent(&flow);
+
+    // 等待超過 starve_us 視為信用遺失，退回對方最後的計數 (a wait past starve_us resyncs to the peer's last count)
+    TEST_CHECK(!uart_flow_can_send(&flow, 1000));
+    TEST_CHECK(!uart_flow_can_send(&flow, 1999));
+    TEST_CHECK(uart_flow_can_send(&flow, 2001));
+    TEST_CHECK(metrics_counter_total(METRIC_UART_FLOW_STALLS) == stalls + 2);
+    TEST_CHECK(metrics_counter_total(METRIC_UART_FLOW_STARVED) == starved + 1);
+    TEST_CHECK(flow.sent == 1);
+}
+
+static void test_flow_resync_wrap(void) {
+    UartFlow flow = { .lock = portMUX_INITIALIZER_UNLOCKED };
+    uart_flow_init(&flow, 4, 1000, 50000);
+    TEST_CHECK(test_flow_credit(&flow, 2, 250));
+    for (uint8_t i = 0; i < 2; i++) {
+        TEST_CHECK(uart_flow_can_send(&flow, 0));
+        uart_flow_sent(&flow);
+    }
+    TEST_CHECK(!uart_flow_can_send(&flow, 0));
+    TEST_CHECK(uart_flow_can_send(&flow, 5000));
+    TEST_CHECK(flow.sent == 250);
+    // 重新同步時誤判遺失的封包其實已送達：對方計數超前時追上 (frames written off did arrive: catch up to a count ahead of ours)
+    TEST_CHECK(test_flow_credit(&flow, 2, 252));
+    TEST_CHECK(flow.sent == 252);
+    // 計數跨越 255 回繞 (counts wrap past 255)
+    TEST_CHECK(test_flow_credit(&flow, 8, 255));
+    for (uint8_t i = 0; i < 8; i++) {
+        TEST_CHECK(uart_flow_can_send(&flow, 6000));
+        uart_flow_sent(&flow);
+    }
+    TEST_CHECK(flow.sent == 7);
+    TEST_CHECK(!uart_flow_can_send(&flow, 6000));
+    TEST_CHECK(test_flow_credit(&flow, 8, 0));
+    TEST_CHECK(flow.sent == 7);
+    TEST_CHECK(uart_flow_can_send(&flow, 6001));
+}
+
+static void test_flow_credit_due(void) {
+    UartFlow flow = { .lock = portMUX_INITIALIZER_UNLOCKED };
+    uart_flow_init(&flow, 4, 1000, 50000);
+    UartPacket frame;
+    TEST_CHECK(uart_flow_credit_due(&flow, 10, &frame));
+    TEST_CHECK(test_vec_equals(&frame.datas, (const uint8_t[]){ CMD_CODE_FLOW_CREDIT, 4, 0 }, UART_FLOW_CREDIT_LEN));
+    TEST_CHECK(!uart_flow_credit_due(&flow, 20, &frame));
+    uart_flow_consumed(&flow, 3);
+    TEST_CHECK(uart_flow_credit_due(&flow, 30, &frame));
+    TEST_CHECK(test_vec_equals(&frame.datas, (const uint8_t[]){ CMD_CODE_FLOW_CREDIT, 4, 3 }, UART_FLOW_CREDIT_LEN));
+    TEST_CHECK(!uart_flow_credit_due(&flow, 30 + 49999, &frame));
+    // 沒有變化時定期重新宣告，修復遺失的信用封包 (re-advertise periodically to repair a lost credit frame)
+    TEST_CHECK(uart_flow_credit_due(&flow, 30 + 50000, &frame));
+    TEST_CHECK(test_vec_equals(&frame.datas, (const uint8_t[]){ CMD_CODE_FLOW_CREDIT, 4, 3 }, UART_FLOW_CREDIT_LEN));
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void test_slots_estop_lane(void) {
+    UartCmdSlots slots = UART_CMD_SLOTS_INIT;
+    UartCmdSlotSet set = {0};
+    TEST_CHECK(!uart_cmd_slot_set_put(&set, UART_CMD_SLOT_MOTION, &CMD_MOVE_FORWARD[1]));
+    TEST_CHECK(!uart_cmd_slot_set_put(&set, UART_CMD_SLOT_RIGHT_SPEED, CMD_RIGHT_SPEED_START));
+    uart_cmd_slots_merge(&slots, &set);
+    // 緊急停止作廢待送的行進命令，重複請求保留最早的追蹤 (the stop supersedes pending motion, a repeat keeps the first trace)
+    PktTrace first = { .t_us = { 11 } };
+    PktTrace second = { .t_us = { 22 } };
+    uart_cmd_slots_estop(&slots, &first);
+    uart_cmd_slots_estop(&slots, &second);
+    TEST_CHECK(!(slots.set.pending & (1U << UART_CMD_SLOT_MOTION)));
+
+    UartCmdSlotSet taken;
+    UartPacket frame;
+    TEST_CHECK(uart_cmd_slots_take(&slots, &taken, &frame));
+    TEST_CHECK(taken.pending == 1U << UART_CMD_SLOT_ESTOP);
+    TEST_CHECK(test_vec_equals(&frame.datas, CMD_MOVE_STOP, 2));
+    TEST_CHECK(frame.trace.t_us[0] == 11);
+
+    // 寫入失敗放回；期間的新行進命令在停止之後仍然有效 (a failed write restores the stop; motion queued meanwhile still follows it)
+    set = (UartCmdSlotSet){0};
+    uart_cmd_slot_set_put(&set, UART_CMD_SLOT_MOTION, &CMD_MOVE_LEFT[1]);
+    uart_cmd_slots_merge(&slots, &set);
+    uart_cmd_slots_restore(&slots, &taken);
+    TEST_CHECK(slots.set.estop_us == taken.estop_us);
+
+    static const uint8_t modes[] = {CMD_CODE_DATA_TRRE, CMD_CODE_MOTOR_RIGHT, CMD_CODE_SPEED, CMD_CODE_LOOP_START};
+    TEST_CHECK(uart_cmd_slots_take(&slots, &taken, &frame));
+    TEST_CHECK(test_vec_equals(&frame.datas, CMD_MOVE_STOP, 2));
+    TEST_CHECK(uart_cmd_slots_take(&slots, &taken, &frame));
+    TEST_CHECK(test_vec_equals(&frame.datas, CMD_MOVE_LEFT, 2));
+    TEST_CHECK(uart_cmd_slots_take(&slots, &taken, &frame));
+    TEST_CHECK(test_vec_equals(&frame.datas, modes, sizeof(modes)));
+    TEST_CHECK(!uart_cmd_slots_take(&slots, &taken, &frame));
+
+    // 放回的行進命令不能越過期間排入的停止 (restored motion cannot overtake a stop queued meanwhile)
+    set = (UartCmdSlotSet){0};
+    uart_cmd_slot_set_put(&set, UART_CMD_SLOT_MOTION, &CMD_MOVE_RIGHT[1]);
+    uart_cmd_slots_merge(&slots, &set);
+    TEST_CHECK(uart_cmd_slots_take(&slots, &taken, &frame));
+    uart_cmd_slots_estop(&slots, NULL);
+    uart_cmd_slots_restore(&slots, &taken);
+    TEST_CHECK(slots.set.pending == 1U << UART_CMD_SLOT_ESTOP);
+}
+
+static void test_slots_coalesce(void) {
+    TEST_CHECK(uart_cmd_slot_of(CMD_CODE_DATA_TRRE, CMD_RIGHT_SPEED_ONCE, 3) == UART_CMD_SLOT_NONE);
+    TEST_CHECK(uart_cmd_slot_of(CMD_CODE_DATA_TRRE, CMD_LEFT_ADC_STOP, 3) == UART_CMD_SLOT_LEFT_ADC);
+    TEST_CHECK(uart_cmd_slot_of(CMD_CODE_VECH_CONTROL, &CMD_MOVE_FORWARD[1], 1) == UART_CMD_SLOT_MOTION);
+    TEST_CHECK(uart_cmd_is_estop(CMD_CODE_VECH_CONTROL, &CMD_MOVE_STOP[1], 1));
+    TEST_CHECK(!uart_cmd_is_estop(CMD_CODE_VECH_CONTROL, &CMD_MOVE_FORWARD[1], 1));
+
+    UartCmdSlots slots = UART_CMD_SLOTS_INIT;
+    UartCmdSlotSet set = {0};
+    TEST_CHECK(!uart_cmd_slot_set_put(&set, UART_CMD_SLOT_RIGHT_SPEED, CMD_RIGHT_SPEED_START));
+    TEST_CHECK(uart_cmd_slot_set_put(&set, UART_CMD_SLOT_RIGHT_SPEED, CMD_RIGHT_SPEED_START));
+    TEST_CHECK(!uart_cmd_slot_set_put(&set, UART_CMD_SLOT_LEFT_ADC, CMD_LEFT_ADC_START));
+    TEST_CHECK(!uart_cmd_slot_set_put(&set, UART_CMD_SLOT_NONE, CMD_LEFT_ADC_START));
+    uint32_t coalesced = metrics_counter_total(METRIC_UART_CMD_COALESCED);
+    uart_cmd_slots_merge(&slots, &set);
+    TEST_CHECK(metrics_counter_total(METRIC_UART_CMD_COALESCED) == coalesced);
+    // 較新的批次覆蓋待送槽位並計數 (a newer batch overwrites the pending slot and is counted)
+    set = (UartCmdSlotSet){0};
+    uart_cmd_slot_set_put(&set, UART_CMD_SLOT_RIGHT_SPEED, CMD_RIGHT_SPEED_STOP);
+    uart_cmd_slots_merge(&slots, &set);
+    TEST_CHECK(metrics_counter_total(METRIC_UART_CMD_COALESCED) == coalesced + 1);
+
+    // 回報模式槽位依槽位順序串成一個封包 (report-mode slots chain into one frame in slot order)
+    static const uint8_t chained[] = {
+        CMD_CODE_DATA_TRRE,
+        CMD_CODE_MOTOR_LEFT, CMD_CODE_ADC, CMD_CODE_LOOP_START,
+        CMD_CODE_MOTOR_RIGHT, CMD_CODE_SPEED, CMD_CODE_LOOP_STOP,
+    };
+    UartCmdSlotSet taken;
+    UartPacket frame;
+    TEST_CHECK(uart_cmd_slots_take(&slots, &taken, &frame));
+    TEST_CHECK(test_vec_equals(&frame.datas, chained, sizeof(chained)));
+    TEST_CHECK(!uart_cmd_slots_take(&slots, &taken, &frame));
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void test_dgram_round_trip(void) {
+    static const uint8_t cmd[] = {CMD_CODE_VECH_CONTROL, 0x01};
+    static const uint8_t port_cmd[] = {1, CMD_CODE_DATA_TRRE, 0x01, 0x02, 0x03};
+    WifiDgramHeader hdr = {
+        .flags = WIFI_DGRAM_FLAG_RELIABLE | WIFI_DGRAM_FLAG_ACK, .seq = 0xFFFE, .ack = 0x1234, .ack_bits = 0x80000001,
+    };
+    VecU8 vec;
+    TEST_CHECK(wifi_dgram_begin(&vec, &hdr));
+    TEST_CHECK(vec.len == WIFI_DGRAM_HEADER_SIZE);
+    TEST_CHECK(wifi_dgram_push_record(&vec, WIFI_DGRAM_REC_CMD, cmd, sizeof(cmd)));
+    TEST_CHECK(wifi_dgram_push_record(&vec, WIFI_DGRAM_REC_PORT_CMD, port_cmd, sizeof(port_cmd)));
+    TEST_CHECK(wifi_dgram_push_record(&vec, WIFI_DGRAM_REC_QUERY, NULL, 0));
+    static const uint8_t wire_hdr[] = {WIFI_DGRAM_MAGIC, WIFI_DGRAM_VERSION, 0x03, 3, 0xFF, 0xFE, 0x12, 0x34, 0x80, 0x00, 0x00, 0x01};
+    TEST_CHECK(memcmp(vec.data, wire_hdr, sizeof(wire_hdr)) == 0);
+
+    WifiDgramHeader parsed;
+    TEST_CHECK(wifi_dgram_parse_header(vec.data, vec.len, &parsed));
+    TEST_CHECK(parsed.flags == hdr.flags && parsed.rec_count == 3);
+    TEST_CHECK(parsed.seq == hdr.seq && parsed.ack == hdr.ack && parsed.ack_bits == hdr.ack_bits);
+    uint16_t offset = 0;
+    WifiDgramRecord rec;
+    TEST_CHECK(wifi_dgram_next_record(vec.data, vec.len, &offset, &rec));
+    TEST_CHECK(rec.type == WIFI_DGRAM_REC_CMD && rec.len == sizeof(cmd) && memcmp(rec.payload, cmd, sizeof(cmd)) == 0);
+    TEST_CHECK(wifi_dgram_next_record(vec.data, vec.len, &offset, &rec));
+    TEST_CHECK(rec.type == WIFI_DGRAM_REC_PORT_CMD && rec.len == sizeof(port_cmd));
+    TEST_CHECK(memcmp(rec.payload, port_cmd, sizeof(port_cmd)) == 0);
+    TEST_CHECK(wifi_dgram_next_record(vec.data, vec.len, &offset, &rec));
+    TEST_CHECK(rec.type == WIFI_DGRAM_REC_QUERY && rec.len == 0);
+    TEST_CHECK(!wifi_dgram_next_record(vec.data, vec.len, &offset, &rec));
+}
+
+static void test_dgram_bad_input(void) {
+    static const uint8_t payload[8] = {0};
+    WifiDgramHeader hdr = {0};
+    VecU8 vec;
+    wifi_dgram_begin(&vec, &hdr);
+    WifiDgramHeader parsed;
+    TEST_CHECK(!wifi_dgram_parse_header(vec.data, WIFI_DGRAM_HEADER_SIZE - 1, &parsed));
+    vec.data[0] ^= 0xFF;
+    TEST_CHECK(!wifi_dgram_parse_header(vec.data, vec.len, &parsed));
+    vec.data[0] ^= 0xFF;
+    vec.data[1]++;
+    TEST_CHECK(!wifi_dgram_parse_header(vec.data, vec.len, &parsed));
+    vec.data[1]--;
+
+    // 紀錄長度超出封包時停止，不讀越界 (a record running past the datagram ends iteration)
+    TEST_CHECK(wifi_dgram_push_record(&vec, WIFI_DGRAM_REC_TELEMETRY, payload, sizeof(payload)));
+    uint16_t offset = 0;
+    WifiDgramRecord rec;
+    TEST_CHECK(!wifi_dgram_next_record(vec.data, vec.len - 1, &offset, &rec));
+
+    // 放不下的紀錄不改動封包 (a record that does not fit leaves the datagram untouched)
+    while (wifi_dgram_push_record(&vec, WIFI_DGRAM_REC_TELEMETRY, payload, sizeof(payload))) {}
+    uint16_t full_len = vec.len;
+    uint8_t full_count = vec.data[3];
+    TEST_CHECK(full_len <= WIFI_DGRAM_MAX_SIZE);
+    TEST_CHECK(!wifi_dgram_push_record(&vec, WIFI_DGRAM_REC_TELEMETRY, payload, sizeof(payload)));
+    TEST_CHECK(vec.len == full_len && vec.data[3] == full_count);
+}
+
+static void test_dgram_tx_window(void) {
+    WifiDgramTxWindow win = wifi_dgram_tx_window_new();
+    VecU8 dgram = vec_u8_new();
+    VecU8 out;
+    bool expired = false;
+    uint16_t seqs[WIFI_DGRAM_TX_WINDOW];
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        TEST_CHECK(wifi_dgram_tx_reserve(&win, &seqs[i]));
+        TEST_CHECK(seqs[i] == i + 1);
+    }
+    uint16_t seq;
+    TEST_CHECK(!wifi_dgram_tx_reserve(&win, &seq));
+    // 佔住但尚未送出的槽位不逾時 (a claimed slot that was never sent does not time out)
+    TEST_CHECK(!wifi_dgram_tx_next_due(&win, 10 * WIFI_DGRAM_RTO_US, &out, &expired));
+    TEST_CHECK(wifi_dgram_tx_time_left(&win, 0) == UINT32_MAX);
+
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        TEST_CHECK(wifi_dgram_tx_track(&win, seqs[i], &dgram, 0));
+    }
+    TEST_CHECK(wifi_dgram_tx_time_left(&win, 0) == WIFI_DGRAM_RTO_US);
+    // 累積確認到 2，選擇確認 4 (cumulative ack up to 2 plus a selective ack of 4)
+    TEST_CHECK(wifi_dgram_tx_on_ack(&win, 2, 0x2) == 3);
+    TEST_CHECK(wifi_dgram_tx_reserve(&win, &seq) && seq == WIFI_DGRAM_TX_WINDOW + 1);
+
+    uint8_t due = 0;
+    while (wifi_dgram_tx_next_due(&win, WIFI_DGRAM_RTO_US, &out, &expired)) due++;
+    TEST_CHECK(due == WIFI_DGRAM_TX_WINDOW - 3);
+    TEST_CHECK(!expired);
+    // 重試上限後放棄 (give up after the retry limit)
+    uint32_t now_us = WIFI_DGRAM_RTO_US;
+    for (uint8_t tries = 2; tries <= WIFI_DGRAM_MAX_TRIES; tries++) {
+        now_us += WIFI_DGRAM_RTO_US * tries;
+        while (wifi_dgram_tx_next_due(&win, now_us, &out, &expired)) {}
+    }
+    TEST_CHECK(expired);
+    TEST_CHECK(wifi_dgram_tx_time_left(&win, now_us) == UINT32_MAX);
+}
+
+static void test_dgram_tx_release(void) {
+    // 佔住後放棄的序號歸還槽位，否則視窗會被永久佔滿 (an abandoned claim frees its slot, else the window fills for good)
+    WifiDgramTxWindow win = wifi_dgram_tx_window_new();
+    VecU8 dgram = vec_u8_new();
+    uint16_t seqs[WIFI_DGRAM_TX_WINDOW];
+    for (uint8_t i = 0; i < WIFI_DGRAM_TX_WINDOW; i++) {
+        TEST_CHECK(wifi_dgram_tx_reserve(&win, &seqs[i]));
+    }
+    uint16_t seq;
+    TEST_CHECK(!wifi_dgram_tx_reserve(&win, &seq));
+    TEST_CHECK(wifi_dgram_tx_release(&win, seqs[3]));
+    TEST_CHECK(!wifi_dgram_tx_release(&win, seqs[3]));
+    TEST_CHECK(wifi_dgram_tx_reserve(&win, &seq) && seq == WIFI_DGRAM_TX_WINDOW + 1);
+    // 已送出的封包不可被放棄 (a datagram already sent cannot be abandoned)
+    TEST_CHECK(wifi_dgram_tx_track(&win, seqs[0], &dgram, 0));
+    TEST_CHECK(!wifi_dgram_tx_release(&win, seqs[0]));
+    TEST_CHECK(wifi_dgram_tx_on_ack(&win, seqs[0], 0) == 1);
+}
+
+static void test_dgram_rx_window(void) {
+    WifiDgramRxWindow win = wifi_dgram_rx_window_new();
+    // 只檢查不記錄，未確認的序號重送時仍是新的 (check does not record, an unconfirmed seq is still new when resent)
+    TEST_CHECK(wifi_dgram_rx_check(&win, 100) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(wifi_dgram_rx_check(&win, 100) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(wifi_dgram_rx_accept(&win, 100) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(wifi_dgram_rx_check(&win, 100) == WIFI_DGRAM_RX_DUPLICATE);
+    TEST_CHECK(win.ack == 100 && win.ack_bits == 0);
+    TEST_CHECK(wifi_dgram_rx_accept(&win, 100) == WIFI_DGRAM_RX_DUPLICATE);
+    TEST_CHECK(wifi_dgram_rx_accept(&win, 103) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(win.ack == 100 && win.ack_bits == 0x4);
+    TEST_CHECK(wifi_dgram_rx_check(&win, 103) == WIFI_DGRAM_RX_DUPLICATE);
+    TEST_CHECK(wifi_dgram_rx_check(&win, 102) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(wifi_dgram_rx_accept(&win, 103) == WIFI_DGRAM_RX_DUPLICATE);
+    TEST_CHECK(wifi_dgram_rx_accept(&win, 101) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(wifi_dgram_rx_accept(&win, 102) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(win.ack == 103 && win.ack_bits == 0);
+    // 序號回繞 (sequence wrap)
+    win = wifi_dgram_rx_window_new();
+    TEST_CHECK(wifi_dgram_rx_accept(&win, 0xFFFF) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(wifi_dgram_rx_accept(&win, 0) == WIFI_DGRAM_RX_NEW);
+    TEST_CHECK(win.ack == 0 && wifi_dgram_rx_accept(&win, 0xFFFF) == WIFI_DGRAM_RX_DUPLICATE);
+}
+
+static bool test_aggr_begin(VecU8 *vec_u8) {
+    WifiDgramHeader hdr = {0};
+    return wifi_dgram_begin(vec_u8, &hdr);
+}
+
+static void test_aggr_fill_and_drop(void) {
+    static uint8_t payload[WIFI_DGRAM_MAX_PAYLOAD + 1];
+    WifiAggr aggr;
+    VecU8 out;
+    wifi_aggr_init(&aggr, test_aggr_begin, WIFI_AGGR_DEFAULT_DEADLINE_US);
+    // 放不下時先交出舊封包，新紀錄進入下一個封包 (a record that does not fit closes the open datagram first)
+    TEST_CHECK(!wifi_aggr_push(&aggr, WIFI_DGRAM_REC_TELEMETRY, payload, 200, 0, &out));
+    TEST_CHECK(wifi_aggr_push(&aggr, WIFI_DGRAM_REC_TELEMETRY, payload, 100, 1, &out));
+    WifiDgramHeader hdr;
+    TEST_CHECK(wifi_dgram_parse_header(out.data, out.len, &hdr) && hdr.rec_count == 1);
+    TEST_CHECK(aggr.open);
+
+    // 任何封包都放不下的紀錄計為丟棄，不留下空封包 (a record too long for any datagram is counted, no empty datagram stays open)
+    uint32_t drops = metrics_counter_total(METRIC_WIFI_UDP_TELEMETRY_DROPS);
+    TEST_CHECK(wifi_aggr_push(&aggr, WIFI_DGRAM_REC_TELEMETRY, payload, sizeof(payload), 2, &out));
+    TEST_CHECK(metrics_counter_total(METRIC_WIFI_UDP_TELEMETRY_DROPS) == drops + 1);
+    TEST_CHECK(!aggr.open);
+    TEST_CHECK(wifi_dgram_parse_header(out.data, out.len, &hdr) && hdr.rec_count == 1);
+    TEST_CHECK(!wifi_aggr_push(&aggr, WIFI_DGRAM_REC_TELEMETRY, payload, sizeof(payload), 3, &out));
+    TEST_CHECK(metrics_counter_total(METRIC_WIFI_UDP_TELEMETRY_DROPS) == drops + 2);
+    TEST_CHECK(!aggr.open);
+}
+
+// ----------------------------------------------------------------------------------------------------
+
+static void test_history_publish(TelemetryChannel channel, float value) {
+    TelemetrySample sample = { .channel = channel, .value = value };
+    telemetry_publish(&sample);
+}
+
+static uint32_t test_history_latest(TelemetryChannel channel) {
+    static uint32_t t_us[64];
+    static float value[64];
+    uint32_t cursor = 0;
+    while (telemetry_history_read(channel, &cursor, t_us, value, 64) > 0) {}
+    return cursor;
+}
+
+static void test_history_overrun(void) {
+    static uint32_t t_us[TELEMETRY_HISTORY_LEN];
+    static float value[TELEMETRY_HISTORY_LEN];
+    const TelemetryChannel channel = TELEMETRY_CH_LEFT_ADC;
+    uint32_t start = test_history_latest(channel);
+
+    uint32_t cursor = start;
+    for (uint8_t i = 0; i < 3; i++) test_history_publish(channel, 1.0f + i);
+    TEST_CHECK(telemetry_history_read(channel, &cursor, t_us, value, 8) == 3);
+    TEST_CHECK(value[0] == 1.0f && value[1] == 2.0f && value[2] == 3.0f);
+    TEST_CHECK(cursor == start + 3);
+    TEST_CHECK(telemetry_history_read(channel, &cursor, t_us, value, 8) == 0);
+    // 讀取不消耗資料，同一游標重讀得到相同樣本 (reads do not consume; the same cursor reads the same samples)
+    uint32_t again = start;
+    TEST_CHECK(telemetry_history_read(channel, &again, t_us, value, 8) == 3);
+    TEST_CHECK(value[0] == 1.0f && value[2] == 3.0f && again == cursor);
+
+    // 寫入超過環形長度，落後的游標跳到最舊的有效樣本 (past a full ring, a lagging cursor jumps to the oldest valid sample)
+    const uint32_t extra = 10;
+    for (uint32_t i = 0; i < TELEMETRY_HISTORY_LEN + extra; i++) test_history_publish(channel, 100.0f + i);
+    uint32_t oldest = telemetry_history_oldest(channel);
+    TEST_CHECK(oldest == start + 3 + extra + 1);
+    TEST_CHECK(telemetry_history_read(channel, &cursor, t_us, value, 4) == 4);
+    TEST_CHECK(value[0] == 100.0f + extra + 1 && cursor == oldest + 4);
+    uint32_t total = 4;
+    uint16_t count;
+    float last = value[3];
+    uint32_t last_us = t_us[3];
+    bool ordered = true;
+    while ((count = telemetry_history_read(channel, &cursor, t_us, value, TELEMETRY_HISTORY_LEN)) > 0) {
+        for (uint16_t i = 0; i < count; i++) {
+            ordered = ordered && value[i] == last + 1.0f && t_us[i] - last_us < 0x80000000U;
+            last = value[i];
+            last_us = t_us[i];
+        }
+        total += count;
+    }
+    TEST_CHECK(ordered);
+    TEST_CHECK(total == TELEMETRY_HISTORY_LEN - 1);
+    TEST_CHECK(last == 100.0f + TELEMETRY_HISTORY_LEN + extra - 1);
+}
+
+static void test_history_decimator(void) {
+    uint32_t t_us;
+    float value;
+    TelemetryDecimator dec = telemetry_decimator_new(100);
+    TEST_CHECK(!telemetry_decimator_push(&dec, 1000, 1.0f, &t_us, &value));
+    TEST_CHECK(!telemetry_decimator_push(&dec, 1050, 3.0f, &t_us, &value));
+    TEST_CHECK(telemetry_decimator_push(&dec, 1100, 5.0f, &t_us, &value));
+    TEST_CHECK(t_us == 1000 && value == 2.0f);
+    TEST_CHECK(telemetry_decimator_flush(&dec, &t_us, &value));
+    TEST_CHECK(t_us == 1100 && value == 5.0f);
+    TEST_CHECK(!telemetry_decimator_flush(&dec, &t_us, &value));
+    // 時間戳回繞時區間仍正確關閉 (buckets still close across a timestamp wrap)
+    TEST_CHECK(!telemetry_decimator_push(&dec, 0xFFFFFFC0U, 4.0f, &t_us, &value));
+    TEST_CHECK(telemetry_decimator_push(&dec, 0x40, 8.0f, &t_us, &value));
+    TEST_CHECK(t_us == 0xFFFFFFC0U && value == 4.0f);
+    dec = telemetry_decimator_new(0);
+    TEST_CHECK(telemetry_decimator_push(&dec, 7, 9.0f, &t_us, &value) && t_us == 7 && value == 9.0f);
+}
+
+static const TestCase test_cases[] = {
+    { "vec_u8 push capacity",           test_vec_push_capacity },
+    { "vec_u8 big-endian push",         test_vec_big_endian },
+    { "vec_u8 ring wrap",               test_vec_wrap },
+    { "vec_u8 rm_range",                test_vec_rm_range },
+    { "uart ring order across wrap",    test_uart_ring_order_wrap },
+    { "uart ring full/push_all",        test_uart_ring_full },
+    { "uart_pkt pack/unpack",           test_uart_pkt_round_trip },
+    { "uart_pkt bad frames",            test_uart_pkt_bad_frames },
+    { "deframe burst in one read",      test_deframe_burst },
+    { "deframe frame across reads",     test_deframe_split },
+    { "deframe 0x7D inside a value",    test_deframe_embedded_end },
+    { "deframe damaged frames",         test_deframe_damaged },
+    { "packet_proc telemetry",          test_packet_proc_telemetry },
+    { "packet_proc secondary port",     test_packet_proc_secondary_port },
+    { "packet_proc zero-valued reports", test_packet_proc_zero_values },
+    { "packet_proc 3-byte mode echo",   test_packet_proc_mode_echo },
+    { "cmd once then stop reorders",    test_cmd_once_then_stop },
+    { "cmd chained modes use slots",    test_cmd_chained_modes },
+    { "cmd only adjacent frames merge", test_cmd_adjacent_merge },
+    { "flow stall and starvation",      test_flow_stall_starve },
+    { "flow resync and count wrap",     test_flow_resync_wrap },
+    { "flow credit advertisement",      test_flow_credit_due },
+    { "slots e-stop lane",              test_slots_estop_lane },
+    { "slots coalescing",               test_slots_coalesce },
+    { "datagram encode/decode",         test_dgram_round_trip },
+    { "datagram bad input",             test_dgram_bad_input },
+    { "datagram tx window",             test_dgram_tx_window },
+    { "datagram tx release",            test_dgram_tx_release },
+    { "datagram rx window",             test_dgram_rx_window },
+    { "aggregator fill and drop",       test_aggr_fill_and_drop },
+    { "history overrun and re-read",    test_history_overrun },
+    { "history decimator",              test_history_decimator },
+};
+
+int main(void) {
+    uart_links_init();
+    telemetry_sink_register(test_sample_sink);
+    telemetry_history_setup();
+    uint32_t failed_cases = 0;
+    for (size_t i = 0; i < sizeof(test_cases) / sizeof(test_cases[0]); i++) {
+        uint32_t before = test_failures;
+        test_cases[i].fn();
+        bool ok = test_failures == before;
+        if (!ok) failed_cases++;
+        printf("%-4s %s\n", ok ? "ok" : "FAIL", test_cases[i].name);
+    }
+    printf("%u/%u cases passed\n", (unsigned)(sizeof(test_cases) / sizeof(test_cases[0]) - failed_cases),
+        (unsigned)(sizeof(test_cases) / sizeof(test_cases[0])));
+    return failed_cases == 0 ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""End-to-end smoke run of the Linux target build against two simulated STM32s.
+
+Starts the station ELF, waits for both pty links (CONFIG_STATION_SIM_UART_LINK
+and CONFIG_STATION_SIM_UART2_LINK), attaches one stm32_sim.py to each and lets
+them stream reports for --seconds. Meanwhile it sends one reliable PORT_CMD
+datagram per UART port to the station's UDP port and waits for the acks. At the
+end it reads /metrics and checks:
+
+* every UART port's command was acked and reached its simulator;
+* no simulator saw a bad frame and the station counted no frame errors;
+* per port, the station received at least --min-ratio of the frames sent.
+
+Exits 1 if any check fails. With --build it first runs the two idf.py steps
+from sdkconfig.defaults.linux:
+
+    linux_smoke.py --build
+    linux_smoke.py --elf build_linux/agv_esp32_station.elf --seconds 30 --rate 500
+"""
+import argparse
+import ast
+import http.client
+import os
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+REPO = os.path.dirname(TOOLS)
+BUILD_STEPS = [
+    ["idf.py", "-B", "build_linux", "-D", "SDKCONFIG=sdkconfig.linux", "--preview", "set-target", "linux"],
+    ["idf.py", "-B", "build_linux", "-D", "SDKCONFIG=sdkconfig.linux", "build"],
+]
+
+UDP_PORT = 60001
+DGRAM_MAGIC = 0xA7
+DGRAM_VERSION = 1
+FLAG_RELIABLE, FLAG_ACK = 0x01, 0x02
+REC_PORT_CMD = 0x05
+HEADER = struct.Struct(">BBBBHHI")  # magic, version, flags, rec_count, seq, ack, ack_bits
+
+# right_speed_once: DATA_TRRE + (motor 1, speed, ONLY_ONCE)
+PROBE_CMD = bytes.fromhex("10010001")
+
+
+def wait_for(paths, proc, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        if proc.poll() is not None:
+            return False
+        if all(os.path.exists(p) for p in paths):
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def send_probes(host, ports, timeout):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(0.1)
+    acked = set()
+    deadline = time.monotonic() + timeout
+    while len(acked) < len(ports) and time.monotonic() < deadline:
+        for seq, port in enumerate(ports, 1):
+            if seq in acked:
+                continue
+            record = bytes([REC_PORT_CMD, len(PROBE_CMD) + 1, port]) + PROBE_CMD
+            sock.sendto(HEADER.pack(DGRAM_MAGIC, DGRAM_VERSION, FLAG_RELIABLE, 1, seq, 0, 0) + record,
+                        (host, UDP_PORT))
+        try:
+            while True:
+                data, _ = sock.recvfrom(2048)
+                if len(data) < HEADER.size:
+                    continue
+                magic, _, flags, _, _, ack, ack_bits = HEADER.unpack_from(data)
+                if magic != DGRAM_MAGIC or not flags & FLAG_ACK:
+                    continue
+                for seq in range(1, len(ports) + 1):
+                    d = seq - ack
+                    if d <= 0 or (d <= 32 and (ack_bits >> (d - 1)) & 1):
+                        acked.add(seq)
+        except socket.timeout:
+            pass
+    sock.close()
+    return [ports[seq - 1] for seq in sorted(acked)]
+
+
+def fetch_metrics(host, port):
+    conn = http.client.HTTPConnection(host, port, timeout=2)
+    conn.request("GET", "/metrics")
+    text = conn.getresponse().read().decode()
+    conn.close()
+    metrics = {}
+    for line in text.splitlines():
+        if line and not line.startswith("#"):
+            name, _, value = line.rpartition(" ")
+            metrics[name] = float(value)
+    return metrics
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--build", action="store_true", help="run idf.py set-target linux and build first")
+    parser.add_argument("--elf", default=os.path.join(REPO, "build_linux", "agv_esp32_station.elf"))
+    parser.add_argument("--links", default="/tmp/station_uart,/tmp/station_uart2",
+                        help="comma-separated pty links, one per UART port")
+    parser.add_argument("--http-port", type=int, default=8080, help="CONFIG_STATION_HTTP_PORT of the Linux build")
+    parser.add_argument("--seconds", type=float, default=10.0, help="how long the simulators stream")
+    parser.add_argument("--rate", type=float, default=200.0, help="reports per second per stream")
+    parser.add_argument("--window", type=int, default=0, help="stm32_sim.py credit window, 0 disables flow control")
+    parser.add_argument("--min-ratio", type=float, default=0.95, help="station rx frames / simulator tx frames")
+    args = parser.parse_args()
+
+    if args.build:
+        for step in BUILD_STEPS:
+            print("$ " + " ".join(step), flush=True)
+            subprocess.run(step, cwd=REPO, check=True)
+
+    links = args.links.split(",")
+    for link in links:
+        if os.path.islink(link):
+            os.unlink(link)
+    log = open("linux_smoke.log", "w")
+    station = subprocess.Popen([args.elf], stdout=log, stderr=subprocess.STDOUT)
+    failures = []
+    try:
+        if not wait_for(links, station, 10.0):
+            sys.exit("station did not create %s (see linux_smoke.log)" % ", ".join(links))
+        sims = [subprocess.Popen([sys.executable, os.path.join(TOOLS, "stm32_sim.py"), link,
+                                  "--rate", str(args.rate), "--autostart", "--window", str(args.window),
+                                  "--duration", str(args.seconds), "--stats-interval", str(args.seconds)],
+                                 stdout=subprocess.PIPE, text=True) for link in links]
+        acked = send_probes("127.0.0.1", list(range(len(links))), 2.0)
+        stats = []
+        for sim in sims:
+            out, _ = sim.communicate(timeout=args.seconds + 10)
+            stats.append(ast.literal_eval(out.strip().splitlines()[-1]))
+        time.sleep(0.2)
+        metrics = fetch_metrics("127.0.0.1", args.http_port)
+    finally:
+        station.terminate()
+        station.wait()
+        log.close()
+
+    print("%-22s %9s %9s %7s %6s %9s %7s" % ("link", "tx_frames", "reports", "rx_bad", "trre", "station", "errors"))
+    for port, (link, s) in enumerate(zip(links, stats)):
+        label = '{port="%d"}' % port
+        received = metrics.get("station_uart_port_rx_frames_total" + label, 0)
+        errors = metrics.get("station_uart_port_frame_errors_total" + label, 0)
+        print("%-22s %9d %9d %7d %6d %9d %7d" % (
+            link, s["tx_frames"], s["tx_reports"], s["rx_bad"], s["trre_cmds"], received, errors))
+        if s["rx_bad"]:
+            failures.append("port %d: %d bad frames from the station" % (port, s["rx_bad"]))
+        if port not in acked:
+            failures.append("port %d: UDP command not acked" % port)
+        if not s["trre_cmds"]:
+            failures.append("port %d: the UDP command never reached the simulator" % port)
+        if errors:
+            failures.append("port %d: station counted %d UART frame errors" % (port, errors))
+        if s["tx_frames"] and received < args.min_ratio * s["tx_frames"]:
+            failures.append("port %d: station received %.1f%% of the frames" % (
+                port, 100.0 * received / s["tx_frames"]))
+
+    for f in failures:
+        print("FAIL " + f)
+    print("PASS" if not failures else "%d check(s) failed" % len(failures))
+    sys.exit(1 if failures else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,328 @@
+#!/usr/bin/env python3
+"""Ramping load generator for the station's UDP, TCP and HTTP ports.
+
+Each step offers a fixed request rate for --step-seconds, then raises it by
+--step until --max or until the loss ratio exceeds --stop-loss. Every step
+reports the offered and achieved rate, drops and latency percentiles:
+
+* udp  - reliable CMD datagrams to port 60001; latency is send-to-ack. The
+         station acks to the datagram's source port, so any --local-port
+         works (the default is an ephemeral port).
+* tcp  - one connection per request to port 60000; latency is connect to close.
+* http - keep-alive requests to the HTTP server; latency is request to response.
+
+With --estop-every N, every Nth udp datagram also carries move_stop. Run a
+ramp past saturation and the tool reads the station's worst stop latency
+(station_uart_estop_max_us) from /metrics at the end.
+
+With --uart-ports 0,1 the udp datagrams address the listed UART ports in turn
+with PORT_CMD records; pair it with one stm32_sim.py per port. The Linux build
+sends its telemetry to 127.0.0.1:60011 (STATION_PEER_UDP_PORT), so
+--local-port 60011 receives the telemetry along with the acks.
+
+Pair it with stm32_sim.py on the UART side to load both directions:
+
+    loadgen.py udp 192.168.0.20 --start 50 --step 50 --max 1000 --results load.json
+    loadgen.py udp 192.168.0.20 --start 200 --step 200 --max 2000 --estop-every 50
+    loadgen.py udp 127.0.0.1 --local-port 60011 --uart-ports 0,1
+    loadgen.py tcp 192.168.0.20 --start 10 --step 10 --max 200
+    loadgen.py http 127.0.0.1 --port 8080 --path /cmd --body '["right_speed_once"]'
+"""
+import argparse
+import http.client
+import json
+import os
+import socket
+import struct
+import time
+
+UDP_PORT = 60001
+TCP_PORT = 60000
+
+DGRAM_MAGIC = 0xA7
+DGRAM_VERSION = 1
+FLAG_RELIABLE, FLAG_ACK = 0x01, 0x02
+REC_CMD, REC_TELEMETRY = 0x01, 0x02
+REC_PORT_CMD, REC_PORT_TELEMETRY = 0x05, 0x06
+HEADER = struct.Struct(">BBBBHHI")  # magic, version, flags, rec_count, seq, ack, ack_bits
+
+# right_speed_once: DATA_TRRE + (motor 1, speed, ONLY_ONCE)
+DEFAULT_CMD = "10010001"
+# move_stop: VECH_CONTROL + 0
+ESTOP_CMD = bytes([0x20, 0x00])
+
+
+def percentile(sorted_values, pct):
+    if not sorted_values:
+        return float("nan")
+    rank = max(0, min(len(sorted_values) - 1, int(round(pct / 100.0 * len(sorted_values) + 0.5)) - 1))
+    return sorted_values[rank]
+
+
+def port_record(port, cmd):
+    return bytes([REC_PORT_CMD, len(cmd) + 1, port]) + cmd
+
+
+def seq_diff(a, b):
+    d = (a - b) & 0xFFFF
+    return d - 0x10000 if d >= 0x8000 else d
+
+
+class UdpLoad:
+    def __init__(self, host, args):
+        self.addr = (host, UDP_PORT)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(("0.0.0.0", args.local_port))
+        self.sock.setblocking(False)
+        cmd = bytes.fromhex(args.cmd)
+        if args.uart_ports:
+            ports = [int(p) for p in args.uart_ports.split(",")]
+            self.records = [port_record(p, cmd) for p in ports]
+            self.estop_records = [port_record(p, ESTOP_CMD) for p in ports]
+        else:
+            self.records = [bytes([REC_CMD, len(cmd)]) + cmd]
+            self.estop_records = [bytes([REC_CMD, len(ESTOP_CMD)]) + ESTOP_CMD]
+        self.estop_every = args.estop_every
+        self.timeout = args.timeout
+        self.seq = 0
+        self.pending = {}
+        self.telemetry = 0
+
+    def send(self, now):
+        self.seq = (self.seq + 1) & 0xFFFF
+        port = self.seq % len(self.records)
+        if self.estop_every and self.seq % self.estop_every == 0:
+            hdr = HEADER.pack(DGRAM_MAGIC, DGRAM_VERSION, FLAG_RELIABLE, 2, self.seq, 0, 0)
+            self.sock.sendto(hdr + self.records[port] + self.estop_records[port], self.addr)
+        else:
+            hdr = HEADER.pack(DGRAM_MAGIC, DGRAM_VERSION, FLAG_RELIABLE, 1, self.seq, 0, 0)
+            self.sock.sendto(hdr + self.records[port], self.addr)
+        self.pending[self.seq] = now
+
+    def poll(self, now, latencies):
+        while True:
+            try:
+                data, _ = self.sock.recvfrom(2048)
+            except BlockingIOError:
+                break
+            if len(data) < HEADER.size:
+                continue
+            magic, version, flags, rec_count, _, ack, ack_bits = HEADER.unpack_from(data)
+            if magic != DGRAM_MAGIC or version != DGRAM_VERSION:
+                continue
+            if rec_count and data[HEADER.size] in (REC_TELEMETRY, REC_PORT_TELEMETRY):
+                self.telemetry += 1
+            if not flags & FLAG_ACK:
+                continue
+            recv = time.perf_counter()
+            # 累積確認加上選擇確認位元 (cumulative ack plus the selective ack bits)
+            for seq in list(self.pending):
+                d = seq_diff(seq, ack)
+                if d <= 0 or (d <= 32 and (ack_bits >> (d - 1)) & 1):
+                    latencies.append((recv - self.pending.pop(seq)) * 1e3)
+        return self.expire(now)
+
+    def expire(self, now):
+        lost = [seq for seq, sent in self.pending.items() if now - sent > self.timeout]
+        for seq in lost:
+            del self.pending[seq]
+        return len(lost)
+
+    def drain(self, latencies):
+        deadline = time.perf_counter() + self.timeout
+        lost = 0
+        while self.pending and time.perf_counter() < deadline:
+            lost += self.poll(time.perf_counter(), latencies)
+            time.sleep(0.001)
+        return lost + self.expire(float("inf"))
+
+    def extra(self):
+        return {"telemetry": self.telemetry}
+
+
+class TcpLoad:
+    def __init__(self, host, args):
+        self.addr = (host, TCP_PORT)
+        body = bytes.fromhex(args.cmd)
+        self.request = (b"POST / HTTP/1.1\r\nHost: %s\r\nContent-Length: %d\r\n\r\n" % (host.encode(), len(body))) + body
+        self.timeout = args.timeout
+        self.lost = 0
+
+    def send(self, now):
+        start = time.perf_counter()
+        try:
+            with socket.create_connection(self.addr, timeout=self.timeout) as sock:
+                sock.sendall(self.request)
+                # 站台讀完請求即關閉連線，不回應內容 (the station closes after reading, no reply)
+                while sock.recv(256):
+                    pass
+        except OSError:
+            self.lost += 1
+            return None
+        return (time.perf_counter() - start) * 1e3
+
+    def poll(self, now, latencies):
+        lost, self.lost = self.lost, 0
+        return lost
+
+    def drain(self, latencies):
+        return self.poll(0, latencies)
+
+    def extra(self):
+        return {}
+
+
+class HttpLoad:
+    def __init__(self, host, args):
+        self.host = host
+        self.port = args.port
+        self.path = args.path
+        self.body = args.body.encode() if args.body else None
+        self.timeout = args.timeout
+        self.conn = None
+        self.lost = 0
+
+    def send(self, now):
+        start = time.perf_counter()
+        try:
+            if self.conn is None:
+                self.conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+            method = "POST" if self.body is not None else "GET"
+            headers = {"Content-Type": "application/json"} if self.body is not None else {}
+            self.conn.request(method, self.path, body=self.body, headers=headers)
+            resp = self.conn.getresponse()
+            resp.read()
+            if resp.status >= 400:
+                self.lost += 1
+                return None
+        except (OSError, http.client.HTTPException):
+            self.lost += 1
+            if self.conn is not None:
+                self.conn.close()
+            self.conn = None
+            return None
+        return (time.perf_counter() - start) * 1e3
+
+    def poll(self, now, latencies):
+        lost, self.lost = self.lost, 0
+        return lost
+
+    def drain(self, latencies):
+        return self.poll(0, latencies)
+
+    def extra(self):
+        return {}
+
+
+def run_step(load, rate, seconds):
+    interval = 1.0 / rate
+    latencies = []
+    sent = lost = 0
+    start = time.perf_counter()
+    next_send = start
+    end = start + seconds
+    while True:
+        now = time.perf_counter()
+        if now >= end:
+            break
+        if now >= next_send:
+            latency = load.send(now)
+            if latency is not None:
+                latencies.append(latency)
+            sent += 1
+            next_send += interval
+            # 送不出去就放棄追趕，避免爆量 (give up catching up instead of bursting)
+            if now - next_send > 0.1:
+                next_send = now
+        lost += load.poll(now, latencies)
+        # 睡眠上限 1 ms，讓確認的時間戳不受發送間隔影響 (short sleeps keep ack timestamps accurate)
+        time.sleep(max(0.0, min(next_send, end, time.perf_counter() + 0.001) - time.perf_counter()))
+    elapsed = time.perf_counter() - start
+    lost += load.drain(latencies)
+    values = sorted(latencies)
+    summary = {
+        "offered": rate,
+        "achieved": len(values) / elapsed,
+        "sent": sent,
+        "lost": lost,
+        "p50": percentile(values, 50),
+        "p90": percentile(values, 90),
+        "p99": percentile(values, 99),
+        "max": values[-1] if values else float("nan"),
+    }
+    summary.update(load.extra())
+    return summary
+
+
+def fetch_estop_metrics(host, port):
+    conn = http.client.HTTPConnection(host, port, timeout=2)
+    conn.request("GET", "/metrics")
+    text = conn.getresponse().read().decode()
+    conn.close()
+    return [line for line in text.splitlines()
+            if line.startswith("station_uart_estop") and "_bucket" not in line]
+
+
+def print_row(r):
+    print("%8.1f %9.1f %7d %6d %8.2f %8.2f %8.2f %8.2f" % (
+        r["offered"], r["achieved"], r["sent"], r["lost"], r["p50"], r["p90"], r["p99"], r["max"]), flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("mode", choices=["udp", "tcp", "http"])
+    parser.add_argument("host", help="station IP address")
+    parser.add_argument("--start", type=float, default=10.0, help="first step rate (requests/s)")
+    parser.add_argument("--step", type=float, default=10.0, help="rate increase per step")
+    parser.add_argument("--max", type=float, default=200.0, help="last step rate")
+    parser.add_argument("--step-seconds", type=float, default=5.0, help="duration of each step")
+    parser.add_argument("--stop-loss", type=float, default=0.05, help="stop once the loss ratio exceeds this")
+    parser.add_argument("--timeout", type=float, default=0.5, help="seconds before a request counts as lost")
+    parser.add_argument("--cmd", default=DEFAULT_CMD, help="hex UART command for udp/tcp (default right_speed_once)")
+    parser.add_argument("--local-port", type=int, default=0, help="udp: local port receiving the acks (0 = ephemeral)")
+    parser.add_argument("--uart-ports", help="udp: comma-separated UART ports addressed in turn with PORT_CMD records")
+    parser.add_argument("--estop-every", type=int, default=0, help="udp: add move_stop to every Nth datagram")
+    parser.add_argument("--port", type=int, default=80, help="http: server port (8080 for the Linux build), also used for /metrics")
+    parser.add_argument("--path", default="/hello", help="http: request path")
+    parser.add_argument("--body", help="http: JSON body, switches the request to POST")
+    parser.add_argument("--label", help="results key (default: mode)")
+    parser.add_argument("--results", help="JSON file collecting one ramp per label")
+    args = parser.parse_args()
+
+    load = {"udp": UdpLoad, "tcp": TcpLoad, "http": HttpLoad}[args.mode](args.host, args)
+    steps = []
+    print("%8s %9s %7s %6s %8s %8s %8s %8s" % ("offered", "achieved", "sent", "lost", "p50", "p90", "p99", "max"))
+    rate = args.start
+    try:
+        while rate <= args.max:
+            r = run_step(load, rate, args.step_seconds)
+            steps.append(r)
+            print_row(r)
+            if r["sent"] and r["lost"] / r["sent"] > args.stop_loss:
+                print("loss %.1f%% above --stop-loss, saturated at %.1f req/s" % (
+                    100.0 * r["lost"] / r["sent"], r["offered"]))
+                break
+            rate += args.step
+    except KeyboardInterrupt:
+        pass
+    print("(rates in requests/s, latencies in ms)")
+    if args.mode == "udp" and args.estop_every:
+        try:
+            for line in fetch_estop_metrics(args.host, args.port):
+                print(line)
+        except OSError as e:
+            print("could not read /metrics: %s" % e)
+
+    if args.results:
+        results = {}
+        if os.path.exists(args.results):
+            with open(args.results) as f:
+                results = json.load(f)
+        results[args.label or args.mode] = steps
+        with open(args.results, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""Fetch, inspect and replay station traffic captures.
+
+The station records timestamped UART/UDP/TCP traffic into a RAM ring
+(POST /capture?action=start) and dumps it with GET /capture. This tool turns
+a dump back into load: UART_RX records are written to the UART as the STM32
+would send them, UDP_RX and TCP_RX records are sent to the station's ports
+60001/60000. Records the station sent (UART_TX, UDP_TX) are only listed.
+
+    replay.py fetch 192.168.0.20 field.cap
+    replay.py info field.cap
+    replay.py play field.cap --uart /tmp/station_uart --host 127.0.0.1 --speed 4
+    replay.py play field.cap --host 192.168.0.20 --speed 0 --loop 10
+"""
+import argparse
+import os
+import socket
+import struct
+import time
+import urllib.request
+
+from stm32_sim import open_port
+
+FILE_HEADER = struct.Struct("<IHHII")   # magic, version, record_hdr_size, records, dropped
+RECORD_HEADER = struct.Struct("<IHBB")  # t_us, len, source, stored
+MAGIC = 0x50414353
+VERSION = 1
+
+SOURCES = ["uart_rx", "uart_tx", "udp_rx", "udp_tx", "tcp_rx"]
+UART_RX, UART_TX, UDP_RX, UDP_TX, TCP_RX = range(len(SOURCES))
+
+UDP_PORT = 60001
+TCP_PORT = 60000
+
+
+def load(path):
+    with open(path, "rb") as f:
+        blob = f.read()
+    magic, version, hdr_size, count, dropped = FILE_HEADER.unpack_from(blob)
+    if magic != MAGIC or version != VERSION or hdr_size != RECORD_HEADER.size:
+        raise SystemExit("%s: not a station capture (magic %08x version %d)" % (path, magic, version))
+    records = []
+    offset = FILE_HEADER.size
+    t_rel = 0
+    prev = None
+    while offset + RECORD_HEADER.size <= len(blob):
+        t_us, length, source, stored = RECORD_HEADER.unpack_from(blob, offset)
+        offset += RECORD_HEADER.size
+        # 時間戳為 32 位元，逐筆累加差值處理回繞 (32-bit timestamps, accumulate deltas across wraparound)
+        if prev is not None:
+            t_rel += (t_us - prev) & 0xFFFFFFFF
+        prev = t_us
+        records.append((t_rel, source, length, blob[offset:offset + stored]))
+        offset += stored
+    if len(records) != count:
+        print("warning: header says %d records, found %d" % (count, len(records)))
+    return records, dropped
+
+
+def cmd_fetch(args):
+    url = "http://%s:%d/capture" % (args.host, args.port)
+    with urllib.request.urlopen(url, timeout=10) as resp:
+        blob = resp.read()
+    with open(args.output, "wb") as f:
+        f.write(blob)
+    _, _, _, count, dropped = FILE_HEADER.unpack_from(blob)
+    print("%s: %d bytes, %d records, %d dropped during the dump" % (args.output, len(blob), count, dropped))
+
+
+def cmd_info(args):
+    records, dropped = load(args.capture)
+    duration = records[-1][0] / 1e6 if records else 0.0
+    print("%d records over %.3f s, %d dropped" % (len(records), duration, dropped))
+    print("%-8s %8s %10s %10s %10s" % ("source", "records", "bytes", "rec/s", "truncated"))
+    for source, name in enumerate(SOURCES):
+        rows = [r for r in records if r[1] == source]
+        if not rows:
+            continue
+        size = sum(r[2] for r in rows)
+        truncated = sum(1 for r in rows if len(r[3]) < r[2])
+        print("%-8s %8d %10d %10.1f %10d" % (name, len(rows), size, len(rows) / duration if duration else 0.0, truncated))
+    if args.dump:
+        for t_rel, source, length, data in records:
+            print("%12.6f %-8s %4d %s" % (t_rel / 1e6, SOURCES[source] if source < len(SOURCES) else source,
+                                        length, data.hex()))
+
+
+def tcp_send(addr, data, timeout):
+    try:
+        with socket.create_connection(addr, timeout=timeout) as sock:
+            sock.sendall(data)
+            while sock.recv(256):
+                pass
+    except OSError:
+        return False
+    return True
+
+
+def cmd_play(args):
+    records, _ = load(args.capture)
+    uart = open_port(args.uart, args.baud) if args.uart else None
+    udp = None
+    if args.host:
+        udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        udp.bind(("0.0.0.0", args.local_port))
+    wanted = {UART_RX} if uart is not None else set()
+    if udp is not None:
+        wanted |= {UDP_RX, TCP_RX}
+    if not wanted:
+        raise SystemExit("nothing to replay into: pass --uart and/or --host")
+    plan = [r for r in records if r[1] in wanted]
+    sent = {name: 0 for name in SOURCES}
+    errors = 0
+    late_us = []
+    start = time.perf_counter()
+    for _ in range(args.loop):
+        base = time.perf_counter()
+        for t_rel, source, length, data in plan:
+            if len(data) < length:
+                errors += 1  # 截斷的紀錄無法重現 (truncated records cannot be reproduced)
+                continue
+            if args.speed > 0:
+                due = base + t_rel / 1e6 / args.speed
+                delay = due - time.perf_counter()
+                if delay > 0:
+                    time.sleep(delay)
+                else:
+                    late_us.append(-delay * 1e6)
+            if source == UART_RX:
+                # 一次寫入一整個框，站台以一次讀取為一個框 (one write per frame, the station reads frame-at-a-time)
+                os.write(uart, data)
+                if args.speed == 0:
+                    time.sleep(args.uart_gap / 1e3)
+            elif source == UDP_RX:
+                udp.sendto(data, (args.host, UDP_PORT))
+            elif source == TCP_RX:
+                if not tcp_send((args.host, TCP_PORT), data, args.timeout):
+                    errors += 1
+                    continue
+            sent[SOURCES[source]] += 1
+    elapsed = time.perf_counter() - start
+    total = sum(sent.values())
+    print("replayed %d records in %.3f s (%.1f rec/s), %d skipped or failed" % (total, elapsed, total / elapsed, errors))
+    print("  " + "  ".join("%s=%d" % (k, v) for k, v in sent.items() if v))
+    if late_us:
+        late_us.sort()
+        print("  %d records late, p50 %.0f us, max %.0f us" % (len(late_us), late_us[len(late_us) // 2], late_us[-1]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("fetch", help="download GET /capture")
+    p.add_argument("host")
+    p.add_argument("output")
+    p.add_argument("--port", type=int, default=80, help="HTTP port (8080 for the Linux build)")
+    p.set_defaults(func=cmd_fetch)
+
+    p = sub.add_parser("info", help="summarize a capture")
+    p.add_argument("capture")
+    p.add_argument("--dump", action="store_true", help="also print every record")
+    p.set_defaults(func=cmd_info)
+
+    p = sub.add_parser("play", help="replay a capture into the station")
+    p.add_argument("capture")
+    p.add_argument("--uart", help="UART to replay uart_rx into (pty link or serial device)")
+    p.add_argument("--baud", type=int, default=115200)
+    p.add_argument("--host", help="station IP to replay udp_rx/tcp_rx into")
+    p.add_argument("--local-port", type=int, default=UDP_PORT, help="local UDP port (acks come back here)")
+    p.add_argument("--speed", type=float, default=1.0, help="time scale, 2 = twice as fast, 0 = no pacing")
+    p.add_argument("--uart-gap", type=float, default=1.0, help="ms between UART frames when --speed 0")
+    p.add_argument("--loop", type=int, default=1, help="number of passes")
+    p.add_argument("--timeout", type=float, default=1.0, help="TCP connect/close timeout in seconds")
+    p.set_defaults(func=cmd_play)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
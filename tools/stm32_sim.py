@@ -0,0 +1,322 @@
+#!/usr/bin/env python3
+"""Simulated STM32 motor controller on the station's UART link.
+
+Speaks the `{` + data + `}` frame protocol from the STM32 side:
+
+* answers CMD_CODE_DATA_TRRE (0x10) requests. Each chained sub-command
+  (motor, kind, mode) starts (LOOP_START), stops (LOOP_STOP) or sends one
+  (ONLY_ONCE) speed/ADC report;
+* streams the enabled reports as `{0x10 motor kind value}`: f32 big-endian
+  for speed, u16 big-endian for ADC;
+* counts CMD_CODE_VECH_CONTROL (0x20) frames;
+* with --window N, speaks the credit protocol (CMD_CODE_FLOW_CREDIT, 0x30):
+  advertises `{0x30 N consumed}` and sends reports only while the station's
+  credits last. Reports skipped for lack of credit count as credit_stalls.
+
+Attach it to the pty of the Linux simulation build (CONFIG_STATION_SIM_UART_LINK)
+or to a USB-serial adapter wired to the ESP32 UART:
+
+    stm32_sim.py /tmp/station_uart --rate 200 --autostart
+    stm32_sim.py /tmp/station_uart2 --rate 200 --autostart   # second port (CONFIG_STATION_SIM_UART2_LINK)
+    stm32_sim.py /dev/ttyUSB0 --baud 115200 --rate 50 --coalesce
+    stm32_sim.py /dev/ttyUSB0 --baud 921600 --rate 1000 --autostart --window 8
+"""
+import argparse
+import math
+import os
+import select
+import struct
+import termios
+import time
+
+START = ord("{")
+END = ord("}")
+PACKET_MAX_SIZE = 255  # VECU8_MAX_CAPACITY
+
+CMD_CODE_DATA_TRRE = 0x10
+CMD_CODE_VECH_CONTROL = 0x20
+CMD_CODE_FLOW_CREDIT = 0x30
+LOOP_STOP, ONLY_ONCE, LOOP_START = 0x00, 0x01, 0x02
+MOTOR_LEFT, MOTOR_RIGHT = 0x00, 0x01
+KIND_SPEED, KIND_ADC = 0x00, 0x05
+
+# 與站台預設相同 (same defaults as the station)
+CREDIT_REFRESH = 0.1
+CREDIT_STARVE = 0.2
+# 讀取結尾為 `}` 時等待下一個位元組的時間 (wait for the next byte after a read ending in `}`)
+END_WAIT = 0.002
+
+STREAMS = [(m, k) for m in (MOTOR_LEFT, MOTOR_RIGHT) for k in (KIND_SPEED, KIND_ADC)]
+
+BAUDS = {
+    9600: termios.B9600, 19200: termios.B19200, 38400: termios.B38400,
+    57600: termios.B57600, 115200: termios.B115200, 230400: termios.B230400,
+    460800: getattr(termios, "B460800", termios.B230400),
+    921600: getattr(termios, "B921600", termios.B230400),
+}
+
+
+def open_port(path, baud):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    attrs = termios.tcgetattr(fd)
+    # cfmakeraw
+    attrs[0] &= ~(termios.IGNBRK | termios.BRKINT | termios.PARMRK | termios.ISTRIP
+                  | termios.INLCR | termios.IGNCR | termios.ICRNL | termios.IXON)
+    attrs[1] &= ~termios.OPOST
+    attrs[2] &= ~(termios.CSIZE | termios.PARENB)
+    attrs[2] |= termios.CS8 | termios.CLOCAL | termios.CREAD
+    attrs[3] &= ~(termios.ECHO | termios.ECHONL | termios.ICANON | termios.ISIG | termios.IEXTEN)
+    if baud in BAUDS:
+        attrs[4] = attrs[5] = BAUDS[baud]
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+class Deframer:
+    """Split reads into frames like the station (src/uart/deframe.c).
+
+    `}` followed by `{` ends a frame. A `}` that is the last byte of a read
+    stays undecided: the frame ends if the next read starts with `{` or the
+    line goes quiet (flush()); any other byte makes the `}` payload. State
+    carries over between reads. feed() and flush() yield each frame with its
+    braces, or None for a damaged one; bytes outside any frame are noise.
+    """
+
+    def __init__(self):
+        self.buf = None
+        self.end_pending = False
+
+    def finish(self):
+        frame, self.buf, self.end_pending = bytes(self.buf), None, False
+        # 過長或沒有內容的 `{}` 都不是有效封包 (too long, or an empty `{}`, is not a valid frame)
+        return frame if 2 < len(frame) <= PACKET_MAX_SIZE else None
+
+    def flush(self):
+        if self.buf is not None and self.end_pending:
+            yield self.finish()
+
+    def feed(self, chunk):
+        for i, byte in enumerate(chunk):
+            if self.end_pending:
+                self.end_pending = False
+                if byte == START:
+                    yield self.finish()
+            if self.buf is None:
+                if byte == START:
+                    self.buf = bytearray([byte])
+                elif byte == END and (i + 1 == len(chunk) or chunk[i + 1] == START):
+                    # 單獨的結束碼表示起始碼遺失 (a lone end code means the start code was lost)
+                    yield None
+                continue
+            self.buf.append(byte)
+            if byte != END:
+                continue
+            if i + 1 == len(chunk):
+                self.end_pending = True
+            elif chunk[i + 1] == START:
+                yield self.finish()
+
+
+class Stm32Sim:
+    def __init__(self, fd, rate, coalesce, window=0):
+        self.fd = fd
+        self.period = 1.0 / rate if rate > 0 else None
+        self.coalesce = coalesce
+        self.enabled = set()
+        self.once = []
+        self.next_due = time.monotonic()
+        self.t0 = time.monotonic()
+        # 信用：window 為 0 時不使用 (credits, off when window is 0)
+        self.window = window
+        self.consumed = 0
+        self.advertised = None
+        self.advertised_at = 0.0
+        self.peer_window = 0
+        self.peer_consumed = 0
+        self.sent = 0
+        self.blocked_at = None
+        self.deframer = Deframer()
+        self.stats = {"rx_frames": 0, "rx_bad": 0, "trre_cmds": 0, "vech_frames": 0,
+                      "tx_frames": 0, "tx_reports": 0, "tx_bytes": 0,
+                      "credit_rx": 0, "credit_stalls": 0, "credit_starved": 0}
+
+    def value(self, motor, kind):
+        t = time.monotonic() - self.t0
+        if kind == KIND_SPEED:
+            return struct.pack(">f", 100.0 * math.sin(t + motor))
+        return struct.pack(">H", int(2048 + 2000 * math.sin(2 * t + motor)) & 0xFFFF)
+
+    def report(self, motor, kind):
+        return bytes([motor, kind]) + self.value(motor, kind)
+
+    def write_frame(self, data):
+        frame = bytes([START]) + data + bytes([END])
+        try:
+            os.write(self.fd, frame)
+        except BlockingIOError:
+            return
+        self.stats["tx_frames"] += 1
+        self.stats["tx_bytes"] += len(frame)
+
+    def has_credit(self):
+        if not self.window or not self.peer_window:
+            return True
+        if (self.sent - self.peer_consumed) & 0xFF < self.peer_window:
+            self.blocked_at = None
+            return True
+        now = time.monotonic()
+        if self.blocked_at is None:
+            self.blocked_at = now
+        elif now - self.blocked_at >= CREDIT_STARVE:
+            # 信用封包遺失，以站台最後的計數重新同步 (credits lost, resync to the station's last count)
+            self.stats["credit_starved"] += 1
+            self.sent = self.peer_consumed
+            self.blocked_at = None
+            return True
+        return False
+
+    def write_data(self, data):
+        if not self.has_credit():
+            self.stats["credit_stalls"] += 1
+            return False
+        self.write_frame(data)
+        self.sent = (self.sent + 1) & 0xFF
+        return True
+
+    def advertise(self, now):
+        if not self.window:
+            return
+        if self.consumed != self.advertised or now - self.advertised_at >= CREDIT_REFRESH:
+            self.write_frame(bytes([CMD_CODE_FLOW_CREDIT, self.window, self.consumed]))
+            self.advertised, self.advertised_at = self.consumed, now
+
+    def send_reports(self, streams):
+        """Returns how many of streams were sent."""
+        if not streams:
+            return 0
+        if self.coalesce:
+            if not self.write_data(bytes([CMD_CODE_DATA_TRRE]) + b"".join(self.report(m, k) for m, k in streams)):
+                return 0
+            self.stats["tx_reports"] += len(streams)
+            return len(streams)
+        sent = 0
+        for m, k in streams:
+            if not self.write_data(bytes([CMD_CODE_DATA_TRRE]) + self.report(m, k)):
+                break
+            sent += 1
+        self.stats["tx_reports"] += sent
+        return sent
+
+    def handle_trre(self, data):
+        # 子命令為 (motor, kind, mode) 三個位元組 (sub-commands are motor, kind, mode triples)
+        for i in range(0, len(data) - 2, 3):
+            motor, kind, mode = data[i], data[i + 1], data[i + 2]
+            if (motor, kind) not in STREAMS:
+                continue
+            self.stats["trre_cmds"] += 1
+            if mode == LOOP_START:
+                self.enabled.add((motor, kind))
+            elif mode == LOOP_STOP:
+                self.enabled.discard((motor, kind))
+            elif mode == ONLY_ONCE:
+                self.once.append((motor, kind))
+
+    def handle_chunk(self, chunk):
+        # 一次讀取可能含多個封包或半個封包 (one read may hold several frames or part of one)
+        self.handle_frames(self.deframer.feed(chunk))
+
+    def handle_frames(self, frames):
+        for frame in frames:
+            if frame is None:
+                # 損壞的封包同樣佔用過接收槽位 (a damaged frame also held a receive slot)
+                self.consumed = (self.consumed + 1) & 0xFF
+                self.stats["rx_bad"] += 1
+            else:
+                self.handle_frame(frame)
+
+    def handle_frame(self, frame):
+        data = frame[1:-1]
+        if self.window and len(data) == 3 and data[0] == CMD_CODE_FLOW_CREDIT:
+            self.stats["credit_rx"] += 1
+            # 首次宣告或站台計數超前時以站台為準 (take the station's count first time or when it is ahead)
+            if not self.peer_window or (self.sent - data[2]) & 0xFF >= 0x80:
+                self.sent = data[2]
+            self.peer_window, self.peer_consumed = data[1], data[2]
+            return
+        self.consumed = (self.consumed + 1) & 0xFF
+        self.stats["rx_frames"] += 1
+        if data[0] == CMD_CODE_DATA_TRRE:
+            self.handle_trre(data[1:])
+        elif data[0] == CMD_CODE_VECH_CONTROL:
+            self.stats["vech_frames"] += 1
+
+    def poll(self, timeout):
+        if self.deframer.end_pending:
+            timeout = min(timeout, END_WAIT)
+        readable, _, _ = select.select([self.fd], [], [], timeout)
+        if not readable:
+            # 線路靜默，讀取結尾的 `}` 是封包結尾 (the line went quiet, the trailing `}` ends the frame)
+            self.handle_frames(self.deframer.flush())
+            return
+        try:
+            chunk = os.read(self.fd, 256)
+        except (BlockingIOError, OSError):
+            return
+        if chunk:
+            self.handle_chunk(chunk)
+
+    def step(self):
+        now = time.monotonic()
+        self.advertise(now)
+        if self.once:
+            self.once = self.once[self.send_reports(self.once):]
+        if self.period is None:
+            self.poll(0.05)
+            return
+        if now >= self.next_due:
+            self.send_reports(sorted(self.enabled))
+            self.next_due += self.period
+            # 落後太多時不追趕 (do not burst to catch up after a stall)
+            if now - self.next_due > 10 * self.period:
+                self.next_due = now + self.period
+        self.poll(min(CREDIT_REFRESH, max(0.0, self.next_due - time.monotonic())))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", nargs="?", default="/tmp/station_uart", help="pty link or serial device")
+    parser.add_argument("--baud", type=int, default=115200, help="baud rate for real serial ports")
+    parser.add_argument("--rate", type=float, default=50.0, help="reports per second for every enabled stream")
+    parser.add_argument("--autostart", action="store_true", help="stream all channels without a LOOP_START request")
+    parser.add_argument("--coalesce", action="store_true", help="send all due reports in one DATA_TRRE frame")
+    parser.add_argument("--window", type=int, default=0, help="receive slots advertised as credits, 0 disables flow control")
+    parser.add_argument("--duration", type=float, default=0.0, help="seconds to run, 0 runs until interrupted")
+    parser.add_argument("--stats-interval", type=float, default=1.0, help="seconds between statistics lines")
+    args = parser.parse_args()
+
+    sim = Stm32Sim(open_port(args.port, args.baud), args.rate, args.coalesce, args.window)
+    if args.autostart:
+        sim.enabled.update(STREAMS)
+    start = last = time.monotonic()
+    prev = dict(sim.stats)
+    try:
+        while args.duration <= 0 or time.monotonic() - start < args.duration:
+            sim.step()
+            now = time.monotonic()
+            if now - last >= args.stats_interval:
+                dt = now - last
+                rates = {k: (sim.stats[k] - prev[k]) / dt for k in sim.stats}
+                print("rx %6.1f f/s (bad %d)  tx %6.1f f/s %7.1f B/s  streams %d  trre %d  vech %d  stalls %d" % (
+                    rates["rx_frames"], sim.stats["rx_bad"], rates["tx_frames"], rates["tx_bytes"],
+                    len(sim.enabled), sim.stats["trre_cmds"], sim.stats["vech_frames"],
+                    sim.stats["credit_stalls"]), flush=True)
+                prev, last = dict(sim.stats), now
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.close(sim.fd)
+    print(sim.stats)
+
+
+if __name__ == "__main__":
+    main()
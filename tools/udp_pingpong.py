@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""UDP ping-pong round-trip benchmark against the station's echo service.
+
+Sends timestamped datagrams to CONFIG_STATION_UDP_ECHO_PORT, matches the
+echoes by sequence number and reports round-trip percentiles. The echo
+service is off by default; build with sdkconfig.defaults.bench to enable it. Run it once
+per firmware network profile with --profile and --results to build a
+side-by-side comparison:
+
+    udp_pingpong.py 192.168.0.20 --profile low_latency --results rtt.json
+    udp_pingpong.py 192.168.0.20 --profile power_save  --results rtt.json
+"""
+import argparse
+import json
+import os
+import socket
+import struct
+import time
+
+HEADER = struct.Struct(">IQ")  # seq u32, send time ns u64
+
+
+def percentile(sorted_values, pct):
+    if not sorted_values:
+        return float("nan")
+    rank = max(0, min(len(sorted_values) - 1, int(round(pct / 100.0 * len(sorted_values) + 0.5)) - 1))
+    return sorted_values[rank]
+
+
+def run(host, port, count, interval, size, timeout):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(timeout)
+    padding = b"\0" * max(0, size - HEADER.size)
+    rtts = []
+    lost = 0
+    for seq in range(count):
+        sent_ns = time.perf_counter_ns()
+        sock.sendto(HEADER.pack(seq, sent_ns) + padding, (host, port))
+        deadline = sent_ns + int(timeout * 1e9)
+        while True:
+            try:
+                data, _ = sock.recvfrom(2048)
+            except socket.timeout:
+                lost += 1
+                break
+            now_ns = time.perf_counter_ns()
+            if len(data) < HEADER.size:
+                continue
+            echo_seq, echo_ns = HEADER.unpack_from(data)
+            if echo_seq == seq:
+                rtts.append((now_ns - echo_ns) / 1e6)
+                break
+            # 遲到的舊回應直接略過 (late echo of an earlier probe)
+            if now_ns > deadline:
+                lost += 1
+                break
+        time.sleep(interval)
+    sock.close()
+    return rtts, lost
+
+
+def summarize(rtts, lost, count):
+    values = sorted(rtts)
+    return {
+        "sent": count,
+        "lost": lost,
+        "min": values[0] if values else float("nan"),
+        "p50": percentile(values, 50),
+        "p90": percentile(values, 90),
+        "p99": percentile(values, 99),
+        "max": values[-1] if values else float("nan"),
+    }
+
+
+def print_table(results):
+    print("%-16s %6s %6s %8s %8s %8s %8s %8s" % ("profile", "sent", "lost", "min", "p50", "p90", "p99", "max"))
+    for name, r in results.items():
+        print("%-16s %6d %6d %8.2f %8.2f %8.2f %8.2f %8.2f" % (
+            name, r["sent"], r["lost"], r["min"], r["p50"], r["p90"], r["p99"], r["max"]))
+    print("(round-trip times in ms)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host", help="station IP address")
+    parser.add_argument("--port", type=int, default=60002, help="echo port (CONFIG_STATION_UDP_ECHO_PORT)")
+    parser.add_argument("--count", type=int, default=1000, help="number of probes")
+    parser.add_argument("--interval", type=float, default=0.02, help="seconds between probes")
+    parser.add_argument("--size", type=int, default=32, help="datagram size in bytes")
+    parser.add_argument("--timeout", type=float, default=1.0, help="seconds to wait for each echo")
+    parser.add_argument("--profile", default="current", help="label for the firmware profile under test")
+    parser.add_argument("--results", help="JSON file collecting one entry per profile")
+    args = parser.parse_args()
+
+    rtts, lost = run(args.host, args.port, args.count, args.interval, args.size, args.timeout)
+    summary = summarize(rtts, lost, args.count)
+
+    results = {}
+    if args.results and os.path.exists(args.results):
+        with open(args.results) as f:
+            results = json.load(f)
+    results[args.profile] = summary
+    if args.results:
+        with open(args.results, "w") as f:
+            json.dump(results, f, indent=2)
+    print_table(results)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""Gzip the files under web/ and emit a C source with them as const arrays.
+
+The arrays land in .rodata, which the ESP32 maps from flash, so the HTTP
+handler can send them without copying into RAM. Each asset carries a strong
+ETag derived from its compressed bytes.
+
+usage: web_embed.py <web_dir> <output.c>
+"""
+import gzip
+import hashlib
+import os
+import sys
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+
+def collect(web_dir):
+    for root, _, files in os.walk(web_dir):
+        for name in sorted(files):
+            path = os.path.join(root, name)
+            rel = "/" + os.path.relpath(path, web_dir).replace(os.sep, "/")
+            yield rel, path
+
+
+def c_ident(rel):
+    return "http_asset_" + "".join(c if c.isalnum() else "_" for c in rel.strip("/"))
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    web_dir, out_path = sys.argv[1], sys.argv[2]
+
+    lines = [
+        "// Generated by tools/web_embed.py, do not edit.",
+        '#include "http/assets.h"',
+        "",
+    ]
+    entries = []
+    for rel, path in sorted(collect(web_dir)):
+        with open(path, "rb") as f:
+            raw = f.read()
+        # mtime=0 讓輸出可重現 (reproducible output)
+        data = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = '"%s"' % hashlib.sha1(data).hexdigest()[:16]
+        ident = c_ident(rel)
+        mime = MIME_TYPES.get(os.path.splitext(rel)[1], "application/octet-stream")
+        lines.append("static const uint8_t %s[%d] = {" % (ident, len(data)))
+        for i in range(0, len(data), 16):
+            lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+        lines.append("};")
+        lines.append("")
+        entries.append((rel, mime, ident, len(data), etag))
+
+    lines.append("const HttpAsset http_assets[] = {")
+    for rel, mime, ident, size, etag in entries:
+        lines.append('    { "%s", "%s", %s, %d, "%s" },' % (rel, mime, ident, size, etag.replace('"', '\\"')))
+    if not entries:
+        # 空目錄時 C 不允許零長度陣列，放一個不計入 count 的哨兵 (C has no empty arrays; the sentinel is not counted)
+        lines.append("    { NULL, NULL, NULL, 0, NULL },")
+    lines.append("};")
+    lines.append("const size_t http_assets_count = %d;" % len(entries))
+    lines.append("")
+
+    content = "\n".join(lines)
+    if os.path.exists(out_path):
+        with open(out_path) as f:
+            if f.read() == content:
+                return
+    with open(out_path, "w") as f:
+        f.write(content)
+
+
+if __name__ == "__main__":
+    main()
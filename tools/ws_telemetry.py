@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+"""WebSocket telemetry client: subscribes to /ws/telemetry and measures it.
+
+Connects to ws://HOST:PORT/ws/telemetry, sends the channel bitmask (bit n =
+TelemetryChannel n: 0 left_speed, 1 left_adc, 2 right_speed, 3 right_adc) and
+decodes the pushed frames
+
+    | channel u8 | reserved u8 | t_us u32 | value f32 |   (big-endian)
+
+Every --interval seconds it prints frames/s per channel and the
+sample-to-receive latency percentiles. t_us is the station's esp_timer at the
+moment the UART report was parsed, so it does not share a clock with this
+host. Unless --offset-us gives the offset, the tool takes the smallest
+(receive - t_us) seen so far as the zero point: latencies are then relative to
+the fastest frame, which shows queueing and jitter but not the fixed floor.
+t_us wraps every 2^32 us (about 71 minutes); differences are taken modulo 2^32.
+
+Against the Linux build (HTTP on port 8080) with stm32_sim.py feeding the UART:
+
+    ws_telemetry.py 127.0.0.1 --port 8080 --mask 0x0f --seconds 30
+    ws_telemetry.py 192.168.0.20 --mask 0x05 --results ws.json --label left+right
+"""
+import argparse
+import base64
+import hashlib
+import json
+import os
+import socket
+import struct
+import time
+
+WS_PATH = "/ws/telemetry"
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+OP_TEXT, OP_BINARY, OP_CLOSE, OP_PING, OP_PONG = 0x1, 0x2, 0x8, 0x9, 0xA
+
+FRAME = struct.Struct(">BBIf")  # channel, reserved, t_us, value
+CHANNELS = ["left_speed", "left_adc", "right_speed", "right_adc"]
+T_US_WRAP = 1 << 32
+
+
+def percentile(sorted_values, pct):
+    if not sorted_values:
+        return float("nan")
+    rank = max(0, min(len(sorted_values) - 1, int(round(pct / 100.0 * len(sorted_values) + 0.5)) - 1))
+    return sorted_values[rank]
+
+
+def ws_connect(host, port, timeout):
+    sock = socket.create_connection((host, port), timeout=timeout)
+    key = base64.b64encode(os.urandom(16)).decode()
+    sock.sendall((
+        "GET %s HTTP/1.1\r\n"
+        "Host: %s:%d\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: %s\r\n"
+        "Sec-WebSocket-Version: 13\r\n\r\n" % (WS_PATH, host, port, key)).encode())
+    head = b""
+    while b"\r\n\r\n" not in head:
+        chunk = sock.recv(1024)
+        if not chunk:
+            raise ConnectionError("connection closed during the handshake")
+        head += chunk
+    head, rest = head.split(b"\r\n\r\n", 1)
+    lines = head.decode("latin-1").split("\r\n")
+    if " 101 " not in lines[0] + " ":
+        raise ConnectionError("handshake refused: %s" % lines[0])
+    accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+    headers = {k.strip().lower(): v.strip() for k, _, v in (line.partition(":") for line in lines[1:])}
+    if headers.get("sec-websocket-accept") != accept:
+        raise ConnectionError("bad Sec-WebSocket-Accept")
+    return sock, rest
+
+
+def ws_send(sock, opcode, payload):
+    # 客戶端送出的訊框必須加遮罩 (client frames must be masked)
+    mask = os.urandom(4)
+    header = bytes([0x80 | opcode])
+    if len(payload) < 126:
+        header += bytes([0x80 | len(payload)])
+    else:
+        header += bytes([0x80 | 126]) + struct.pack(">H", len(payload))
+    masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    sock.sendall(header + mask + masked)
+
+
+class WsReader:
+    def __init__(self, sock, pending):
+        self.sock = sock
+        self.pending = pending
+
+    def parse(self):
+        # 只在整個訊框到齊後才取走 (consume only once the whole frame is buffered)
+        if len(self.pending) < 2:
+            return None
+        b0, b1 = self.pending[0], self.pending[1]
+        pos, size = 2, b1 & 0x7F
+        if size >= 126:
+            width = 2 if size == 126 else 8
+            if len(self.pending) < pos + width:
+                return None
+            size = int.from_bytes(self.pending[pos:pos + width], "big")
+            pos += width
+        mask = None
+        if b1 & 0x80:
+            if len(self.pending) < pos + 4:
+                return None
+            mask, pos = self.pending[pos:pos + 4], pos + 4
+        if len(self.pending) < pos + size:
+            return None
+        payload, self.pending = self.pending[pos:pos + size], self.pending[pos + size:]
+        if mask:
+            payload = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        return b0 & 0x0F, payload
+
+    def frame(self):
+        while True:
+            parsed = self.parse()
+            if parsed:
+                return parsed
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("connection closed")
+            self.pending += chunk
+
+
+class Stats:
+    def __init__(self, offset_us):
+        self.offset_us = offset_us
+        self.floor = None
+        self.counts = [0] * len(CHANNELS)
+        self.raw = []
+        self.bad = 0
+
+    def add(self, recv_us, payload):
+        if len(payload) != FRAME.size:
+            self.bad += 1
+            return
+        channel, _, t_us, _ = FRAME.unpack(payload)
+        if channel >= len(CHANNELS):
+            self.bad += 1
+            return
+        self.counts[channel] += 1
+        if self.offset_us is not None:
+            self.raw.append((recv_us + self.offset_us - t_us) % T_US_WRAP)
+            return
+        delta = (recv_us - t_us) % T_US_WRAP
+        if self.floor is None or (delta - self.floor) % T_US_WRAP > T_US_WRAP // 2:
+            self.floor = delta
+        self.raw.append(delta)
+
+    def take(self, seconds):
+        if self.offset_us is None:
+            base = self.floor if self.floor is not None else 0
+            latencies = sorted(((d - base) % T_US_WRAP) / 1000.0 for d in self.raw)
+        else:
+            latencies = sorted(d / 1000.0 for d in self.raw)
+        row = {
+            "seconds": seconds,
+            "rates": {name: self.counts[i] / seconds for i, name in enumerate(CHANNELS)},
+            "frames": len(self.raw),
+            "bad": self.bad,
+            "p50": percentile(latencies, 50),
+            "p90": percentile(latencies, 90),
+            "p99": percentile(latencies, 99),
+            "max": latencies[-1] if latencies else float("nan"),
+        }
+        self.counts = [0] * len(CHANNELS)
+        self.raw = []
+        self.bad = 0
+        return row
+
+
+def print_row(r):
+    rates = " ".join("%11.1f" % r["rates"][name] for name in CHANNELS)
+    print("%s %6d %8.2f %8.2f %8.2f %8.2f" % (rates, r["bad"], r["p50"], r["p90"], r["p99"], r["max"]), flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host", help="station IP address")
+    parser.add_argument("--port", type=int, default=80, help="HTTP server port (8080 for the Linux build)")
+    parser.add_argument("--mask", type=lambda s: int(s, 0), default=0x0F, help="channel bitmask (default 0x0f, all)")
+    parser.add_argument("--seconds", type=float, default=10.0, help="total run time")
+    parser.add_argument("--interval", type=float, default=1.0, help="seconds per report row")
+    parser.add_argument("--offset-us", type=int, help="station esp_timer minus host monotonic clock, if known")
+    parser.add_argument("--label", help="results key (default: mask)")
+    parser.add_argument("--results", help="JSON file collecting one run per label")
+    args = parser.parse_args()
+    if not 0 < args.mask < (1 << len(CHANNELS)):
+        parser.error("--mask must select at least one of the %d channels" % len(CHANNELS))
+
+    sock, rest = ws_connect(args.host, args.port, timeout=2.0)
+    ws_send(sock, OP_BINARY, bytes([args.mask]))
+    reader = WsReader(sock, rest)
+    stats = Stats(args.offset_us)
+    rows = []
+
+    print("%11s %11s %11s %11s %6s %8s %8s %8s %8s" % (
+        *CHANNELS, "bad", "p50", "p90", "p99", "max"))
+    start = time.monotonic()
+    mark = start
+    try:
+        while True:
+            now = time.monotonic()
+            if now - start >= args.seconds:
+                break
+            if now - mark >= args.interval:
+                rows.append(stats.take(now - mark))
+                print_row(rows[-1])
+                mark = now
+            sock.settimeout(max(0.01, mark + args.interval - now))
+            try:
+                opcode, payload = reader.frame()
+            except socket.timeout:
+                continue
+            recv_us = time.monotonic_ns() // 1000
+            if opcode == OP_BINARY:
+                stats.add(recv_us, payload)
+            elif opcode == OP_PING:
+                ws_send(sock, OP_PONG, payload)
+            elif opcode == OP_CLOSE:
+                print("station closed the WebSocket")
+                break
+    except KeyboardInterrupt:
+        pass
+    finally:
+        try:
+            ws_send(sock, OP_BINARY, bytes([0]))
+            ws_send(sock, OP_CLOSE, struct.pack(">H", 1000))
+        except OSError:
+            pass
+        sock.close()
+    print("(rates in frames/s, latencies in ms%s)" % (
+        "" if args.offset_us is not None else " above the fastest frame"))
+
+    if args.results:
+        results = {}
+        if os.path.exists(args.results):
+            with open(args.results) as f:
+                results = json.load(f)
+        results[args.label or "mask 0x%02x" % args.mask] = rows
+        with open(args.results, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
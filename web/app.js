@@ -0,0 +1,33 @@
+// 遙測訊框：| channel u8 | reserved u8 | t_us u32 | value f32 | (big-endian)
+const CHANNELS = ["left_speed", "left_adc", "right_speed", "right_adc"];
+const table = document.getElementById("telemetry");
+const rows = CHANNELS.map((name) => {
+  const row = table.insertRow();
+  row.insertCell().textContent = name;
+  row.insertCell().textContent = "-";
+  row.insertCell().textContent = "-";
+  return row;
+});
+
+function connect() {
+  const ws = new WebSocket(`ws://${location.host}/ws/telemetry`);
+  ws.binaryType = "arraybuffer";
+  ws.onopen = () => ws.send(String((1 << CHANNELS.length) - 1));
+  ws.onmessage = (ev) => {
+    const view = new DataView(ev.data);
+    const row = rows[view.getUint8(0)];
+    if (!row) return;
+    row.cells[1].textContent = view.getFloat32(6).toFixed(2);
+    row.cells[2].textContent = view.getUint32(2);
+  };
+  ws.onclose = () => setTimeout(connect, 1000);
+}
+connect();
+
+document.querySelectorAll("button[data-cmd]").forEach((button) => {
+  button.addEventListener("click", async () => {
+    const body = JSON.stringify(button.dataset.cmd.split(","));
+    const resp = await fetch("/cmd", { method: "POST", body });
+    document.getElementById("cmd-result").textContent = await resp.text();
+  });
+});